@@ -0,0 +1,197 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+
+/*
+	Micro-benchmarks for the codec's hot paths.  Run before and after any
+	optimization, e.g.
+
+		dicomlib_bench --benchmark_repetitions=5 --benchmark_out=before.json
+
+	and compare the two with Google Benchmark's tools/compare.py.
+*/
+
+#include <benchmark/benchmark.h>
+#include "Datasets.hpp"
+#include "lib/Encoder.hpp"
+#include "lib/Decoder.hpp"
+#include "lib/DataDictionary.hpp"
+#include "lib/UIDs.hpp"
+
+using namespace dicom;
+
+namespace
+{
+	typedef DataSet (*Generator)();
+
+	DataSet CTSlice(){return bench::CTSlice();}
+	DataSet MultiFrame(){return bench::MultiFrame();}
+	DataSet DeepSR(){return bench::DeepSR();}
+	DataSet MultiValuedStrings(){return bench::MultiValuedStrings();}
+
+	const TS& ExplicitLittle()
+	{
+		static const TS ts(EXPL_VR_LE_TRANSFER_SYNTAX);
+		return ts;
+	}
+
+	void BM_WriteToBuffer(benchmark::State& state,Generator Make)
+	{
+		const DataSet data=Make();
+		size_t Bytes=0;
+		for(auto _ : state)
+		{
+			Buffer buffer(__LITTLE_ENDIAN);
+			WriteToBuffer(data,buffer,ExplicitLittle());
+			Bytes+=buffer.size();
+			benchmark::DoNotOptimize(buffer.data());
+		}
+		state.SetBytesProcessed(int64_t(Bytes));
+	}
+
+	void BM_ReadFromBuffer(benchmark::State& state,Generator Make)
+	{
+		std::vector<BYTE> encoded;
+		{
+			Buffer buffer(__LITTLE_ENDIAN);
+			WriteToBuffer(Make(),buffer,ExplicitLittle());
+			encoded.assign(buffer.begin(),buffer.end());
+		}
+		for(auto _ : state)
+		{
+			//as ServiceBase does, the bytes arrive in a buffer and are parsed from there.
+			Buffer buffer(__LITTLE_ENDIAN);
+			buffer.AddVector(encoded);
+			DataSet data;
+			ReadFromBuffer(buffer,data,ExplicitLittle());
+			benchmark::DoNotOptimize(data.size());
+		}
+		state.SetBytesProcessed(int64_t(state.iterations())*int64_t(encoded.size()));
+	}
+
+	BENCHMARK_CAPTURE(BM_WriteToBuffer,CTSlice,CTSlice)->Unit(benchmark::kMicrosecond);
+	BENCHMARK_CAPTURE(BM_WriteToBuffer,MultiFrame2000,MultiFrame)->Unit(benchmark::kMillisecond);
+	BENCHMARK_CAPTURE(BM_WriteToBuffer,DeepSR,DeepSR)->Unit(benchmark::kMillisecond);
+	BENCHMARK_CAPTURE(BM_WriteToBuffer,MultiValuedStrings,MultiValuedStrings)->Unit(benchmark::kMicrosecond);
+	BENCHMARK_CAPTURE(BM_ReadFromBuffer,CTSlice,CTSlice)->Unit(benchmark::kMicrosecond);
+	BENCHMARK_CAPTURE(BM_ReadFromBuffer,MultiFrame2000,MultiFrame)->Unit(benchmark::kMillisecond);
+	BENCHMARK_CAPTURE(BM_ReadFromBuffer,DeepSR,DeepSR)->Unit(benchmark::kMillisecond);
+	BENCHMARK_CAPTURE(BM_ReadFromBuffer,MultiValuedStrings,MultiValuedStrings)->Unit(benchmark::kMicrosecond);
+
+	//!Each match of a C-FIND is a message of its own, so it's encoded and decoded on its own.
+	void BM_FindResultsEncode(benchmark::State& state)
+	{
+		const std::vector<DataSet> results=bench::FindResults(size_t(state.range(0)));
+		for(auto _ : state)
+		{
+			for(std::vector<DataSet>::const_iterator I=results.begin();I!=results.end();I++)
+			{
+				Buffer buffer(__LITTLE_ENDIAN);
+				WriteToBuffer(*I,buffer,ExplicitLittle());
+				benchmark::DoNotOptimize(buffer.data());
+			}
+		}
+		state.SetItemsProcessed(int64_t(state.iterations())*state.range(0));
+	}
+	BENCHMARK(BM_FindResultsEncode)->Arg(50000)->Unit(benchmark::kMillisecond);
+
+	void BM_FindResultsDecode(benchmark::State& state)
+	{
+		const std::vector<DataSet> results=bench::FindResults(size_t(state.range(0)));
+		std::vector<std::vector<BYTE> > encoded(results.size());
+		for(size_t i=0;i<results.size();i++)
+		{
+			Buffer buffer(__LITTLE_ENDIAN);
+			WriteToBuffer(results[i],buffer,ExplicitLittle());
+			encoded[i].assign(buffer.begin(),buffer.end());
+		}
+		for(auto _ : state)
+		{
+			for(std::vector<std::vector<BYTE> >::const_iterator I=encoded.begin();I!=encoded.end();I++)
+			{
+				Buffer buffer(__LITTLE_ENDIAN);
+				buffer.AddVector(*I);
+				DataSet match;
+				ReadFromBuffer(buffer,match,ExplicitLittle());
+				benchmark::DoNotOptimize(match.size());
+			}
+		}
+		state.SetItemsProcessed(int64_t(state.iterations())*state.range(0));
+	}
+	BENCHMARK(BM_FindResultsDecode)->Arg(50000)->Unit(benchmark::kMillisecond);
+
+	//!The element header fields, a value at a time, in the opposite byte order to ours.
+	void BM_BufferInsert(benchmark::State& state)
+	{
+		const int Elements=int(state.range(0));
+		for(auto _ : state)
+		{
+			Buffer buffer(__BIG_ENDIAN);
+			for(int i=0;i<Elements;i++)
+				buffer << UINT16(0x0008) << UINT16(i) << UINT16(0x4953) << UINT32(i);
+			benchmark::DoNotOptimize(buffer.data());
+		}
+		state.SetBytesProcessed(int64_t(state.iterations())*Elements*10);
+	}
+	BENCHMARK(BM_BufferInsert)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+	void BM_BufferExtract(benchmark::State& state)
+	{
+		const int Elements=int(state.range(0));
+		Buffer source(__BIG_ENDIAN);
+		for(int i=0;i<Elements;i++)
+			source << UINT16(0x0008) << UINT16(i) << UINT16(0x4953) << UINT32(i);
+		const std::vector<BYTE> encoded(source.begin(),source.end());
+		for(auto _ : state)
+		{
+			Buffer buffer(__BIG_ENDIAN);
+			buffer.AddVector(encoded);
+			UINT16 group,element,vr;
+			UINT32 length;
+			UINT32 sum=0;
+			for(int i=0;i<Elements;i++)
+			{
+				buffer >> group >> element >> vr >> length;
+				sum+=length;
+			}
+			benchmark::DoNotOptimize(sum);
+		}
+		state.SetBytesProcessed(int64_t(state.iterations())*Elements*10);
+	}
+	BENCHMARK(BM_BufferExtract)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+	//!Pixel data to or from a big endian transfer syntax.
+	void BM_SwitchVectorEndian(benchmark::State& state)
+	{
+		std::vector<unsigned short> pixels(size_t(state.range(0)),0x1234);
+		for(auto _ : state)
+		{
+			SwitchVectorEndian(pixels);
+			benchmark::DoNotOptimize(pixels.data());
+		}
+		state.SetBytesProcessed(int64_t(state.iterations())*state.range(0)*2);
+	}
+	BENCHMARK(BM_SwitchVectorEndian)->Arg(512*512)->Arg(32*32*2000)->Unit(benchmark::kMicrosecond);
+
+	//!Every element of an implicit VR data set needs a dictionary lookup.
+	void BM_GetVR(benchmark::State& state)
+	{
+		std::vector<Tag> tags;
+		const DataSet data=bench::CTSlice();
+		for(DataSet::const_iterator I=data.begin();I!=data.end();I++)
+			tags.push_back(I->first);
+		for(auto _ : state)
+		{
+			for(std::vector<Tag>::const_iterator I=tags.begin();I!=tags.end();I++)
+				benchmark::DoNotOptimize(GetVR(*I));
+		}
+		state.SetItemsProcessed(int64_t(state.iterations())*int64_t(tags.size()));
+	}
+	BENCHMARK(BM_GetVR);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,223 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <sstream>
+#include "Datasets.hpp"
+#include "lib/UIDs.hpp"
+
+using namespace dicom;
+
+namespace bench
+{
+	namespace
+	{
+		//enhanced multi-frame and SR tags that aren't in Tag.hpp
+		const Tag TAG_PIXEL_REPRESENTATION		=Tag(0x00280103);
+		const Tag TAG_IMAGE_POSITION_PATIENT	=Tag(0x00200032);
+		const Tag TAG_SLICE_THICKNESS			=Tag(0x00180050);
+		const Tag TAG_FRAME_CONTENT_SEQ			=Tag(0x00209111);
+		const Tag TAG_PLANE_POSITION_SEQ		=Tag(0x00209113);
+		const Tag TAG_PIXEL_MEASURES_SEQ		=Tag(0x00289110);
+		const Tag TAG_FRAME_VOI_LUT_SEQ			=Tag(0x00289132);
+		const Tag TAG_IN_STACK_POSITION			=Tag(0x00209057);
+		const Tag TAG_DIMENSION_INDEX_VALUES	=Tag(0x00209157);
+		const Tag TAG_PER_FRAME_GROUPS_SEQ		=Tag(0x52009230);
+		const Tag TAG_TEXT_VALUE				=Tag(0x0040a160);
+
+		template<typename T>
+		std::string Number(T n)
+		{
+			std::ostringstream os;
+			os << n;
+			return os.str();
+		}
+
+		//!What every composite instance has.
+		void PutPatientStudySeries(DataSet& data,const UID& SOPClass,size_t Instance)
+		{
+			data.Put<VR_UI>(TAG_SOP_CLASS_UID,SOPClass);
+			data.Put<VR_UI>(TAG_SOP_INST_UID,UID("1.2.826.0.1.3680043.2.1143.1." + Number(Instance)));
+			data.Put<VR_DA>(TAG_STUDY_DATE,std::string("20070401"));
+			data.Put<VR_TM>(TAG_STUDY_TIME,std::string("101500"));
+			data.Put<VR_SH>(TAG_ACCESS_NO,std::string("A1234567"));
+			data.Put<VR_CS>(TAG_MODALITY,std::string("CT"));
+			data.Put<VR_PN>(TAG_REF_PHYS_NAME,std::string("Welby^Marcus"));
+			data.Put<VR_LO>(TAG_STUDY_DESC,std::string("CT CHEST WITH CONTRAST"));
+			data.Put<VR_PN>(TAG_PAT_NAME,std::string("Doe^Jane"));
+			data.Put<VR_LO>(TAG_PAT_ID,std::string("0012345678"));
+			data.Put<VR_DA>(TAG_PAT_BIRTH_DATE,std::string("19500101"));
+			data.Put<VR_CS>(TAG_PAT_SEX,std::string("F"));
+			data.Put<VR_UI>(TAG_STUDY_INST_UID,UID("1.2.826.0.1.3680043.2.1143.2"));
+			data.Put<VR_UI>(TAG_SERIES_INST_UID,UID("1.2.826.0.1.3680043.2.1143.3"));
+			data.Put<VR_SH>(TAG_STUDY_ID,std::string("1"));
+			data.Put<VR_IS>(TAG_SERIES_NO,std::string("2"));
+		}
+
+		void PutImagePixelModule(DataSet& data,UINT16 Rows,UINT16 Columns)
+		{
+			data.Put<VR_US>(TAG_SAMPLES_PER_PX,UINT16(1));
+			data.Put<VR_CS>(TAG_PHOTOMETRIC,std::string("MONOCHROME2"));
+			data.Put<VR_US>(TAG_ROWS,Rows);
+			data.Put<VR_US>(TAG_COLUMNS,Columns);
+			data.Put<VR_US>(TAG_BITS_ALLOC,UINT16(16));
+			data.Put<VR_US>(TAG_BITS_STORED,UINT16(12));
+			data.Put<VR_US>(TAG_HIGH_BIT,UINT16(11));
+			data.Put<VR_US>(TAG_PIXEL_REPRESENTATION,UINT16(0));
+		}
+
+		//!Something that looks a bit like anatomy, rather than all zeros.
+		std::vector<UINT16> Pixels(size_t Count)
+		{
+			std::vector<UINT16> pixels(Count);
+			for(size_t i=0;i<Count;i++)
+				pixels[i]=UINT16((i*2654435761u)>>20)&0x0fff;
+			return pixels;
+		}
+
+		DataSet Code(const std::string& Value,const std::string& Meaning)
+		{
+			DataSet code;
+			code.Put<VR_SH>(TAG_CODE_VALUE,Value);
+			code.Put<VR_SH>(TAG_CODING_SCHEME_DESIGNATOR,std::string("DCM"));
+			code.Put<VR_LO>(TAG_CODE_MEANING,Meaning);
+			return code;
+		}
+
+		DataSet ContentItem(size_t Depth,size_t Breadth,size_t& Count)
+		{
+			DataSet item;
+			Count++;
+			item.Put<VR_CS>(TAG_RELATIONSHIP_TYPE,std::string("CONTAINS"));
+			item.Put<VR_SQ>(TAG_CONCEPT_NAME_CODE_SEQ,std::vector<DataSet>(1,Code("121071","Finding")));
+			if(0==Depth)
+			{
+				item.Put<VR_CS>(TAG_VALUE_TYPE,std::string("TEXT"));
+				item.Put<VR_UT>(TAG_TEXT_VALUE,"Finding number " + Number(Count) + ", no significant abnormality.");
+				return item;
+			}
+			item.Put<VR_CS>(TAG_VALUE_TYPE,std::string("CONTAINER"));
+			std::vector<DataSet> children;
+			for(size_t i=0;i<Breadth;i++)
+				children.push_back(ContentItem(Depth-1,Breadth,Count));
+			item.Put<VR_SQ>(TAG_CONTENT_SEQ,children);
+			return item;
+		}
+	}
+
+	DataSet CTSlice()
+	{
+		DataSet data;
+		PutPatientStudySeries(data,CT_IMAGE_STORAGE_SOP_CLASS,1);
+		data.Put<VR_CS>(TAG_IMAGE_TYPE,std::string("ORIGINAL"));
+		data.Put<VR_CS>(TAG_IMAGE_TYPE,std::string("PRIMARY"));
+		data.Put<VR_CS>(TAG_IMAGE_TYPE,std::string("AXIAL"));
+		data.Put<VR_DS>(TAG_KVP,std::string("120"));
+		data.Put<VR_DS>(TAG_SLICE_THICKNESS,std::string("0.625"));
+		data.Put<VR_IS>(TAG_IMAGE_NO,std::string("57"));
+		data.Put<VR_DS>(TAG_IMAGE_POSITION_PATIENT,std::string("-250"));
+		data.Put<VR_DS>(TAG_IMAGE_POSITION_PATIENT,std::string("-250"));
+		data.Put<VR_DS>(TAG_IMAGE_POSITION_PATIENT,std::string("-35.625"));
+		const char* Orientation[]={"1","0","0","0","1","0"};
+		for(size_t i=0;i<6;i++)
+			data.Put<VR_DS>(TAG_IMAGE_ORIENTATION,std::string(Orientation[i]));
+		data.Put<VR_DS>(TAG_PIXEL_SPACING,std::string("0.976562"));
+		data.Put<VR_DS>(TAG_PIXEL_SPACING,std::string("0.976562"));
+		PutImagePixelModule(data,512,512);
+		data.Put<VR_DS>(TAG_WINDOW_CENTER,std::string("40"));
+		data.Put<VR_DS>(TAG_WINDOW_WIDTH,std::string("400"));
+		data.Put<VR_DS>(TAG_RESCALE_INTERCEPT,std::string("-1024"));
+		data.Put<VR_DS>(TAG_RESCALE_SLOPE,std::string("1"));
+		data.Put<VR_OW>(TAG_PIXEL_DATA,Pixels(512*512));
+		return data;
+	}
+
+	DataSet MultiFrame(size_t Frames)
+	{
+		DataSet data;
+		PutPatientStudySeries(data,ENHANCED_CT_IMAGE_STORAGE_SOP_CLASS,2);
+		data.Put<VR_IS>(TAG_NUM_OF_FRAMES,Number(Frames));
+		PutImagePixelModule(data,32,32);
+
+		std::vector<DataSet> PerFrame;
+		PerFrame.reserve(Frames);
+		for(size_t i=0;i<Frames;i++)
+		{
+			DataSet content;
+			content.Put<VR_UL>(TAG_IN_STACK_POSITION,UINT32(i+1));
+			content.Put<VR_UL>(TAG_DIMENSION_INDEX_VALUES,UINT32(1));
+			content.Put<VR_UL>(TAG_DIMENSION_INDEX_VALUES,UINT32(i+1));
+
+			DataSet position;
+			position.Put<VR_DS>(TAG_IMAGE_POSITION_PATIENT,std::string("-250"));
+			position.Put<VR_DS>(TAG_IMAGE_POSITION_PATIENT,std::string("-250"));
+			position.Put<VR_DS>(TAG_IMAGE_POSITION_PATIENT,Number(-0.625*double(i)));
+
+			DataSet measures;
+			measures.Put<VR_DS>(TAG_PIXEL_SPACING,std::string("0.976562"));
+			measures.Put<VR_DS>(TAG_PIXEL_SPACING,std::string("0.976562"));
+			measures.Put<VR_DS>(TAG_SLICE_THICKNESS,std::string("0.625"));
+
+			DataSet voi;
+			voi.Put<VR_DS>(TAG_WINDOW_CENTER,std::string("40"));
+			voi.Put<VR_DS>(TAG_WINDOW_WIDTH,std::string("400"));
+
+			DataSet frame;
+			frame.Put<VR_SQ>(TAG_FRAME_CONTENT_SEQ,std::vector<DataSet>(1,content));
+			frame.Put<VR_SQ>(TAG_PLANE_POSITION_SEQ,std::vector<DataSet>(1,position));
+			frame.Put<VR_SQ>(TAG_PIXEL_MEASURES_SEQ,std::vector<DataSet>(1,measures));
+			frame.Put<VR_SQ>(TAG_FRAME_VOI_LUT_SEQ,std::vector<DataSet>(1,voi));
+			PerFrame.push_back(frame);
+		}
+		data.Put<VR_SQ>(TAG_PER_FRAME_GROUPS_SEQ,PerFrame);
+		data.Put<VR_OW>(TAG_PIXEL_DATA,Pixels(32*32*Frames));
+		return data;
+	}
+
+	DataSet DeepSR(size_t Depth,size_t Breadth)
+	{
+		DataSet data;
+		PutPatientStudySeries(data,COMPREHENSIVE_SR_STORAGE_SOP_CLASS,3);
+		size_t Count=0;
+		DataSet root=ContentItem(Depth,Breadth,Count);
+		for(DataSet::const_iterator I=root.begin();I!=root.end();I++)
+			if(I->first!=TAG_RELATIONSHIP_TYPE)
+				data.insert(*I);
+		return data;
+	}
+
+	std::vector<DataSet> FindResults(size_t Count)
+	{
+		std::vector<DataSet> results;
+		results.reserve(Count);
+		for(size_t i=0;i<Count;i++)
+		{
+			DataSet match;
+			match.Put<VR_CS>(TAG_QR_LEVEL,std::string("STUDY"));
+			match.Put<VR_DA>(TAG_STUDY_DATE,std::string("20070401"));
+			match.Put<VR_SH>(TAG_ACCESS_NO,"A" + Number(1000000+i));
+			match.Put<VR_LO>(TAG_STUDY_DESC,std::string("CT CHEST WITH CONTRAST"));
+			match.Put<VR_PN>(TAG_PAT_NAME,"Doe^Patient" + Number(i%977));
+			match.Put<VR_LO>(TAG_PAT_ID,Number(10000000+i));
+			match.Put<VR_UI>(TAG_STUDY_INST_UID,UID("1.2.826.0.1.3680043.2.1143.4." + Number(i)));
+			results.push_back(match);
+		}
+		return results;
+	}
+
+	DataSet MultiValuedStrings(size_t Elements)
+	{
+		//private tags, so there are plenty of them.
+		DataSet data;
+		for(size_t i=0;i<Elements;i++)
+		{
+			const Tag tag=Tag(0x00191000+i);
+			for(int j=0;j<6;j++)
+				data.Put<VR_DS>(tag,Number(0.25*double(i*6+j)));
+		}
+		return data;
+	}
+}//namespace bench
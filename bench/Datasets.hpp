@@ -0,0 +1,30 @@
+#ifndef DATASETS_HPP_INCLUDE_GUARD_5031872264
+#define DATASETS_HPP_INCLUDE_GUARD_5031872264
+#include <vector>
+#include "lib/DataSet.hpp"
+
+/*
+	Synthetic data sets for the benchmarks, generated in-process so that the
+	numbers don't depend on whatever files happen to be lying around.  Each
+	is shaped like the real thing where it matters to the codec: element
+	count, nesting, multiplicity and bulk data size.
+*/
+namespace bench
+{
+	//!A 512x512 16 bit CT slice with a typical header.
+	dicom::DataSet CTSlice();
+
+	//!An enhanced multi-frame image, with a per-frame functional group item for each of Frames 32x32 frames.
+	dicom::DataSet MultiFrame(size_t Frames=2000);
+
+	//!A structured report whose content tree is Depth levels deep, each node having Breadth children.
+	dicom::DataSet DeepSR(size_t Depth=6,size_t Breadth=4);
+
+	//!What a C-FIND at study level might send back, one data set per match.
+	std::vector<dicom::DataSet> FindResults(size_t Count=50000);
+
+	//!Lots of multi-valued string elements, which have to be split on backslashes when decoded.
+	dicom::DataSet MultiValuedStrings(size_t Elements=2000);
+}//namespace bench
+
+#endif //DATASETS_HPP_INCLUDE_GUARD_5031872264
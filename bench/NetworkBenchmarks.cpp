@@ -0,0 +1,190 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+
+/*
+	End to end benchmarks: a ClientConnection talking to a Server in the
+	same process over loopback TCP, so everything from the A-ASSOCIATE
+	primitives through ServiceBase::Write()/Read() and PDataTF::ReadDynamic()
+	is exercised without needing a PACS to talk to.
+
+	Arguments are named, e.g. BM_Store/pdu:16384/bytes:524288 is 512KB
+	instances sent as 16KB PDUs.  A pdu of 0 means no limit.
+*/
+
+#include <map>
+#include <benchmark/benchmark.h>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include "Datasets.hpp"
+#include "lib/ClientConnection.hpp"
+#include "lib/Server.hpp"
+#include "lib/UIDs.hpp"
+
+using namespace dicom;
+
+namespace
+{
+	const std::string Host("127.0.0.1");
+	const std::string ServerAET("BENCH_SCP");
+	const std::string ClientAET("BENCH_SCU");
+	const unsigned short BasePort=11112;
+
+	//!What the C-FIND handler sends back, set up by each benchmark before it starts.
+	std::vector<DataSet> Matches;
+
+	void StoreHandler(ServiceBase&,const DataSet&,DataSet&)
+	{
+		//as fast as it can be, so we're only measuring the network and codec.
+	}
+
+	void FindHandler(ServiceBase&,DataSet&,Sequence& matches)
+	{
+		matches=Matches;
+	}
+
+	//!One server per maximum PDU length, started the first time it's asked for, and left running.
+	unsigned short ServerFor(UINT32 MaxPDULength)
+	{
+		static boost::mutex mutex;
+		typedef std::map<UINT32,std::pair<unsigned short,boost::shared_ptr<Server> > > Servers;
+		static Servers servers;
+
+		boost::mutex::scoped_lock lock(mutex);
+		Servers::iterator I=servers.find(MaxPDULength);
+		if(I==servers.end())
+		{
+			unsigned short Port=static_cast<unsigned short>(BasePort+servers.size());
+			boost::shared_ptr<Server> server(new Server(Port,ServerAET,Server::THREAD_PER_ASSOCIATION,0,MaxPDULength));
+			server->AddStoreHandler(CT_IMAGE_STORAGE_SOP_CLASS,StoreHandler);
+			server->AddFindHandler(STUDY_ROOT_QR_FIND_SOP_CLASS,FindHandler);
+			server->Start();
+			I=servers.insert(std::make_pair(MaxPDULength,std::make_pair(Port,server))).first;
+		}
+		return I->second.first;
+	}
+
+	PresentationContexts Contexts()
+	{
+		PresentationContexts contexts;
+		contexts.Add(VERIFICATION_SOP_CLASS);
+		contexts.Add(CT_IMAGE_STORAGE_SOP_CLASS);
+		contexts.Add(STUDY_ROOT_QR_FIND_SOP_CLASS);
+		return contexts;
+	}
+
+	//!Both ends ask for the same maximum PDU length.
+	boost::shared_ptr<ClientConnection> Connect(UINT32 MaxPDULength)
+	{
+		const unsigned short Port=ServerFor(MaxPDULength);
+		return boost::shared_ptr<ClientConnection>(
+			new ClientConnection(Host,Port,ClientAET,ServerAET,Contexts(),1,MaxPDULength));
+	}
+
+	//!A CT slice, with however much pixel data we want.
+	DataSet Instance(size_t Bytes)
+	{
+		DataSet data=bench::CTSlice();
+		data.erase(TAG_PIXEL_DATA);
+		data.Put<VR_OW>(TAG_PIXEL_DATA,std::vector<UINT16>(Bytes/2,0x0400));
+		return data;
+	}
+
+	void BM_Associate(benchmark::State& state)
+	{
+		const UINT32 MaxPDULength=primitive::MaximumSubLength::DefaultMaximumLength_;
+		ServerFor(MaxPDULength);
+		for(auto _ : state)
+		{
+			ClientConnection connection(Host,ServerFor(MaxPDULength),ClientAET,ServerAET,Contexts());
+		}
+	}
+	BENCHMARK(BM_Associate)->Unit(benchmark::kMicrosecond);
+
+	void BM_Echo(benchmark::State& state)
+	{
+		boost::shared_ptr<ClientConnection> connection=Connect(primitive::MaximumSubLength::DefaultMaximumLength_);
+		for(auto _ : state)
+			connection->Echo();
+	}
+	BENCHMARK(BM_Echo)->Unit(benchmark::kMicrosecond);
+
+	void BM_Store(benchmark::State& state)
+	{
+		const UINT32 MaxPDULength=UINT32(state.range(0));
+		const size_t Bytes=size_t(state.range(1));
+		const DataSet data=Instance(Bytes);
+		boost::shared_ptr<ClientConnection> connection=Connect(MaxPDULength);
+		for(auto _ : state)
+			connection->Store(data);
+		state.SetItemsProcessed(int64_t(state.iterations()));
+		state.SetBytesProcessed(int64_t(state.iterations())*int64_t(Bytes));
+	}
+	BENCHMARK(BM_Store)
+		->ArgNames({"pdu","bytes"})
+		->ArgsProduct({{16384,65536,1048576,0},{64*1024,512*1024,8*1024*1024}})
+		->Unit(benchmark::kMillisecond)
+		->UseRealTime();
+
+	void StoreSeveral(ClientConnection& connection,const DataSet& data,int Count)
+	{
+		for(int i=0;i<Count;i++)
+			connection.Store(data);
+	}
+
+	//!Several associations storing at once, each on its own thread.
+	void BM_StoreConcurrent(benchmark::State& state)
+	{
+		const int Clients=int(state.range(0));
+		const int PerClient=8;
+		const size_t Bytes=512*1024;
+		const DataSet data=Instance(Bytes);
+		std::vector<boost::shared_ptr<ClientConnection> > connections;
+		for(int i=0;i<Clients;i++)
+			connections.push_back(Connect(primitive::MaximumSubLength::DefaultMaximumLength_));
+		for(auto _ : state)
+		{
+			boost::thread_group threads;
+			for(int i=0;i<Clients;i++)
+				threads.create_thread(boost::bind(StoreSeveral,boost::ref(*connections[i]),boost::cref(data),PerClient));
+			threads.join_all();
+		}
+		state.SetItemsProcessed(int64_t(state.iterations())*Clients*PerClient);
+		state.SetBytesProcessed(int64_t(state.iterations())*Clients*PerClient*int64_t(Bytes));
+	}
+	BENCHMARK(BM_StoreConcurrent)
+		->ArgName("clients")
+		->Arg(1)->Arg(4)->Arg(16)
+		->Unit(benchmark::kMillisecond)
+		->UseRealTime();
+
+	void BM_Find(benchmark::State& state)
+	{
+		const UINT32 MaxPDULength=UINT32(state.range(0));
+		const size_t Count=size_t(state.range(1));
+		Matches=bench::FindResults(Count);
+		boost::shared_ptr<ClientConnection> connection=Connect(MaxPDULength);
+
+		DataSet query;
+		query.Put<VR_CS>(TAG_QR_LEVEL,std::string("STUDY"));
+		query.Put<VR_PN>(TAG_PAT_NAME,std::string("Doe^*"));
+		for(auto _ : state)
+		{
+			std::vector<DataSet> results=connection->Find(query,QueryRetrieve::STUDY_ROOT);
+			if(results.size()!=Count)
+				state.SkipWithError("wrong number of matches");
+		}
+		state.SetItemsProcessed(int64_t(state.iterations())*int64_t(Count));
+	}
+	BENCHMARK(BM_Find)
+		->ArgNames({"pdu","matches"})
+		->ArgsProduct({{16384,0},{1000,10000}})
+		->Unit(benchmark::kMillisecond)
+		->UseRealTime();
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,159 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <sstream>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "AssociationPool.hpp"
+#include "UIDs.hpp"
+
+namespace dicom
+{
+	using namespace primitive;
+
+	//!Hands the association back to the pool when the last Handle goes.
+	struct AssociationPool::Lease : boost::noncopyable
+	{
+		Lease(AssociationPool& pool,const std::string& key,boost::shared_ptr<ClientConnection> connection)
+			:pool_(pool),key_(key),connection_(connection),discard_(false){}
+
+		~Lease()
+		{
+			if(!discard_)
+				pool_.Return(key_,connection_);
+		}
+
+		AssociationPool& pool_;
+		const std::string key_;
+		boost::shared_ptr<ClientConnection> connection_;
+		bool discard_;
+	};
+
+	ClientConnection* AssociationPool::Handle::operator->() const
+	{
+		return lease_->connection_.get();
+	}
+
+	ClientConnection& AssociationPool::Handle::operator*() const
+	{
+		return *lease_->connection_;
+	}
+
+	void AssociationPool::Handle::Discard()
+	{
+		if(lease_)
+			lease_->discard_=true;
+	}
+
+	AssociationPool::AssociationPool(boost::posix_time::time_duration StaleAfter,size_t MaxIdlePerPeer)
+		:StaleAfter_(StaleAfter),MaxIdlePerPeer_(MaxIdlePerPeer)
+	{
+	}
+
+	AssociationPool::~AssociationPool()
+	{
+		Clear();
+	}
+
+	std::string AssociationPool::Key(const std::string& Host,unsigned short Port,
+		const std::string& LocalAET,const std::string& RemoteAET,
+		const PresentationContexts& Contexts)
+	{
+		//IDs are left out, they're just numbering.
+		std::ostringstream key;
+		key << Host << ':' << Port << '/' << LocalAET << '/' << RemoteAET;
+		for(PresentationContexts::const_iterator I=Contexts.begin();I!=Contexts.end();I++)
+		{
+			key << '/' << I->AbsSyntax_.UID_.str();
+			for(std::vector<TransferSyntax>::const_iterator J=I->TransferSyntaxes_.begin();J!=I->TransferSyntaxes_.end();J++)
+				key << ',' << J->UID_.str();
+		}
+		return key.str();
+	}
+
+	AssociationPool::Handle AssociationPool::Acquire(std::string Host,unsigned short Port,
+		std::string LocalAET,std::string RemoteAET,
+		const PresentationContexts& ProposedPresentationContexts)
+	{
+		const std::string key=Key(Host,Port,LocalAET,RemoteAET,ProposedPresentationContexts);
+
+		//Most recently used first, it's the one most likely to still be alive.
+		for(;;)
+		{
+			Idler idler;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				std::map<std::string,std::vector<Idler> >::iterator I=Idle_.find(key);
+				if(I==Idle_.end() || I->second.empty())
+					break;
+				idler=I->second.back();
+				I->second.pop_back();
+			}
+
+			boost::shared_ptr<Lease> lease(new Lease(*this,key,idler.connection_));
+			if(boost::posix_time::microsec_clock::universal_time()-idler.since_<StaleAfter_)
+				return Handle(lease);
+
+			try
+			{
+				idler.connection_->Echo();
+				return Handle(lease);
+			}
+			catch(std::exception&)
+			{
+				//gone away while we weren't looking.
+				lease->discard_=true;
+			}
+		}
+
+		PresentationContexts contexts(ProposedPresentationContexts);
+		bool HasVerification=false;
+		for(PresentationContexts::const_iterator I=contexts.begin();I!=contexts.end();I++)
+			if(I->AbsSyntax_.UID_==VERIFICATION_SOP_CLASS)
+				HasVerification=true;
+		if(!HasVerification)
+			contexts.Add(VERIFICATION_SOP_CLASS);
+
+		boost::shared_ptr<ClientConnection> connection(new ClientConnection(Host,Port,LocalAET,RemoteAET,contexts));
+		return Handle(boost::shared_ptr<Lease>(new Lease(*this,key,connection)));
+	}
+
+	void AssociationPool::Return(const std::string& Key,boost::shared_ptr<ClientConnection> connection)
+	{
+		Idler idler;
+		idler.connection_=connection;
+		idler.since_=boost::posix_time::microsec_clock::universal_time();
+
+		Idler oldest;//released outside the lock, as that means talking to the peer.
+		boost::mutex::scoped_lock lock(mutex_);
+		std::vector<Idler>& idle=Idle_[Key];
+		idle.push_back(idler);
+		if(idle.size()>MaxIdlePerPeer_)
+		{
+			oldest=idle.front();
+			idle.erase(idle.begin());
+		}
+	}
+
+	size_t AssociationPool::Idle()
+	{
+		size_t count=0;
+		boost::mutex::scoped_lock lock(mutex_);
+		for(std::map<std::string,std::vector<Idler> >::iterator I=Idle_.begin();I!=Idle_.end();I++)
+			count+=I->second.size();
+		return count;
+	}
+
+	void AssociationPool::Clear()
+	{
+		std::map<std::string,std::vector<Idler> > idle;
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			idle.swap(Idle_);
+		}
+		//connections release themselves as idle goes out of scope.
+	}
+}//namespace dicom
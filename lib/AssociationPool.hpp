@@ -0,0 +1,97 @@
+#ifndef ASSOCIATION_POOL_HPP_INCLUDE_GUARD_2719504638
+#define ASSOCIATION_POOL_HPP_INCLUDE_GUARD_2719504638
+#include <string>
+#include <map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "ClientConnection.hpp"
+#include "PresentationContexts.hpp"
+
+namespace dicom
+{
+	//!Keeps negotiated associations open so they can be used again.
+	/*!
+		Connecting and negotiating an association costs a couple of round
+		trips, which for a small query is most of the time taken.  Instead of
+		constructing a ClientConnection for each operation, do:
+		<pre>
+			AssociationPool::Handle connection=pool.Acquire(host,port,me,them,contexts);
+			connection->Find(...);
+		</pre>
+		When the last copy of the Handle goes away the association goes back
+		into the pool, and the next Acquire() with the same host, port, AETs
+		and presentation contexts gets it straight back.
+
+		An association that has sat idle for longer than StaleAfter may well
+		have been dropped by the peer or a firewall in the mean time, so it's
+		checked with a C-ECHO before being handed out.  Verification is added
+		to the presentation contexts for this purpose if it isn't already there.
+
+		If an operation on a Handle throws, call Discard() so the association
+		isn't reused.  Idle associations are released when the pool is
+		destroyed, so the pool must outlive any Handles.
+	*/
+	class AssociationPool : boost::noncopyable
+	{
+		struct Lease;
+	public:
+		//!Shared ownership of an association borrowed from the pool.
+		class Handle
+		{
+		public:
+			Handle(){}
+			ClientConnection* operator->() const;
+			ClientConnection& operator*() const;
+
+			//!Don't return this association to the pool, it's broken.
+			void Discard();
+
+		private:
+			friend class AssociationPool;
+			Handle(boost::shared_ptr<Lease> lease):lease_(lease){}
+			boost::shared_ptr<Lease> lease_;
+		};
+
+		AssociationPool(boost::posix_time::time_duration StaleAfter=boost::posix_time::seconds(30),
+			size_t MaxIdlePerPeer=4);
+
+		//!Releases every idle association.
+		~AssociationPool();
+
+		//!An idle association with these parameters, or a new one.
+		Handle Acquire(std::string Host,unsigned short Port,
+			std::string LocalAET,std::string RemoteAET,
+			const PresentationContexts& ProposedPresentationContexts);
+
+		//!Number of associations currently idle in the pool.
+		size_t Idle();
+
+		//!Release every idle association.
+		void Clear();
+
+	private:
+		struct Idler
+		{
+			boost::shared_ptr<ClientConnection> connection_;
+			boost::posix_time::ptime since_;
+		};
+
+		//!Everything that has to match for an association to be reused.
+		static std::string Key(const std::string& Host,unsigned short Port,
+			const std::string& LocalAET,const std::string& RemoteAET,
+			const PresentationContexts& Contexts);
+
+		void Return(const std::string& Key,boost::shared_ptr<ClientConnection> connection);
+
+		const boost::posix_time::time_duration StaleAfter_;
+		const size_t MaxIdlePerPeer_;
+
+		boost::mutex mutex_;
+		std::map<std::string,std::vector<Idler> > Idle_;
+	};
+}//namespace dicom
+
+#endif //ASSOCIATION_POOL_HPP_INCLUDE_GUARD_2719504638
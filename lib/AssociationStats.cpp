@@ -0,0 +1,157 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include "AssociationStats.hpp"
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+namespace dicom
+{
+	void Timing::Add(boost::uint64_t Nanoseconds)
+	{
+		Count_++;
+		TotalNanoseconds_+=Nanoseconds;
+		MaxNanoseconds_=std::max(MaxNanoseconds_,Nanoseconds);
+	}
+
+	Timing& Timing::operator+=(const Timing& other)
+	{
+		Count_+=other.Count_;
+		TotalNanoseconds_+=other.TotalNanoseconds_;
+		MaxNanoseconds_=std::max(MaxNanoseconds_,other.MaxNanoseconds_);
+		return *this;
+	}
+
+	AssociationStats::AssociationStats()
+		:Associations_(0),MessagesSent_(0),MessagesReceived_(0)
+		,PDUsSent_(0),PDUsReceived_(0),BytesSent_(0),BytesReceived_(0)
+	{
+	}
+
+	AssociationStats& AssociationStats::operator+=(const AssociationStats& other)
+	{
+		Associations_+=other.Associations_;
+		Negotiation_+=other.Negotiation_;
+		for(std::map<Command::Code,Timing>::const_iterator I=other.Operations_.begin();I!=other.Operations_.end();I++)
+			Operations_[I->first]+=I->second;
+		Handler_+=other.Handler_;
+		Encode_+=other.Encode_;
+		Decode_+=other.Decode_;
+		Send_+=other.Send_;
+		Receive_+=other.Receive_;
+		MessagesSent_+=other.MessagesSent_;
+		MessagesReceived_+=other.MessagesReceived_;
+		PDUsSent_+=other.PDUsSent_;
+		PDUsReceived_+=other.PDUsReceived_;
+		BytesSent_+=other.BytesSent_;
+		BytesReceived_+=other.BytesReceived_;
+		return *this;
+	}
+
+	std::string CommandName(Command::Code command)
+	{
+		switch(command & 0x7fff)
+		{
+		case Command::C_STORE_RQ:		return "C-STORE";
+		case Command::C_GET_RQ:			return "C-GET";
+		case Command::C_FIND_RQ:		return "C-FIND";
+		case Command::C_MOVE_RQ:		return "C-MOVE";
+		case Command::C_ECHO_RQ:		return "C-ECHO";
+		case Command::N_EVENT_REPORT_RQ:return "N-EVENT-REPORT";
+		case Command::N_GET_RQ:			return "N-GET";
+		case Command::N_SET_RQ:			return "N-SET";
+		case Command::N_ACTION_RQ:		return "N-ACTION";
+		case Command::N_CREATE_RQ:		return "N-CREATE";
+		case Command::N_DELETE_RQ:		return "N-DELETE";
+		case Command::C_CANCEL_RQ:		return "C-CANCEL";
+		}
+		std::ostringstream os;
+		os << "0x" << std::hex << std::setw(4) << std::setfill('0') << command;
+		return os.str();
+	}
+
+	namespace
+	{
+		//!{Labels,Extra}, or nothing if both are empty.
+		std::string LabelSet(const std::string& Labels,const std::string& Extra="")
+		{
+			if(Labels.empty() && Extra.empty())
+				return "";
+			if(Labels.empty() || Extra.empty())
+				return "{" + Labels + Extra + "}";
+			return "{" + Labels + "," + Extra + "}";
+		}
+
+		std::string Seconds(boost::uint64_t Nanoseconds)
+		{
+			std::ostringstream os;
+			os << std::setprecision(9) << double(Nanoseconds)/1e9;
+			return os.str();
+		}
+
+		void Header(std::ostream& out,const std::string& Name,const std::string& Type,const std::string& Help)
+		{
+			out << "# HELP " << Name << " " << Help << "\n";
+			out << "# TYPE " << Name << " " << Type << "\n";
+		}
+
+		void Samples(std::ostream& out,const std::string& Name,const std::string& Labels,const Timing& timing)
+		{
+			out << Name << "_count" << Labels << " " << timing.Count_ << "\n";
+			out << Name << "_sum" << Labels << " " << Seconds(timing.TotalNanoseconds_) << "\n";
+		}
+
+		//!A timing as a summary called Name, and a gauge called Name_max.
+		void Write(std::ostream& out,const std::string& Name,const std::string& Help,
+			const std::string& Labels,const std::map<std::string,Timing>& timings)
+		{
+			Header(out,Name,"summary",Help);
+			for(std::map<std::string,Timing>::const_iterator I=timings.begin();I!=timings.end();I++)
+				Samples(out,Name,LabelSet(Labels,I->first),I->second);
+			Header(out,Name+"_max","gauge","Longest of "+Name+".");
+			for(std::map<std::string,Timing>::const_iterator I=timings.begin();I!=timings.end();I++)
+				out << Name << "_max" << LabelSet(Labels,I->first) << " " << Seconds(I->second.MaxNanoseconds_) << "\n";
+		}
+
+		void Write(std::ostream& out,const std::string& Name,const std::string& Help,
+			const std::string& Labels,boost::uint64_t Sent,boost::uint64_t Received)
+		{
+			Header(out,Name,"counter",Help);
+			out << Name << LabelSet(Labels,"direction=\"sent\"") << " " << Sent << "\n";
+			out << Name << LabelSet(Labels,"direction=\"received\"") << " " << Received << "\n";
+		}
+	}
+
+	void WritePrometheus(std::ostream& out,const AssociationStats& stats,const std::string& Labels)
+	{
+		Header(out,"dicom_associations_total","counter","Associations successfully negotiated.");
+		out << "dicom_associations_total" << LabelSet(Labels) << " " << stats.Associations_ << "\n";
+
+		std::map<std::string,Timing> negotiation;
+		negotiation[""]=stats.Negotiation_;
+		Write(out,"dicom_association_negotiation_seconds","A-ASSOCIATE-RQ to A-ASSOCIATE-AC.",Labels,negotiation);
+
+		std::map<std::string,Timing> operations;
+		for(std::map<Command::Code,Timing>::const_iterator I=stats.Operations_.begin();I!=stats.Operations_.end();I++)
+			operations["command=\""+CommandName(I->first)+"\""]+=I->second;
+		Write(out,"dicom_operation_seconds","DIMSE request to final response.",Labels,operations);
+
+		std::map<std::string,Timing> stages;
+		stages["stage=\"handler\""]=stats.Handler_;
+		stages["stage=\"encode\""]=stats.Encode_;
+		stages["stage=\"decode\""]=stats.Decode_;
+		stages["stage=\"send\""]=stats.Send_;
+		stages["stage=\"receive\""]=stats.Receive_;
+		Write(out,"dicom_stage_seconds","Time spent on each message, by what it was spent on.",Labels,stages);
+
+		Write(out,"dicom_messages_total","DIMSE messages, commands and data sets counted separately.",
+			Labels,stats.MessagesSent_,stats.MessagesReceived_);
+		Write(out,"dicom_pdus_total","P-DATA-TF PDUs.",Labels,stats.PDUsSent_,stats.PDUsReceived_);
+		Write(out,"dicom_bytes_total","Bytes of P-DATA-TF PDUs, headers included.",Labels,stats.BytesSent_,stats.BytesReceived_);
+	}
+}//namespace dicom
@@ -0,0 +1,88 @@
+#ifndef ASSOCIATION_STATS_HPP_INCLUDE_GUARD_8061739245
+#define ASSOCIATION_STATS_HPP_INCLUDE_GUARD_8061739245
+#include <map>
+#include <string>
+#include <ostream>
+#include <boost/cstdint.hpp>
+#include "Tag.hpp"
+
+namespace dicom
+{
+	//!How many times something happened, and how long it took.
+	struct Timing
+	{
+		Timing():Count_(0),TotalNanoseconds_(0),MaxNanoseconds_(0){}
+
+		void Add(boost::uint64_t Nanoseconds);
+		Timing& operator+=(const Timing& other);
+
+		boost::uint64_t Count_;
+		boost::uint64_t TotalNanoseconds_;
+		boost::uint64_t MaxNanoseconds_;
+	};
+
+	//!Where an association's time went, and what it sent and received.
+	/*!
+		Kept by every ServiceBase, client and server side, see ServiceBase::GetStats().
+		Stats for several associations can be added together, as Server::GetStats()
+		does.
+
+		So when a peer says its stores are slow, compare Operations_ with where
+		the time went: Receive_ and Send_ (waiting on the network), Decode_ and
+		Encode_ (us), or Handler_ (the application).
+	*/
+	struct AssociationStats
+	{
+		AssociationStats();
+
+		AssociationStats& operator+=(const AssociationStats& other);
+
+		//!How many successfully negotiated associations these stats are for.
+		/*!
+			Rejected or aborted negotiations aren't counted.
+		*/
+		boost::uint64_t Associations_;
+
+		//!From the A-ASSOCIATE-RQ going out (or arriving) to the A-ASSOCIATE-AC arriving (or going out).
+		Timing Negotiation_;
+
+		//!Each request to its final response, by the request's command field, e.g. Command::C_STORE_RQ
+		/*!
+			Pending responses (e.g. each C-FIND match) don't end an operation.
+		*/
+		std::map<Command::Code,Timing> Operations_;
+
+		//!SCP only, time spent in the application's handlers.
+		Timing Handler_;
+
+		//!Per message, commands and data sets alike.
+		Timing Encode_;
+		Timing Decode_;
+
+		//!Per message, putting its P-DATA-TFs on the wire.
+		Timing Send_;
+		//!Per message, from its first P-DATA-TF arriving to its last.
+		Timing Receive_;
+
+		boost::uint64_t MessagesSent_;
+		boost::uint64_t MessagesReceived_;
+		//!P-DATA-TF only, and the bytes in them, headers included.
+		boost::uint64_t PDUsSent_;
+		boost::uint64_t PDUsReceived_;
+		boost::uint64_t BytesSent_;
+		boost::uint64_t BytesReceived_;
+	};
+
+	//!e.g. "C-STORE" for either of Command::C_STORE_RQ and C_STORE_RSP
+	std::string CommandName(Command::Code command);
+
+	//!Write stats in the Prometheus text exposition format.
+	/*!
+		Labels, e.g. aet="ARCHIVE", are added to every sample, so that several
+		servers' stats can be written to the same page.  Timings are written as
+		summaries (_count and _sum, in seconds) with a gauge for the maximum.
+	*/
+	void WritePrometheus(std::ostream& out,const AssociationStats& stats,const std::string& Labels="");
+}//namespace dicom
+
+#endif //ASSOCIATION_STATS_HPP_INCLUDE_GUARD_8061739245
@@ -0,0 +1,636 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include "AsyncAssociation.hpp"
+
+#ifdef __linux__
+
+#include <cstring>
+#include <boost/bind.hpp>
+#include "socket/MemorySocket.hpp"
+#include "Encoder.hpp"
+#include "Decoder.hpp"
+#include "ImplementationUID.hpp"
+#include "UIDs.hpp"
+#include "Profiling.hpp"
+
+namespace dicom
+{
+	using namespace primitive;
+
+
+	namespace
+	{
+		//!PDU headers are always big endian, see Part 8, section 9.3.1
+		UINT32 ReadUINT32(const BYTE* p)
+		{
+			return (UINT32(p[0])<<24)|(UINT32(p[1])<<16)|(UINT32(p[2])<<8)|UINT32(p[3]);
+		}
+
+		void AppendUINT32(std::vector<BYTE>& out,UINT32 n)
+		{
+			out.push_back(BYTE(n>>24));
+			out.push_back(BYTE(n>>16));
+			out.push_back(BYTE(n>>8));
+			out.push_back(BYTE(n));
+		}
+
+		//!Type, reserved byte and length.
+		const size_t PDUHeaderLength=6;
+
+		/*!
+			Association PDUs aren't bound by the negotiated maximum, but anything
+			this size is either broken or hostile.
+		*/
+		const UINT32 MaxAssociationPDULength=1<<20;
+
+		//!How much we try to recv() at a time.
+		const size_t ReadChunk=1<<16;
+
+		//!recv()s per readiness event, so one busy peer can't keep the loop from everyone else.
+		const size_t ReadsPerEvent=4;
+
+		UserInformation OurUserInformation(UINT32 MaxPDULength)
+		{
+			UserInformation UserInfo;
+			MaximumSubLength MaxSubLength(MaxPDULength);
+			UserInfo.ImpClass_.UID_=ImplementationClassUID;
+			UserInfo.ImpVersion_.Name=ImplementationVersionName;
+			UserInfo.SetMax(MaxSubLength);
+			return UserInfo;
+		}
+	}
+
+	AsyncAssociation::AsyncAssociation(int Descriptor,const AssociationHandlers& Handlers,UINT32 MaxPDULength)
+		:Descriptor_(Descriptor),Handlers_(Handlers),MaxPDULength_(MaxPDULength),PeerMaxPDULength_(0)
+		,State_(AWAITING_RQ),OutPosition_(0),Watching_(false),Reading_(true)
+		,InLength_(0),InCapacity_(0),ExpectData_(false)
+	{
+	}
+
+	AsyncAssociation::AsyncAssociation(int Descriptor,const AAssociateRQ& Request,const AssociationHandlers& Handlers,UINT32 MaxPDULength)
+		:Descriptor_(Descriptor),Handlers_(Handlers),Request_(Request),MaxPDULength_(MaxPDULength),PeerMaxPDULength_(0)
+		,State_(CONNECTING),OutPosition_(0),Watching_(true),Reading_(true)
+		,InLength_(0),InCapacity_(0),ExpectData_(false)
+	{
+		UserInformation UserInfo=OurUserInformation(MaxPDULength_);
+		Request_.SetUserInformation(UserInfo);
+		Queue(Request_);
+	}
+
+	AsyncAssociation::~AsyncAssociation()
+	{
+		close(Descriptor_);
+	}
+
+	boost::shared_ptr<AsyncAssociation> AsyncAssociation::Connect(Reactor& reactor,
+		const std::string& Host,short Port,
+		const AAssociateRQ& Request,const AssociationHandlers& Handlers,UINT32 MaxPDULength)
+	{
+		Network::SocketAddress address(Host,Port);
+		int fd=socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+		if(fd<0)
+			throw SystemError("Couldn't allocate socket",Network::GetLastError());
+
+		//we own fd from here on.
+		boost::shared_ptr<AsyncAssociation> association(new AsyncAssociation(fd,Request,Handlers,MaxPDULength));
+
+		if(connect(fd,(sockaddr *)&(address.address_),sizeof(sockaddr))!=0 && errno!=EINPROGRESS)
+			throw SystemError("Connect error",Network::GetLastError());
+
+		//we'll find out whether the connect worked when the socket becomes writable.
+		reactor.Add(association,true);
+		return association;
+	}
+
+	boost::shared_ptr<EventHandler> AsyncAssociation::Accept(int Descriptor,const AssociationHandlers& Handlers,UINT32 MaxPDULength)
+	{
+		return boost::shared_ptr<EventHandler>(new AsyncAssociation(Descriptor,Handlers,MaxPDULength));
+	}
+
+	void AsyncAssociation::Listen(Reactor& reactor,short Port,const AssociationHandlers& Handlers,UINT32 MaxPDULength)
+	{
+		reactor.Listen(Port,boost::bind(&AsyncAssociation::Accept,_1,Handlers,MaxPDULength));
+	}
+
+	AsyncAssociation::State AsyncAssociation::GetState()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return State_;
+	}
+
+	BYTE AsyncAssociation::GetPresentationContextID(const UID& AbstractSyntax) const
+	{
+		//match on ID, the acceptor needn't answer in the order we asked.
+		const std::vector<PresentationContext>& Proposed=Request_.ProposedPresentationContexts_;
+		for(std::vector<PresentationContext>::const_iterator p=Proposed.begin();p!=Proposed.end();++p)
+		{
+			if(!(p->AbsSyntax_.UID_==AbstractSyntax))
+				continue;
+			for(std::vector<PresentationContextAccept>::const_iterator a=Accepted_.begin();a!=Accepted_.end();++a)
+				if(a->PresentationContextID_==p->ID_ && 0==a->Result_)
+					return p->ID_;
+		}
+		throw dicom::exception("Couldn't get Presentation Context ID");
+	}
+
+	TS AsyncAssociation::GetTransferSyntax(BYTE PresentationContextID) const
+	{
+		for(std::vector<PresentationContextAccept>::const_iterator a=Accepted_.begin();a!=Accepted_.end();++a)
+			if(a->PresentationContextID_==PresentationContextID && 0==a->Result_)
+				return TS(a->TrnSyntax_.UID_);
+		throw dicom::exception("Presentation context wasn't accepted");
+	}
+
+	/*!
+		Must be called with mutex_ held.
+	*/
+	template<typename Primitive>
+	void AsyncAssociation::Queue(Primitive& primitive)
+	{
+		Network::MemorySocket socket;
+		primitive.Write(socket);
+		Out_.insert(Out_.end(),socket.Output().begin(),socket.Output().end());
+	}
+
+	/*!
+		Same slicing as ServiceBase::Write(), one PDV per P-DATA-TF.  An empty
+		buffer still gets one (empty) last fragment.  Must be called with mutex_ held.
+	*/
+	void AsyncAssociation::QueuePData(Buffer& buffer,MessageControlHeader::Code msgHead,BYTE PresentationContextID)
+	{
+		const UINT32 MaxChunk=PeerMaxPDULength_ ? PeerMaxPDULength_-6 : UINT32(buffer.size());
+		size_t Position=0;
+		do
+		{
+			const UINT32 Chunk=UINT32(std::min<size_t>(buffer.size()-Position,MaxChunk));
+			const bool Last=(Position+Chunk==buffer.size());
+
+			Out_.push_back(0x04);
+			Out_.push_back(0x00);
+			AppendUINT32(Out_,Chunk+6);
+			AppendUINT32(Out_,Chunk+2);
+			Out_.push_back(PresentationContextID);
+			Out_.push_back(Last ? BYTE(msgHead|MessageControlHeader::LAST_FRAGMENT) : msgHead);
+			Out_.insert(Out_.end(),buffer.begin()+Position,buffer.begin()+Position+Chunk);
+			Position+=Chunk;
+			DICOMLIB_COUNT(PDUS_SENT,1);
+		}
+		while(Position<buffer.size());
+	}
+
+	//!Must be called with mutex_ held.
+	void AsyncAssociation::QueueAbort(BYTE Reason)
+	{
+		AAbortRQ abort_request(AAbortRQ::DICOM_SERVICE_PROVIDER,Reason);
+		Queue(abort_request);
+		State_=CLOSING;
+	}
+
+	/*!
+		Must be called with mutex_ held.  Only used off the reactor thread, the
+		reactor thread flushes for itself at the end of each event.
+	*/
+	void AsyncAssociation::RequestWrite()
+	{
+		if(!Watching_ && State_!=CLOSED)
+		{
+			Watching_=true;
+			WatchWritable(true);
+		}
+	}
+
+	/*!
+		Write as much as the socket will take.  Returns false once there's
+		nothing left to do with this connection.  Must be called with mutex_ held,
+		on the reactor thread.
+	*/
+	bool AsyncAssociation::Flush()
+	{
+		while(OutPosition_<Out_.size())
+		{
+			DICOMLIB_COUNT(SYSCALLS,1);
+			ssize_t n=send(Descriptor_,&Out_[OutPosition_],Out_.size()-OutPosition_,MSG_NOSIGNAL);
+			if(n>0)
+			{
+				OutPosition_+=n;
+				DICOMLIB_COUNT(BYTES_SENT,n);
+			}
+			else if(n<0 && (EAGAIN==errno || EWOULDBLOCK==errno))
+				break;
+			else if(n<0 && EINTR==errno)
+				continue;
+			else
+				return false;
+		}
+		if(OutPosition_==Out_.size())
+		{
+			Out_.clear();
+			OutPosition_=0;
+			if(CLOSING==State_)
+				return false;
+		}
+		bool Want=!Out_.empty();
+		if(Want!=Watching_)
+		{
+			Watching_=Want;
+			WatchWritable(Want);
+		}
+		return true;
+	}
+
+	void AsyncAssociation::Send(BYTE PresentationContextID,const DataSet& Command)
+	{
+		Buffer command(__LITTLE_ENDIAN);
+		WriteToBuffer(Command,command,TS(IMPL_VR_LE_TRANSFER_SYNTAX));//Commands MUST have VR/LE Transfer Syntax.
+
+		boost::mutex::scoped_lock lock(mutex_);
+		if(State_!=ESTABLISHED)
+			throw dicom::exception("Association isn't established");
+		QueuePData(command,MessageControlHeader::COMMAND,PresentationContextID);
+		RequestWrite();
+	}
+
+	void AsyncAssociation::Send(BYTE PresentationContextID,const DataSet& Command,const DataSet& Data)
+	{
+		Buffer command(__LITTLE_ENDIAN);
+		WriteToBuffer(Command,command,TS(IMPL_VR_LE_TRANSFER_SYNTAX));
+
+		TS ts=GetTransferSyntax(PresentationContextID);
+		Buffer data(ts.isBigEndian() ? __BIG_ENDIAN : __LITTLE_ENDIAN);
+		WriteToBuffer(Data,data,ts);
+
+		//both go on together, so messages from different threads can't interleave.
+		boost::mutex::scoped_lock lock(mutex_);
+		if(State_!=ESTABLISHED)
+			throw dicom::exception("Association isn't established");
+		QueuePData(command,MessageControlHeader::COMMAND,PresentationContextID);
+		QueuePData(data,MessageControlHeader::DATASET,PresentationContextID);
+		RequestWrite();
+	}
+
+	void AsyncAssociation::SendPData(const BYTE* Begin,const BYTE* End)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if(State_!=ESTABLISHED)
+			throw dicom::exception("Association isn't established");
+		Out_.insert(Out_.end(),Begin,End);
+		RequestWrite();
+	}
+
+	void AsyncAssociation::Release()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if(State_!=ESTABLISHED)
+			return;
+		AReleaseRQ release_request;
+		Queue(release_request);
+		State_=AWAITING_RP;
+		RequestWrite();
+	}
+
+	void AsyncAssociation::Abort()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if(CLOSING==State_ || CLOSED==State_)
+			return;
+		AAbortRQ abort_request(AAbortRQ::DICOM_SERVICE_USER,AAbortRQ::NO_REASON);
+		Queue(abort_request);
+		State_=CLOSING;
+		RequestWrite();
+	}
+
+	void AsyncAssociation::SuspendReading()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if(Reading_)
+		{
+			Reading_=false;
+			WatchReadable(false);
+		}
+	}
+
+	void AsyncAssociation::ResumeReading()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if(!Reading_)
+		{
+			Reading_=true;
+			WatchReadable(true);
+		}
+	}
+
+	bool AsyncAssociation::OnReadable()
+	{
+		bool PeerClosed=false;
+		/*
+			The descriptor is level triggered, so if there's still something
+			to read after ReadsPerEvent goes we'll be straight back.  Meanwhile
+			the other associations on this loop get a turn, and any responses
+			our handlers have queued go out.
+		*/
+		for(size_t Reads=0;Reads<ReadsPerEvent;Reads++)
+		{
+			{
+				//a handler may have suspended us part way through.
+				boost::mutex::scoped_lock lock(mutex_);
+				if(!Reading_)
+					break;
+			}
+			ReserveIn(InLength_+ReadChunk);
+			DICOMLIB_COUNT(SYSCALLS,1);
+			ssize_t n=recv(Descriptor_,In_.get()+InLength_,ReadChunk,0);
+			if(n>0)
+			{
+				InLength_+=n;
+				DICOMLIB_COUNT(BYTES_RECEIVED,n);
+			}
+			if(0==n)
+			{
+				PeerClosed=true;
+				break;
+			}
+			if(n<0)
+			{
+				if(EINTR==errno)
+					continue;
+				if(EAGAIN==errno || EWOULDBLOCK==errno)
+					break;
+				return false;
+			}
+
+			//handle every complete PDU we've got so far.
+			size_t Used=0;
+			size_t Incomplete=0;
+			while(InLength_-Used>=PDUHeaderLength)
+			{
+				const BYTE* Begin=In_.get()+Used;
+				const UINT32 Length=ReadUINT32(Begin+2);
+				const UINT32 Limit=(0x04==Begin[0]) ? MaxPDULength_ : MaxAssociationPDULength;
+				if(Limit && Length>Limit)
+				{
+					boost::mutex::scoped_lock lock(mutex_);
+					QueueAbort(AAbortRQ::INVALID_PDU_PARAMETER);
+					return Flush();
+				}
+				if(InLength_-Used<PDUHeaderLength+Length)
+				{
+					Incomplete=PDUHeaderLength+Length;
+					break;
+				}
+				if(0x04==Begin[0])
+					DICOMLIB_COUNT(PDUS_RECEIVED,1);
+				if(!HandlePDU(Begin[0],Begin,Begin+PDUHeaderLength+Length))
+					return false;
+				Used+=PDUHeaderLength+Length;
+			}
+
+			//so In_ only ever holds one PDU's worth, however much the peer sends.
+			if(Used)
+			{
+				memmove(In_.get(),In_.get()+Used,InLength_-Used);
+				InLength_-=Used;
+			}
+			//make room for the whole PDU now, rather than growing a chunk at a time.
+			ReserveIn(Incomplete+ReadChunk);
+		}
+
+		boost::mutex::scoped_lock lock(mutex_);
+		if(PeerClosed)
+			return false;
+		return Flush();
+	}
+
+	void AsyncAssociation::ReserveIn(size_t Size)
+	{
+		if(Size<=InCapacity_)
+			return;
+		Size=std::max(Size,2*InCapacity_);
+		boost::scoped_array<BYTE> Bigger(new BYTE[Size]);
+		if(InLength_)
+			memcpy(Bigger.get(),In_.get(),InLength_);
+		In_.swap(Bigger);
+		InCapacity_=Size;
+		DICOMLIB_COUNT(ALLOCATIONS,1);
+	}
+
+	bool AsyncAssociation::OnWritable()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if(CONNECTING==State_)
+		{
+			int Error=0;
+			socklen_t len=sizeof(Error);
+			if(getsockopt(Descriptor_,SOL_SOCKET,SO_ERROR,&Error,&len)<0 || Error!=0)
+				return false;
+			State_=AWAITING_AC;
+		}
+		return Flush();
+	}
+
+	void AsyncAssociation::OnClosed()
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			State_=CLOSED;
+		}
+		if(Handlers_.Closed)
+			Handlers_.Closed(*this);
+	}
+
+	/*!
+		Begin..End is the whole PDU, including its 6 byte header.
+		Returns false if the connection should be closed straight away.
+	*/
+	bool AsyncAssociation::HandlePDU(BYTE Type,const BYTE* Begin,const BYTE* End)
+	{
+		State state=GetState();
+		if(CLOSING==state)
+			return true;//we've already said our last word, ignore anything else.
+
+		//The primitives expect the item type to have been read already.
+		Network::MemorySocket socket(Begin+1,End);
+		switch(Type)
+		{
+		case 0x01:	// A-ASSOCIATE-RQ
+			if(state!=AWAITING_RQ)
+				break;
+			return HandleRequest(Begin,End);
+		case 0x02:	// A-ASSOCIATE-AC
+			{
+				if(state!=AWAITING_AC)
+					break;
+				AAssociateAC acknowledgement;
+				acknowledgement.ReadDynamic(socket);
+				Accepted_=acknowledgement.PresContextAccepts_;
+				PeerMaxPDULength_=acknowledgement.UserInfo_.MaxSubLength_.MaximumLength_;
+				{
+					boost::mutex::scoped_lock lock(mutex_);
+					State_=ESTABLISHED;
+				}
+				if(Handlers_.Established)
+					Handlers_.Established(*this);
+				return true;
+			}
+		case 0x03:	// A-ASSOCIATE-RJ
+			{
+				if(state!=AWAITING_AC)
+					break;
+				AAssociateRJ rejection;
+				rejection.ReadDynamic(socket);
+				if(Handlers_.Rejected)
+					Handlers_.Rejected(*this,rejection);
+				return false;
+			}
+		case 0x04:	// P-DATA-TF
+			//the peer may carry on sending until it sees our release request.
+			if(state!=ESTABLISHED && state!=AWAITING_RP)
+				break;
+			return HandlePData(Begin+PDUHeaderLength,End);
+		case 0x05:	// A-RELEASE-RQ
+			{
+				if(state!=ESTABLISHED && state!=AWAITING_RP)
+					break;
+				AReleaseRP release_response;
+				boost::mutex::scoped_lock lock(mutex_);
+				Queue(release_response);
+				State_=CLOSING;
+				return true;
+			}
+		case 0x06:	// A-RELEASE-RP
+			if(state!=AWAITING_RP)
+				break;
+			return false;
+		case 0x07:	// A-ABORT
+			return false;
+		default:
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				QueueAbort(AAbortRQ::UNRECOGNIZED_PDU);
+				return true;
+			}
+		}
+
+		//A PDU we know, but weren't expecting in this state.
+		boost::mutex::scoped_lock lock(mutex_);
+		QueueAbort(AAbortRQ::UNEXPECTED_PDU);
+		return true;
+	}
+
+	bool AsyncAssociation::HandleRequest(const BYTE* Begin,const BYTE* End)
+	{
+		Network::MemorySocket socket(Begin+1,End);
+		Request_.ReadDynamic(socket);
+		PeerMaxPDULength_=Request_.UserInfo_.MaxSubLength_.MaximumLength_;
+
+		AAssociateAC acknowledgement(Request_.CallingAppTitle_,Request_.CalledAppTitle_);
+		acknowledgement.AppContext_.UID_=APPLICATION_CONTEXT;
+
+		if(Handlers_.Negotiate && Handlers_.Negotiate(Request_,acknowledgement))
+		{
+			UserInformation UserInfo=OurUserInformation(MaxPDULength_);
+			//Requests are handled as they arrive and nothing stops a handler
+			//answering them out of order, so we'll perform as many as the peer
+			//wants to invoke.  We never invoke any ourselves.
+			if(Request_.UserInfo_.HasAsyncOpsWindow_)
+				UserInfo.SetAsyncOperationsWindow(AsyncOperationsWindow(1,Request_.UserInfo_.AsyncOpsWindow_.MaxOperationsInvoked_));
+			acknowledgement.SetUserInformation(UserInfo);
+			Accepted_=acknowledgement.PresContextAccepts_;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				Queue(acknowledgement);
+				State_=ESTABLISHED;
+			}
+			if(Handlers_.Established)
+				Handlers_.Established(*this);
+		}
+		else
+		{
+			AAssociateRJ rejection(AAssociateRJ::REJECTED_PERMANENT,AAssociateRJ::DICOM_SERVICE_USER,AAssociateRJ::NO_REASON);
+			boost::mutex::scoped_lock lock(mutex_);
+			Queue(rejection);
+			State_=CLOSING;
+		}
+		return true;
+	}
+
+	/*!
+		Begin..End is the PDU's list of PDV items, see Part 8, table 9-23
+		and Annex E.  Fragments are collected onto Command_ or Data_ until the
+		last one arrives.
+	*/
+	bool AsyncAssociation::HandlePData(const BYTE* Begin,const BYTE* End)
+	{
+		while(Begin<End)
+		{
+			if(End-Begin<6)
+				break;
+			const UINT32 Length=ReadUINT32(Begin);
+			if(Length<2 || UINT32(End-Begin-4)<Length)
+				break;
+			const BYTE PresentationContextID=Begin[4];
+			const MessageControlHeader::Code msgHead=Begin[5];
+			const BYTE* Data=Begin+6;
+			Begin+=4+Length;
+
+			if(msgHead & MessageControlHeader::COMMAND)
+			{
+				if(ExpectData_)
+					break;
+				Command_.insert(Command_.end(),Data,Begin);
+				if(!(msgHead & MessageControlHeader::LAST_FRAGMENT))
+					continue;
+
+				Pending_.PresentationContextID_=PresentationContextID;
+				Pending_.Command_.clear();
+				Pending_.Data_.clear();
+				Pending_.HasData_=false;
+				ReadFromBuffer(Command_,Pending_.Command_,TS(IMPL_VR_LE_TRANSFER_SYNTAX));
+				Command_.clear();
+
+				UINT16 data_set_status=DataSetStatus::NO_DATA_SET;
+				if(Pending_.Command_.exists(TAG_DATA_SET_TYPE))
+					Pending_.Command_(TAG_DATA_SET_TYPE) >> data_set_status;
+				if(data_set_status==DataSetStatus::NO_DATA_SET)
+					Deliver();
+				else
+					ExpectData_=true;
+			}
+			else
+			{
+				if(!ExpectData_ || PresentationContextID!=Pending_.PresentationContextID_)
+					break;
+				Data_.insert(Data_.end(),Data,Begin);
+				if(!(msgHead & MessageControlHeader::LAST_FRAGMENT))
+					continue;
+
+				TS ts=GetTransferSyntax(PresentationContextID);
+				Data_.SetEndian(ts.isBigEndian() ? __BIG_ENDIAN : __LITTLE_ENDIAN);
+				ReadFromBuffer(Data_,Pending_.Data_,ts);
+				Data_.clear();
+				Pending_.HasData_=true;
+				ExpectData_=false;
+				Deliver();
+			}
+		}
+		if(Begin==End)
+			return true;
+
+		//malformed PDV, or fragments out of order.
+		boost::mutex::scoped_lock lock(mutex_);
+		QueueAbort(AAbortRQ::INVALID_PDU_PARAMETER);
+		return true;
+	}
+
+	void AsyncAssociation::Deliver()
+	{
+		if(Handlers_.Received)
+			Handlers_.Received(*this,Pending_);
+	}
+}//namespace dicom
+
+#endif //__linux__
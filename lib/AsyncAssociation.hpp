@@ -0,0 +1,210 @@
+#ifndef ASYNC_ASSOCIATION_HPP_INCLUDE_GUARD_8124466093
+#define ASYNC_ASSOCIATION_HPP_INCLUDE_GUARD_8124466093
+#include "Reactor.hpp"
+
+#ifdef __linux__
+
+#include <string>
+#include <vector>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/scoped_array.hpp>
+#include "aarq.hpp"
+#include "aaac.hpp"
+#include "aarj.hpp"
+#include "Buffer.hpp"
+#include "pdata.hpp"
+#include "DataSet.hpp"
+#include "TransferSyntax.hpp"
+
+namespace dicom
+{
+	class AsyncAssociation;
+
+	//!A complete DIMSE message, reassembled from as many P-DATA-TF PDUs as it took.
+	struct Message
+	{
+		BYTE PresentationContextID_;
+		DataSet Command_;
+		//!Empty unless HasData_
+		DataSet Data_;
+		bool HasData_;
+	};
+
+	//!What an AsyncAssociation calls when things happen.
+	/*!
+		All of these are called on one of the reactor's threads, so they
+		must not block; anything slow should be handed off elsewhere (e.g.
+		to a ThreadPool) and answered later with AsyncAssociation::Send().
+		Any of them may be left empty.
+	*/
+	struct AssociationHandlers
+	{
+		//!SCP only. Fill in the acknowledgement's presentation contexts and return true, or return false to reject.
+		/*!
+			The acknowledgement arrives with the AE titles and application context
+			filled in, and we fill in the user information after this returns.
+			If this is empty, every association is rejected.
+		*/
+		boost::function<bool (const primitive::AAssociateRQ&,primitive::AAssociateAC&)> Negotiate;
+
+		//!Negotiation is complete, and messages can now be sent.
+		boost::function<void (AsyncAssociation&)> Established;
+
+		//!SCU only.  The peer turned us down.
+		boost::function<void (AsyncAssociation&,const primitive::AAssociateRJ&)> Rejected;
+
+		//!A message has arrived.
+		boost::function<void (AsyncAssociation&,const Message&)> Received;
+
+		//!The association has been released, aborted or lost.  Always the last call.
+		boost::function<void (AsyncAssociation&)> Closed;
+	};
+
+	//!A DICOM association driven by a Reactor instead of blocking reads.
+	/*!
+		This is the Upper Layer state machine of Part 8, section 9.2, built on the
+		same message primitives as ClientConnection.  Incoming bytes are collected
+		until a whole PDU has arrived, which is then parsed from memory, and
+		P-DATA-TF fragments are reassembled into complete messages before being
+		handed to AssociationHandlers::Received.  Outgoing PDUs are queued and
+		written as the socket allows.
+
+		Because nothing here ever blocks, a handful of reactor threads can
+		service thousands of associations, either as SCP (see Listen()) or SCU
+		(see Connect()).  Send(), Release() and Abort() may be called from any thread.
+	*/
+	class AsyncAssociation : public EventHandler, public boost::enable_shared_from_this<AsyncAssociation>
+	{
+	public:
+		enum State
+		{
+			CONNECTING,		//!<SCU, waiting for TCP connect to complete.
+			AWAITING_AC,	//!<SCU, A-ASSOCIATE-RQ sent.
+			AWAITING_RQ,	//!<SCP, waiting for A-ASSOCIATE-RQ.
+			ESTABLISHED,
+			AWAITING_RP,	//!<A-RELEASE-RQ sent.
+			CLOSING,		//!<Closes once everything queued has been sent.
+			CLOSED
+		};
+
+		//!Open an association with a remote SCP.
+		/*!
+			Returns immediately, AssociationHandlers::Established or Rejected
+			tells us how it went.  The user information on Request is filled in for us.
+
+			MaxPDULength is the largest PDU we ask the peer to send us, see
+			Part 8, Annex D.1.  0 means no limit.
+		*/
+		static boost::shared_ptr<AsyncAssociation> Connect(Reactor& reactor,
+			const std::string& Host,short Port,
+			const primitive::AAssociateRQ& Request,const AssociationHandlers& Handlers,
+			UINT32 MaxPDULength=primitive::MaximumSubLength::DefaultMaximumLength_);
+
+		//!Accept associations on Port.
+		static void Listen(Reactor& reactor,short Port,const AssociationHandlers& Handlers,
+			UINT32 MaxPDULength=primitive::MaximumSubLength::DefaultMaximumLength_);
+
+		~AsyncAssociation();
+
+		//!Send a command with no data set.
+		void Send(BYTE PresentationContextID,const DataSet& Command);
+
+		//!Send a command followed by its data set, in the context's transfer syntax.
+		void Send(BYTE PresentationContextID,const DataSet& Command,const DataSet& Data);
+
+		//!Send P-DATA-TF PDUs that have already been encoded, e.g. by ServiceBase::Write().
+		/*!
+			Begin..End must be whole PDUs, already sliced to what the peer can take.
+		*/
+		void SendPData(const BYTE* Begin,const BYTE* End);
+
+		//!Ask the peer to release the association.
+		void Release();
+
+		//!Drop the association without waiting for the peer.
+		void Abort();
+
+		//!Stop reading from the peer until ResumeReading().
+		/*!
+			For when we're being sent requests faster than we can deal with them.
+			Anything already read is still delivered, but after that the peer's
+			data waits in the kernel, and once that's full TCP stops the peer
+			sending.  May be called from any thread.
+		*/
+		void SuspendReading();
+		void ResumeReading();
+
+		State GetState();
+
+		//!The association request, as sent or received.
+		const primitive::AAssociateRQ& GetRequest() const{return Request_;}
+
+		//!Presentation contexts accepted for this association.
+		const std::vector<primitive::PresentationContextAccept>& GetAccepted() const{return Accepted_;}
+
+		//!First accepted presentation context for AbstractSyntax.
+		BYTE GetPresentationContextID(const UID& AbstractSyntax) const;
+
+		//!Transfer syntax accepted for a presentation context.
+		TS GetTransferSyntax(BYTE PresentationContextID) const;
+
+		virtual int GetDescriptor() const{return Descriptor_;}
+		virtual bool OnReadable();
+		virtual bool OnWritable();
+		virtual void OnClosed();
+
+	private:
+		//!SCP
+		AsyncAssociation(int Descriptor,const AssociationHandlers& Handlers,UINT32 MaxPDULength);
+		//!SCU
+		AsyncAssociation(int Descriptor,const primitive::AAssociateRQ& Request,const AssociationHandlers& Handlers,UINT32 MaxPDULength);
+
+		static boost::shared_ptr<EventHandler> Accept(int Descriptor,const AssociationHandlers& Handlers,UINT32 MaxPDULength);
+
+		//!Make sure In_ can hold Size bytes, keeping what's already there.
+		void ReserveIn(size_t Size);
+		bool HandlePDU(BYTE Type,const BYTE* Begin,const BYTE* End);
+		bool HandleRequest(const BYTE* Begin,const BYTE* End);
+		bool HandlePData(const BYTE* Begin,const BYTE* End);
+		void Deliver();
+
+		template<typename Primitive>
+		void Queue(Primitive& primitive);
+		void QueuePData(Buffer& buffer,MessageControlHeader::Code msgHead,BYTE PresentationContextID);
+		void QueueAbort(BYTE Reason);
+		void RequestWrite();
+		bool Flush();
+
+		const int Descriptor_;
+		AssociationHandlers Handlers_;
+		primitive::AAssociateRQ Request_;
+		std::vector<primitive::PresentationContextAccept> Accepted_;
+		//!What we said we can take, 0 means no limit.
+		const UINT32 MaxPDULength_;
+		//!What the peer said it can take, 0 means no limit.
+		UINT32 PeerMaxPDULength_;
+
+		//!Guards everything below, which may be touched by Send() from other threads.
+		boost::mutex mutex_;
+		State State_;
+		std::vector<BYTE> Out_;
+		size_t OutPosition_;
+		bool Watching_;
+		bool Reading_;
+
+		//only touched from the reactor thread.
+		//!Received but not yet handled, In_[0,InLength_).  Not a vector, so recv() space isn't zeroed.
+		boost::scoped_array<BYTE> In_;
+		size_t InLength_;
+		size_t InCapacity_;
+		Buffer Command_;
+		Buffer Data_;
+		//!Message being reassembled.
+		Message Pending_;
+		bool ExpectData_;
+	};
+}//namespace dicom
+
+#endif //__linux__
+
+#endif //ASYNC_ASSOCIATION_HPP_INCLUDE_GUARD_8124466093
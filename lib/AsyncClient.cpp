@@ -0,0 +1,337 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include "AsyncClient.hpp"
+
+#if defined(__cpp_impl_coroutine) && defined(__linux__)
+
+#include <vector>
+#include <boost/bind.hpp>
+#include "AssociationRejection.hpp"
+#include "CommandSets.hpp"
+#include "UIDs.hpp"
+
+namespace dicom
+{
+	using namespace primitive;
+
+	/*!
+		Everything the association's callbacks need to see.  The callbacks hold
+		a reference to this rather than to the client, so it's fine for the client
+		to go away while the association is still winding down.
+	*/
+	struct AsyncClient::Shared
+	{
+		Shared():Established_(false),Closed_(false),NextID_(1){}
+
+		boost::mutex mutex_;
+		bool Established_;
+		bool Closed_;
+		std::vector<AAssociateRJ> Rejection_;
+
+		//!Waiting for the association to be established, or closed.
+		std::coroutine_handle<> StateWaiter_;
+
+		struct Pending
+		{
+			std::deque<Message> Responses_;
+			std::coroutine_handle<> Waiter_;
+		};
+		//!Outstanding operations, by message ID.
+		std::map<UINT16,Pending> Operations_;
+		UINT16 NextID_;
+
+		void OnEstablished(AsyncAssociation&)
+		{
+			std::coroutine_handle<> waiter;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				Established_=true;
+				std::swap(waiter,StateWaiter_);
+			}
+			if(waiter)
+				waiter.resume();
+		}
+
+		void OnRejected(AsyncAssociation&,const AAssociateRJ& rejection)
+		{
+			//Closed follows straight after, and does the waking up.
+			boost::mutex::scoped_lock lock(mutex_);
+			Rejection_.push_back(rejection);
+		}
+
+		void OnReceived(AsyncAssociation&,const Message& message)
+		{
+			if(!message.Command_.exists(TAG_MSG_ID_RSP))
+				return;//a request from the peer, which we don't serve.
+			UINT16 id;
+			message.Command_(TAG_MSG_ID_RSP) >> id;
+
+			std::coroutine_handle<> waiter;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				std::map<UINT16,Pending>::iterator i=Operations_.find(id);
+				if(i==Operations_.end())
+					return;//whoever asked has lost interest.
+				i->second.Responses_.push_back(message);
+				std::swap(waiter,i->second.Waiter_);
+			}
+			if(waiter)
+				waiter.resume();
+		}
+
+		void OnClosed(AsyncAssociation&)
+		{
+			std::vector<std::coroutine_handle<> > waiters;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				Closed_=true;
+				if(StateWaiter_)
+					waiters.push_back(std::exchange(StateWaiter_,nullptr));
+				for(std::map<UINT16,Pending>::iterator i=Operations_.begin();i!=Operations_.end();++i)
+					if(i->second.Waiter_)
+						waiters.push_back(std::exchange(i->second.Waiter_,nullptr));
+			}
+			for(size_t i=0;i<waiters.size();i++)
+				waiters[i].resume();
+		}
+	};
+
+	//!Suspends until the association changes state, or a response arrives.
+	class AsyncClient::Awaiter
+	{
+	public:
+		enum Until
+		{
+			ESTABLISHED,	//!<or closed
+			CLOSED,
+			RESPONSE		//!<or closed
+		};
+
+		Awaiter(Shared& shared,Until until,UINT16 MessageID=0)
+			:shared_(shared),until_(until),id_(MessageID){}
+
+		bool await_ready()
+		{
+			boost::mutex::scoped_lock lock(shared_.mutex_);
+			return Ready();
+		}
+
+		bool await_suspend(std::coroutine_handle<> h)
+		{
+			/*
+				We're allowed to be resumed from another thread as soon as h is
+				stored, so nothing may touch *this after the lock is released.
+			*/
+			boost::mutex::scoped_lock lock(shared_.mutex_);
+			if(Ready())
+				return false;
+			if(RESPONSE==until_)
+				shared_.Operations_[id_].Waiter_=h;
+			else
+				shared_.StateWaiter_=h;
+			return true;
+		}
+
+		Message await_resume()
+		{
+			boost::mutex::scoped_lock lock(shared_.mutex_);
+			Message message;
+			if(RESPONSE==until_)
+			{
+				std::deque<Message>& responses=shared_.Operations_[id_].Responses_;
+				if(responses.empty())
+					throw AssociationClosed();
+				message=responses.front();
+				responses.pop_front();
+			}
+			return message;
+		}
+
+	private:
+		bool Ready()
+		{
+			if(shared_.Closed_)
+				return true;
+			switch(until_)
+			{
+			case ESTABLISHED:
+				return shared_.Established_;
+			case RESPONSE:
+				return !shared_.Operations_[id_].Responses_.empty();
+			default:
+				return false;
+			}
+		}
+
+		Shared& shared_;
+		const Until until_;
+		const UINT16 id_;
+	};
+
+	//!Registers a message ID for as long as an operation is waiting on it.
+	class AsyncClient::Operation : boost::noncopyable
+	{
+	public:
+		Operation(Shared& shared):shared_(shared)
+		{
+			boost::mutex::scoped_lock lock(shared_.mutex_);
+			do
+			{
+				ID_=shared_.NextID_;
+				shared_.NextID_+=2;//stays odd, so never 0.
+			}
+			while(shared_.Operations_.count(ID_));
+			shared_.Operations_[ID_];
+		}
+		~Operation()
+		{
+			boost::mutex::scoped_lock lock(shared_.mutex_);
+			shared_.Operations_.erase(ID_);
+		}
+		UINT16 ID_;
+	private:
+		Shared& shared_;
+	};
+
+	AsyncClient::AsyncClient(boost::shared_ptr<Shared> shared,boost::shared_ptr<AsyncAssociation> association)
+		:shared_(shared),association_(association)
+	{
+	}
+
+	AsyncClient::~AsyncClient()
+	{
+		association_->Release();
+	}
+
+	AsyncClient::Awaiter AsyncClient::Response(UINT16 MessageID)
+	{
+		return Awaiter(*shared_,Awaiter::RESPONSE,MessageID);
+	}
+
+	Task<boost::shared_ptr<AsyncClient> > AsyncClient::Connect(Reactor& reactor,
+		std::string Host,short Port,std::string LocalAET,std::string RemoteAET,
+		PresentationContexts ProposedPresentationContexts)
+	{
+		boost::shared_ptr<Shared> shared(new Shared);
+		AssociationHandlers handlers;
+		handlers.Established=boost::bind(&Shared::OnEstablished,shared,_1);
+		handlers.Rejected=boost::bind(&Shared::OnRejected,shared,_1,_2);
+		handlers.Received=boost::bind(&Shared::OnReceived,shared,_1,_2);
+		handlers.Closed=boost::bind(&Shared::OnClosed,shared,_1);
+
+		AAssociateRQ request(LocalAET,RemoteAET);
+		request.ProposedPresentationContexts_=ProposedPresentationContexts;
+
+		boost::shared_ptr<AsyncAssociation> association=
+			AsyncAssociation::Connect(reactor,Host,Port,request,handlers);
+
+		co_await Awaiter(*shared,Awaiter::ESTABLISHED);
+		{
+			boost::mutex::scoped_lock lock(shared->mutex_);
+			if(!shared->Established_)
+			{
+				if(!shared->Rejection_.empty())
+				{
+					const AAssociateRJ& rejection=shared->Rejection_.front();
+					throw AssociationRejection(rejection.Result_,rejection.Source_,rejection.Reason_);
+				}
+				throw AssociationClosed();
+			}
+		}
+		co_return boost::shared_ptr<AsyncClient>(new AsyncClient(shared,association));
+	}
+
+	Task<DataSet> AsyncClient::EchoAsync()
+	{
+		BYTE pcid=association_->GetPresentationContextID(VERIFICATION_SOP_CLASS);
+		Operation operation(*shared_);
+		CommandSet::CEchoRQ rq(operation.ID_,VERIFICATION_SOP_CLASS);
+		association_->Send(pcid,rq);
+		Message response=co_await Response(operation.ID_);
+		co_return response.Command_;
+	}
+
+	Task<DataSet> AsyncClient::StoreAsync(DataSet data)
+	{
+		UID classUID(data(TAG_SOP_CLASS_UID).Get<UID>());
+		UID instUID(data(TAG_SOP_INST_UID).Get<UID>());
+		BYTE pcid=association_->GetPresentationContextID(classUID);
+
+		Operation operation(*shared_);
+		CommandSet::CStoreRQ rq(operation.ID_,classUID,instUID);
+		association_->Send(pcid,rq,data);
+		Message response=co_await Response(operation.ID_);
+		co_return response.Command_;
+	}
+
+	AsyncGenerator<DataSet> AsyncClient::FindAsync(DataSet query,QueryRetrieve::Root root)
+	{
+		UID classUID=QueryRetrieve::FindSOPClass(root);
+		BYTE pcid=association_->GetPresentationContextID(classUID);
+
+		Operation operation(*shared_);
+		CommandSet::CFindRQ rq(operation.ID_,classUID);
+		association_->Send(pcid,rq,query);
+
+		for(;;)
+		{
+			Message response=co_await Response(operation.ID_);
+			UINT16 status;
+			response.Command_(TAG_STATUS) >> status;
+			if(status!=Status::PENDING && status!=Status::PENDING1)
+			{
+				if(status!=Status::SUCCESS && status!=Status::CANCEL)
+					throw QueryFailed(status,response.Command_);
+				break;
+			}
+			if(response.HasData_)
+				co_yield response.Data_;
+		}
+	}
+
+	AsyncGenerator<MoveProgress> AsyncClient::MoveAsync(std::string destination,DataSet query,QueryRetrieve::Root root)
+	{
+		UID classUID=QueryRetrieve::MoveSOPClass(root);
+		BYTE pcid=association_->GetPresentationContextID(classUID);
+
+		Operation operation(*shared_);
+		CommandSet::CMoveRQ rq(operation.ID_,classUID,destination);
+		association_->Send(pcid,rq,query);
+
+		for(;;)
+		{
+			Message response=co_await Response(operation.ID_);
+			MoveProgress progress={};
+			const DataSet& command=response.Command_;
+			command(TAG_STATUS) >> progress.Status_;
+			//sub-operation counts are optional in the final response.
+			if(command.exists(TAG_NUM_REMAIN_SUBOP))
+				command(TAG_NUM_REMAIN_SUBOP) >> progress.Remaining_;
+			if(command.exists(TAG_NUM_COMPL_SUBOP))
+				command(TAG_NUM_COMPL_SUBOP) >> progress.Completed_;
+			if(command.exists(TAG_NUM_FAIL_SUBOP))
+				command(TAG_NUM_FAIL_SUBOP) >> progress.Failed_;
+			if(command.exists(TAG_NUM_WARN_SUBOP))
+				command(TAG_NUM_WARN_SUBOP) >> progress.Warning_;
+			progress.Response_=command;
+
+			bool Pending=(progress.Status_==Status::PENDING || progress.Status_==Status::PENDING1);
+			co_yield progress;
+			if(!Pending)
+				break;
+		}
+	}
+
+	Task<void> AsyncClient::ReleaseAsync()
+	{
+		association_->Release();
+		co_await Awaiter(*shared_,Awaiter::CLOSED);
+	}
+}//namespace dicom
+
+#endif //__cpp_impl_coroutine && __linux__
@@ -0,0 +1,117 @@
+#ifndef ASYNC_CLIENT_HPP_INCLUDE_GUARD_4419730561
+#define ASYNC_CLIENT_HPP_INCLUDE_GUARD_4419730561
+#include "Coroutine.hpp"
+#include "AsyncAssociation.hpp"
+
+#if defined(__cpp_impl_coroutine) && defined(__linux__)
+
+#include <deque>
+#include <map>
+#include "PresentationContexts.hpp"
+#include "QueryRetrieve.hpp"
+
+namespace dicom
+{
+	//!Thrown out of a pending operation if the association goes away underneath it.
+	struct AssociationClosed : public dicom::exception
+	{
+		AssociationClosed():dicom::exception("Association closed"){}
+		virtual ~AssociationClosed() throw(){}
+	};
+
+	//!Thrown out of FindAsync if the final response is neither success nor cancel.
+	struct QueryFailed : public dicom::exception
+	{
+		QueryFailed(UINT16 Status,const DataSet& Response)
+			:dicom::exception("C-FIND failed"),Status_(Status),Response_(Response){}
+		virtual ~QueryFailed() throw(){}
+		UINT16 Status_;
+		//!The full response command set.
+		DataSet Response_;
+	};
+
+	//!One C-MOVE response, see Part 7, section 9.1.4
+	struct MoveProgress
+	{
+		UINT16 Status_;
+		UINT16 Remaining_;
+		UINT16 Completed_;
+		UINT16 Failed_;
+		UINT16 Warning_;
+		//!The full response command set.
+		DataSet Response_;
+	};
+
+	//!Coroutine flavoured ClientConnection.
+	/*!
+		Each operation is a coroutine that sends its request and then suspends
+		until the responses come back, instead of blocking a thread:
+		<pre>
+			Task<void> Archive(AsyncClient& client,DataSet ds)
+			{
+				DataSet response=co_await client.StoreAsync(ds);
+				...
+			}
+		</pre>
+		Operations are matched to their responses by message ID, so any number
+		of them may be outstanding on one association at once, and with a
+		one-thread Reactor many queries against many PACS can run from a
+		single thread.
+
+		Coroutines are resumed on the reactor's threads.  The client must
+		outlive any operation started on it.
+	*/
+	class AsyncClient : boost::noncopyable
+	{
+	public:
+		//!Connect and negotiate an association.
+		/*!
+			Throws AssociationRejection if the peer turns us down, or
+			AssociationClosed if the connection fails.
+		*/
+		static Task<boost::shared_ptr<AsyncClient> > Connect(Reactor& reactor,
+			std::string Host,short Port,std::string LocalAET,std::string RemoteAET,
+			PresentationContexts ProposedPresentationContexts);
+
+		//!Releases the association if that hasn't been done already.
+		~AsyncClient();
+
+		//!Returns the response command set.
+		Task<DataSet> EchoAsync();
+
+		//!Returns the response command set.
+		Task<DataSet> StoreAsync(DataSet data);
+
+		//!Yields each matching identifier as it arrives.
+		/*!
+			Finishes quietly on Status::SUCCESS or Status::CANCEL, any other
+			final status is thrown as QueryFailed.
+		*/
+		AsyncGenerator<DataSet> FindAsync(DataSet query,QueryRetrieve::Root root=QueryRetrieve::STUDY_ROOT);
+
+		//!Yields every response, pending ones first, the last one holding the final status.
+		AsyncGenerator<MoveProgress> MoveAsync(std::string destination,DataSet query,QueryRetrieve::Root root=QueryRetrieve::STUDY_ROOT);
+
+		//!Completes once the peer has agreed to release.
+		Task<void> ReleaseAsync();
+
+		AsyncAssociation& GetAssociation(){return *association_;}
+
+	private:
+		struct Shared;
+		class Awaiter;
+		class Operation;
+
+		AsyncClient(boost::shared_ptr<Shared> shared,boost::shared_ptr<AsyncAssociation> association);
+
+		//!Next response to MessageID.
+		Awaiter Response(UINT16 MessageID);
+
+		boost::shared_ptr<Shared> shared_;
+		boost::shared_ptr<AsyncAssociation> association_;
+	};
+}//namespace dicom
+
+#endif //__cpp_impl_coroutine && __linux__
+
+#endif //ASYNC_CLIENT_HPP_INCLUDE_GUARD_4419730561
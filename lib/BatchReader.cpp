@@ -0,0 +1,501 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include "BatchReader.hpp"
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <boost/bind.hpp>
+#include "ThreadPool.hpp"
+#include "Exceptions.hpp"
+#ifdef _WIN32
+	#include <io.h>
+#else
+	#include <unistd.h>
+#endif
+#ifdef DICOMLIB_IO_URING
+	#include <linux/io_uring.h>
+	#include <sys/mman.h>
+	#include <sys/syscall.h>
+	#include <sys/uio.h>
+#endif
+
+#ifndef O_BINARY
+	#define O_BINARY 0
+#endif
+#ifndef O_CLOEXEC
+	#define O_CLOEXEC 0
+#endif
+
+namespace dicom
+{
+	struct BatchReader::Slot
+	{
+		Slot():Index_(0),Memory_(0),fd_(-1),Size_(0),Sized_(false),Done_(0),Error_(0){}
+
+		//!Where its file goes: its own part of the registered memory, or Large_.
+		BYTE* Target()
+		{
+			return Large_.empty() ? Memory_ : &Large_[0];
+		}
+
+		size_t Index_;
+		BYTE* Memory_;
+		//!For files that don't fit in a slot.
+		std::vector<BYTE> Large_;
+		std::string Path_;
+		int fd_;
+		size_t Size_;
+		//!Do we know Size_, or is it just what we're reading to?
+		bool Sized_;
+		size_t Done_;
+		int Error_;
+#ifdef DICOMLIB_IO_URING
+		struct statx Stat_;
+#endif
+	};
+
+#ifdef DICOMLIB_IO_URING
+	namespace
+	{
+		//!What a completion is for, in the low bits of its user_data, above which is the slot.
+		enum Operation{OPEN,STAT,READ,CLOSE};
+
+		__u64 UserData(size_t Slot,Operation operation)
+		{
+			return (__u64(Slot)<<8)|operation;
+		}
+
+		//!The biggest read we ask for at once; longer files take more than one.
+		const size_t MaxRead=1<<30;
+	}
+
+	/*!
+		The ring, set up with the raw system calls rather than liburing, so
+		that all we need is the kernel's header.  See io_uring(7) for what
+		the fields and the memory ordering are about.
+	*/
+	struct BatchReader::Ring : boost::noncopyable
+	{
+		Ring():fd_(-1),SQRing_(MAP_FAILED),CQRing_(MAP_FAILED),SQEs_(MAP_FAILED),Tail_(0),ToSubmit_(0),Fixed_(false){}
+
+		~Ring()
+		{
+			if(SQEs_!=MAP_FAILED)
+				munmap(SQEs_,SQEsSize_);
+			if(CQRing_!=MAP_FAILED && CQRing_!=SQRing_)
+				munmap(CQRing_,CQRingSize_);
+			if(SQRing_!=MAP_FAILED)
+				munmap(SQRing_,SQRingSize_);
+			if(fd_>=0)
+				close(fd_);
+		}
+
+		//!False if the kernel won't give us a ring that can do what we need.
+		bool Setup(unsigned Entries)
+		{
+			io_uring_params params;
+			std::memset(&params,0,sizeof(params));
+			fd_=int(syscall(__NR_io_uring_setup,Entries,&params));
+			if(fd_<0)
+				return false;
+
+			SQRingSize_=params.sq_off.array+params.sq_entries*sizeof(__u32);
+			CQRingSize_=params.cq_off.cqes+params.cq_entries*sizeof(io_uring_cqe);
+			const bool Single=(params.features & IORING_FEAT_SINGLE_MMAP)!=0;
+			if(Single)
+				SQRingSize_=CQRingSize_=std::max(SQRingSize_,CQRingSize_);
+			SQRing_=mmap(0,SQRingSize_,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd_,IORING_OFF_SQ_RING);
+			if(SQRing_==MAP_FAILED)
+				return false;
+			CQRing_=Single ? SQRing_ : mmap(0,CQRingSize_,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd_,IORING_OFF_CQ_RING);
+			if(CQRing_==MAP_FAILED)
+				return false;
+			SQEsSize_=params.sq_entries*sizeof(io_uring_sqe);
+			SQEs_=mmap(0,SQEsSize_,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,fd_,IORING_OFF_SQES);
+			if(SQEs_==MAP_FAILED)
+				return false;
+
+			char* sq=static_cast<char*>(SQRing_);
+			SQHead_=reinterpret_cast<__u32*>(sq+params.sq_off.head);
+			SQTail_=reinterpret_cast<__u32*>(sq+params.sq_off.tail);
+			SQMask_=*reinterpret_cast<__u32*>(sq+params.sq_off.ring_mask);
+			SQEntries_=params.sq_entries;
+			SQArray_=reinterpret_cast<__u32*>(sq+params.sq_off.array);
+			char* cq=static_cast<char*>(CQRing_);
+			CQHead_=reinterpret_cast<__u32*>(cq+params.cq_off.head);
+			CQTail_=reinterpret_cast<__u32*>(cq+params.cq_off.tail);
+			CQMask_=*reinterpret_cast<__u32*>(cq+params.cq_off.ring_mask);
+			CQEs_=reinterpret_cast<io_uring_cqe*>(cq+params.cq_off.cqes);
+			Tail_=*SQTail_;
+
+			return Supports(IORING_OP_OPENAT) && Supports(IORING_OP_STATX)
+				&& Supports(IORING_OP_READ) && Supports(IORING_OP_CLOSE);
+		}
+
+		bool Supports(unsigned Op)
+		{
+			const size_t Ops=256;
+			std::vector<char> memory(sizeof(io_uring_probe)+Ops*sizeof(io_uring_probe_op),0);
+			io_uring_probe* probe=reinterpret_cast<io_uring_probe*>(&memory[0]);
+			if(syscall(__NR_io_uring_register,fd_,IORING_REGISTER_PROBE,probe,Ops)<0)
+				return false;
+			return Op<=probe->last_op && (probe->ops[Op].flags & IO_URING_OP_SUPPORTED);
+		}
+
+		//!So reads into them can be IORING_OP_READ_FIXED.  Not fatal if it fails, e.g. on RLIMIT_MEMLOCK.
+		void Register(BYTE* Memory,size_t SlotSize,size_t Slots)
+		{
+			std::vector<iovec> buffers(Slots);
+			for(size_t i=0;i<Slots;i++)
+			{
+				buffers[i].iov_base=Memory+i*SlotSize;
+				buffers[i].iov_len=SlotSize;
+			}
+			Fixed_=(0==syscall(__NR_io_uring_register,fd_,IORING_REGISTER_BUFFERS,&buffers[0],unsigned(Slots)));
+		}
+
+		//!The next submission queue entry, cleared.
+		io_uring_sqe* Get()
+		{
+			while(Tail_-__atomic_load_n(SQHead_,__ATOMIC_ACQUIRE)>=SQEntries_)
+				Submit(0);//full, which it shouldn't be, as we size it for every slot's worth.
+			const __u32 Index=Tail_ & SQMask_;
+			io_uring_sqe* sqe=static_cast<io_uring_sqe*>(SQEs_)+Index;
+			std::memset(sqe,0,sizeof(*sqe));
+			SQArray_[Index]=Index;
+			Tail_++;
+			ToSubmit_++;
+			return sqe;
+		}
+
+		//!Submit what's been queued, and wait for at least WaitFor completions.
+		void Submit(unsigned WaitFor)
+		{
+			__atomic_store_n(SQTail_,Tail_,__ATOMIC_RELEASE);
+			for(;;)
+			{
+				const int submitted=int(syscall(__NR_io_uring_enter,fd_,ToSubmit_,WaitFor,WaitFor ? IORING_ENTER_GETEVENTS : 0,0,0));
+				if(submitted>=0)
+				{
+					ToSubmit_-=std::min(ToSubmit_,unsigned(submitted));
+					if(0==ToSubmit_ || WaitFor)
+						return;
+				}
+				else if(errno!=EINTR && errno!=EAGAIN && errno!=EBUSY)
+					throw dicom::exception(std::string("io_uring_enter: ")+std::strerror(errno));
+			}
+		}
+
+		//!The next completion, if there is one.
+		bool Next(io_uring_cqe& cqe)
+		{
+			const __u32 Head=*CQHead_;
+			if(Head==__atomic_load_n(CQTail_,__ATOMIC_ACQUIRE))
+				return false;
+			cqe=CQEs_[Head & CQMask_];
+			__atomic_store_n(CQHead_,Head+1,__ATOMIC_RELEASE);
+			return true;
+		}
+
+		int fd_;
+		void* SQRing_;
+		void* CQRing_;
+		void* SQEs_;
+		size_t SQRingSize_,CQRingSize_,SQEsSize_;
+		__u32 *SQHead_,*SQTail_,*SQArray_,*CQHead_,*CQTail_;
+		__u32 SQMask_,SQEntries_,CQMask_;
+		io_uring_cqe* CQEs_;
+		//!Where the next entry goes, ahead of the kernel's tail until we Submit().
+		__u32 Tail_;
+		unsigned ToSubmit_;
+		bool Fixed_;
+	};
+#else
+	struct BatchReader::Ring
+	{
+	};
+#endif//DICOMLIB_IO_URING
+
+	BatchReader::BatchReader(ThreadPool* Workers,size_t Depth,size_t SlotSize)
+		:Workers_(Workers),SlotSize_(std::max<size_t>(SlotSize,1)),Depth_(std::max<size_t>(Depth,1))
+		,Memory_(Depth_*SlotSize_),Slots_(new Slot[Depth_])
+	{
+		for(size_t i=0;i<Depth_;i++)
+		{
+			Slots_[i].Index_=i;
+			Slots_[i].Memory_=&Memory_[i*SlotSize_];
+			Free_.push_back(&Slots_[i]);
+		}
+#ifdef DICOMLIB_IO_URING
+		/*
+			One entry per slot is waited for at a time, plus closes, which we
+			don't wait for.
+		*/
+		Ring_.reset(new Ring);
+		if(Ring_->Setup(unsigned(2*Depth_)))
+			Ring_->Register(&Memory_[0],SlotSize_,Depth_);
+		else
+			Ring_.reset();
+#endif
+	}
+
+	BatchReader::~BatchReader()
+	{
+	}
+
+	bool BatchReader::UsingIoUring() const
+	{
+		return Ring_.get()!=0;
+	}
+
+	void BatchReader::Read(const std::vector<std::string>& Paths,const Handler& handler)
+	{
+		if(Ring_)
+			ReadWithRing(Paths,handler);
+		else
+			ReadOneByOne(Paths,handler);
+
+		//Every slot back means every handler has returned.
+		boost::mutex::scoped_lock lock(mutex_);
+		while(Free_.size()<Depth_)
+			released_.wait(lock);
+	}
+
+	BatchReader::Slot* BatchReader::Acquire(bool Wait)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		while(Wait && Free_.empty())
+			released_.wait(lock);
+		if(Free_.empty())
+			return 0;
+		Slot* slot=Free_.back();
+		Free_.pop_back();
+		return slot;
+	}
+
+	void BatchReader::Finish(Slot* slot,const Handler& handler)
+	{
+		if(Workers_)
+			Workers_->Post(boost::bind(&BatchReader::Handle,this,slot,handler));
+		else
+			Handle(slot,handler);
+	}
+
+	void BatchReader::Handle(Slot* slot,const Handler& handler)
+	{
+		BatchFile file;
+		file.Path_=slot->Path_;
+		file.Error_=slot->Error_;
+		file.Data_=slot->Error_ ? 0 : slot->Target();
+		file.Size_=slot->Error_ ? 0 : slot->Size_;
+		handler(file);
+		Release(slot);
+	}
+
+	void BatchReader::Release(Slot* slot)
+	{
+		std::vector<BYTE>().swap(slot->Large_);
+		boost::mutex::scoped_lock lock(mutex_);
+		Free_.push_back(slot);
+		released_.notify_all();
+	}
+
+	void BatchReader::ReadOneByOne(const std::vector<std::string>& Paths,const Handler& handler)
+	{
+		for(std::vector<std::string>::const_iterator I=Paths.begin();I!=Paths.end();I++)
+		{
+			Slot* slot=Acquire(true);
+			slot->Path_=*I;
+			slot->Size_=slot->Done_=0;
+			slot->Error_=0;
+
+			const int fd=open(I->c_str(),O_RDONLY|O_BINARY|O_CLOEXEC);
+			struct stat Stat;
+			if(fd<0 || fstat(fd,&Stat)<0)
+				slot->Error_=errno;
+			else
+			{
+				slot->Size_=size_t(Stat.st_size);
+				if(slot->Size_>SlotSize_)
+					slot->Large_.resize(slot->Size_);
+				while(slot->Done_<slot->Size_)
+				{
+					const int got=int(read(fd,slot->Target()+slot->Done_,unsigned(std::min<size_t>(slot->Size_-slot->Done_,1<<30))));
+					if(got<0 && errno==EINTR)
+						continue;
+					if(got<0)
+					{
+						slot->Error_=errno;
+						break;
+					}
+					if(0==got)//it's shrunk since we looked.
+						slot->Size_=slot->Done_;
+					slot->Done_+=got;
+				}
+			}
+			if(fd>=0)
+				close(fd);
+			Finish(slot,handler);
+		}
+	}
+
+#ifdef DICOMLIB_IO_URING
+	/*
+		Each file goes through:
+		- an open
+		- a read of a slot's worth.  If it comes back short, that's the file.
+		- otherwise, a statx for its size, and reads for the rest
+		- a close, which we don't wait for, and the handler.
+		So a file that fits in a slot costs three entries, and one trip
+		round the ring for each of the open and the read.
+	*/
+	void BatchReader::ReadWithRing(const std::vector<std::string>& Paths,const Handler& handler)
+	{
+		Ring& ring=*Ring_;
+		size_t Next=0;
+		//Entries submitted that haven't completed, closes included.
+		size_t Outstanding=0;
+		//Slots with a file being opened or read.
+		size_t Busy=0;
+
+		struct Local
+		{
+			static void SubmitRead(Ring& ring,Slot& slot,size_t& Outstanding)
+			{
+				io_uring_sqe* sqe=ring.Get();
+				const bool Fixed=ring.Fixed_ && slot.Large_.empty();
+				sqe->opcode=Fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+				sqe->fd=slot.fd_;
+				sqe->addr=__u64(reinterpret_cast<uintptr_t>(slot.Target()+slot.Done_));
+				sqe->len=__u32(std::min(slot.Size_-slot.Done_,MaxRead));
+				sqe->off=slot.Done_;
+				if(Fixed)
+					sqe->buf_index=__u16(slot.Index_);
+				sqe->user_data=UserData(slot.Index_,READ);
+				Outstanding++;
+			}
+
+			static void SubmitStat(Ring& ring,Slot& slot,size_t& Outstanding)
+			{
+				io_uring_sqe* sqe=ring.Get();
+				sqe->opcode=IORING_OP_STATX;
+				sqe->fd=AT_FDCWD;
+				sqe->addr=__u64(reinterpret_cast<uintptr_t>(slot.Path_.c_str()));
+				sqe->len=STATX_SIZE;
+				sqe->off=__u64(reinterpret_cast<uintptr_t>(&slot.Stat_));
+				sqe->user_data=UserData(slot.Index_,STAT);
+				Outstanding++;
+			}
+
+			static void SubmitClose(Ring& ring,Slot& slot,size_t& Outstanding)
+			{
+				if(slot.fd_<0)
+					return;
+				io_uring_sqe* sqe=ring.Get();
+				sqe->opcode=IORING_OP_CLOSE;
+				sqe->fd=slot.fd_;
+				sqe->user_data=UserData(slot.Index_,CLOSE);
+				slot.fd_=-1;
+				Outstanding++;
+			}
+		};
+
+		while(Next<Paths.size() || Outstanding)
+		{
+			//Start as many files as there are slots for.
+			while(Next<Paths.size())
+			{
+				Slot* slot=Acquire(0==Busy && 0==Outstanding);
+				if(!slot)
+					break;
+				slot->Path_=Paths[Next++];
+				slot->fd_=-1;
+				slot->Size_=SlotSize_;//until we know better.
+				slot->Sized_=false;
+				slot->Done_=0;
+				slot->Error_=0;
+
+				io_uring_sqe* sqe=ring.Get();
+				sqe->opcode=IORING_OP_OPENAT;
+				sqe->fd=AT_FDCWD;
+				sqe->addr=__u64(reinterpret_cast<uintptr_t>(slot->Path_.c_str()));
+				sqe->open_flags=O_RDONLY|O_CLOEXEC;
+				sqe->user_data=UserData(slot->Index_,OPEN);
+				Outstanding++;
+				Busy++;
+			}
+
+			if(0==Outstanding)
+				continue;//everything's with the handlers, and Acquire() waited for a slot back.
+			ring.Submit(1);
+
+			io_uring_cqe cqe;
+			while(ring.Next(cqe))
+			{
+				Outstanding--;
+				const Operation operation=Operation(cqe.user_data & 0xff);
+				if(CLOSE==operation)
+					continue;
+				Slot& slot=Slots_[size_t(cqe.user_data>>8)];
+
+				if(cqe.res<0)
+				{
+					if(READ==operation && (-cqe.res==EINTR || -cqe.res==EAGAIN))
+					{
+						Local::SubmitRead(ring,slot,Outstanding);
+						continue;
+					}
+					slot.Error_=-cqe.res;
+				}
+				else if(OPEN==operation)
+					slot.fd_=cqe.res;
+				else if(STAT==operation)
+				{
+					slot.Sized_=true;
+					slot.Size_=std::max(size_t(slot.Stat_.stx_size),slot.Done_);
+					if(slot.Size_>SlotSize_)
+					{
+						slot.Large_.resize(slot.Size_);
+						std::memcpy(&slot.Large_[0],slot.Memory_,slot.Done_);
+					}
+				}
+				else if(READ==operation)
+				{
+					slot.Done_+=size_t(cqe.res);
+					//Short: the end of a file that fits, or one that's shrunk since we looked.
+					if(slot.Done_<slot.Size_ && (!slot.Sized_ || 0==cqe.res))
+						slot.Size_=slot.Done_;
+					else if(!slot.Sized_)
+					{
+						//Filled the slot, so there may be more.
+						Local::SubmitStat(ring,slot,Outstanding);
+						continue;
+					}
+				}
+
+				if(!slot.Error_ && slot.Done_<slot.Size_)
+				{
+					Local::SubmitRead(ring,slot,Outstanding);
+					continue;
+				}
+				Local::SubmitClose(ring,slot,Outstanding);
+				Busy--;
+				Finish(&slot,handler);
+			}
+		}
+	}
+#else
+	void BatchReader::ReadWithRing(const std::vector<std::string>& Paths,const Handler& handler)
+	{
+		ReadOneByOne(Paths,handler);
+	}
+#endif//DICOMLIB_IO_URING
+}//namespace dicom
@@ -0,0 +1,107 @@
+#ifndef BATCH_READER_HPP_INCLUDE_GUARD_2958301746
+#define BATCH_READER_HPP_INCLUDE_GUARD_2958301746
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/scoped_array.hpp>
+#include "Types.hpp"
+
+namespace dicom
+{
+	class ThreadPool;
+
+	//!A whole file, as read by a BatchReader.
+	struct BatchFile
+	{
+		std::string Path_;
+		//!0 if it was read, otherwise the errno of whatever failed.
+		int Error_;
+		//!Only valid until the handler it's passed to returns.
+		const BYTE* Data_;
+		size_t Size_;
+	};
+
+	//!Reads many files at once, with as few system calls per file as possible.
+	/*!
+		When there are tens of millions of small files to get through, the
+		open(), fstat(), read() and close() for each of them cost more than
+		decoding it does.  On Linux (if built with DICOMLIB_IO_URING) this
+		puts the opens, reads and closes (and stats, for files too big for a
+		slot) of up to Depth files at a time on an io_uring, submitted and
+		reaped a batch per system call, reading into buffers registered with
+		the kernel.  Elsewhere, or if the kernel
+		won't give us a ring (it's older than 5.6, or io_uring is disabled),
+		it falls back to doing the same with a read() per file, one file at a
+		time.
+
+		Each file is handed to the handler as it's finished, on Workers if
+		there are some, otherwise on the thread calling Read().  Usage:
+
+		ThreadPool workers;
+		BatchReader reader(&workers);
+		reader.Read(Paths,Handler);
+
+		where Handler is e.g.
+
+		void Handler(const BatchFile& file)
+		{
+			if(file.Error_)
+				...
+			DataSet data;
+			ReadFromMemory(file.Data_,file.Size_,data);
+			...
+		}
+
+		A file that fits in SlotSize bytes is read straight into one of the
+		registered buffers, which is reused once its handler returns; bigger
+		ones get memory of their own.  So at most Depth files are read ahead
+		of the handlers.  Handlers must not throw, just as ThreadPool tasks
+		mustn't.
+	*/
+	class BatchReader : boost::noncopyable
+	{
+	public:
+		typedef boost::function<void(const BatchFile&)> Handler;
+
+		static const size_t DefaultSlotSize=256*1024;
+
+		explicit BatchReader(ThreadPool* Workers=0,size_t Depth=32,size_t SlotSize=DefaultSlotSize);
+		~BatchReader();
+
+		//!Read every one of Paths, returning once each has been handled.
+		void Read(const std::vector<std::string>& Paths,const Handler& handler);
+
+		//!Is it using io_uring, or falling back to read()?
+		bool UsingIoUring() const;
+
+	private:
+		struct Slot;
+		struct Ring;
+
+		void ReadWithRing(const std::vector<std::string>& Paths,const Handler& handler);
+		void ReadOneByOne(const std::vector<std::string>& Paths,const Handler& handler);
+
+		//!Waits for a slot to be free, if Wait, otherwise returns 0 if none is.
+		Slot* Acquire(bool Wait);
+		//!Give a slot's file to its handler, and the slot back once it's done.
+		void Finish(Slot* slot,const Handler& handler);
+		void Handle(Slot* slot,const Handler& handler);
+		void Release(Slot* slot);
+
+		ThreadPool* Workers_;
+		const size_t SlotSize_;
+		const size_t Depth_;
+		std::vector<BYTE> Memory_;
+		boost::scoped_array<Slot> Slots_;
+		boost::scoped_ptr<Ring> Ring_;
+
+		boost::mutex mutex_;
+		boost::condition_variable released_;
+		std::vector<Slot*> Free_;
+	};
+}//namespace dicom
+
+#endif //BATCH_READER_HPP_INCLUDE_GUARD_2958301746
@@ -0,0 +1,159 @@
+#ifndef BOUNDED_QUEUE_HPP_INCLUDE_GUARD_6192740385
+#define BOUNDED_QUEUE_HPP_INCLUDE_GUARD_6192740385
+#include <deque>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+
+namespace dicom
+{
+	//!How full a BoundedQueue is, and has been.
+	struct QueueStats
+	{
+		//!Items waiting right now.
+		size_t Depth_;
+		//!0 means no limit.
+		size_t Capacity_;
+		//!Most items that have ever been waiting at once.
+		size_t HighWater_;
+		//!Items queued since the queue was created.
+		size_t Pushed_;
+		//!Pushes that found the queue full, whether they then waited or gave up.
+		size_t Full_;
+	};
+
+	//!A first in, first out queue with a limit on its length.
+	/*!
+		Any number of threads may push and pop at once.  When the queue is full
+		Push() waits for room and TryPush() gives up, so a producer that's
+		getting ahead of its consumers is held back (or told about it) rather
+		than queueing up work, and memory, without limit.
+
+		Once Close()d every push fails, and pops carry on until the queue is
+		empty and then fail too, so consumers can finish what's there and stop.
+	*/
+	template<typename T>
+	class BoundedQueue : boost::noncopyable
+	{
+	public:
+		//!0 means no limit.
+		BoundedQueue(size_t Capacity)
+			:Capacity_(Capacity),closed_(false),HighWater_(0),Pushed_(0),Full_(0){}
+
+		//!Waits until there's room.  False if the queue has been closed.
+		bool Push(const T& item)
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if(IsFull() && !closed_)
+			{
+				Full_++;
+				while(IsFull() && !closed_)
+					room_.wait(lock);
+			}
+			if(closed_)
+				return false;
+			Add(item);
+			return true;
+		}
+
+		//!False if the queue is full or has been closed.
+		bool TryPush(const T& item)
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if(closed_)
+				return false;
+			if(IsFull())
+			{
+				Full_++;
+				return false;
+			}
+			Add(item);
+			return true;
+		}
+
+		//!Waits for an item.  False once the queue has been closed and emptied.
+		bool Pop(T& item)
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			while(items_.empty() && !closed_)
+				arrived_.wait(lock);
+			if(items_.empty())
+				return false;
+			Remove(item);
+			return true;
+		}
+
+		//!False if there's nothing waiting.
+		bool TryPop(T& item)
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if(items_.empty())
+				return false;
+			Remove(item);
+			return true;
+		}
+
+		//!Refuse any more items, and wake anyone waiting.
+		void Close()
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			closed_=true;
+			arrived_.notify_all();
+			room_.notify_all();
+		}
+
+		size_t Size()
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			return items_.size();
+		}
+
+		size_t Capacity() const{return Capacity_;}
+
+		QueueStats Stats()
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			QueueStats stats;
+			stats.Depth_=items_.size();
+			stats.Capacity_=Capacity_;
+			stats.HighWater_=HighWater_;
+			stats.Pushed_=Pushed_;
+			stats.Full_=Full_;
+			return stats;
+		}
+
+	private:
+		//these must be called with mutex_ held.
+		bool IsFull() const
+		{
+			return Capacity_ && items_.size()>=Capacity_;
+		}
+
+		void Add(const T& item)
+		{
+			items_.push_back(item);
+			Pushed_++;
+			HighWater_=std::max(HighWater_,items_.size());
+			arrived_.notify_one();
+		}
+
+		void Remove(T& item)
+		{
+			item=items_.front();
+			items_.pop_front();
+			room_.notify_one();
+		}
+
+		const size_t Capacity_;
+		boost::mutex mutex_;
+		boost::condition_variable arrived_;
+		boost::condition_variable room_;
+		std::deque<T> items_;
+		bool closed_;
+		size_t HighWater_;
+		size_t Pushed_;
+		size_t Full_;
+	};
+}//namespace dicom
+
+#endif //BOUNDED_QUEUE_HPP_INCLUDE_GUARD_6192740385
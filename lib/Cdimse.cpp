@@ -9,6 +9,7 @@
 #include <iostream>
 #include "Cdimse.hpp"
 #include "ServiceBase.hpp"
+#include "Utility.hpp"
 
 #include "Dumper.hpp"
 /*
@@ -30,6 +31,19 @@ using std::string;
 
 namespace dicom
 {
+	namespace
+	{
+		//!Charges the time until it goes out of scope to the application's handler.
+		class HandlerTimer : boost::noncopyable
+		{
+		public:
+			HandlerTimer(ServiceBase& pdu):pdu_(pdu),Start_(MonotonicNanoseconds()){}
+			~HandlerTimer(){pdu_.RecordHandler(MonotonicNanoseconds()-Start_);}
+		private:
+			ServiceBase& pdu_;
+			const boost::uint64_t Start_;
+		};
+	}
 
 	/*!
 		Simply write back a success response.
@@ -53,7 +67,10 @@ namespace dicom
 		DataSet data;
 		pdu.Read(data);//the TransferSyntax is determined internally by pdu. -Sam
 
-		handler(pdu,command,data);//this should indicate failure via a throw...
+		{
+			HandlerTimer timer(pdu);
+			handler(pdu,command,data);//this should indicate failure via a throw...
+		}
 
 		UID instuid;
 		data(TAG_SOP_INST_UID)>>instuid;
@@ -82,7 +99,10 @@ namespace dicom
 		Sequence Matches;
 
 		//the user-defined callback does the actual matching...
-		handler(pdu,request_data,Matches);
+		{
+			HandlerTimer timer(pdu);
+			handler(pdu,request_data,Matches);
+		}
 
 		//now we send back all found matches.
 		for(Sequence::iterator I=Matches.begin();I!=Matches.end();I++)
@@ -124,6 +144,25 @@ namespace dicom
 
 		//The rest part of implementation involves design of server and should be 
 		//implemented in serve. -Sam
+		HandlerTimer timer(pdu);
+		handler(pdu,command,request_data);
+	}
+
+	/*!
+		Same as C-MOVE, except that the handler sends its sub-operations
+		back over pdu, rather than to a third party.
+	*/
+	void HandleCGet(CGetFunction handler,ServiceBase& pdu,
+		const DataSet& command, const UID& classUID)
+	{
+		UINT16 data_set_status;
+		command(TAG_DATA_SET_TYPE)>>data_set_status;
+		if(data_set_status==DataSetStatus::NO_DATA_SET)
+			throw exception("No data set");
+		DataSet request_data;
+		pdu.Read(request_data);
+
+		HandlerTimer timer(pdu);
 		handler(pdu,command,request_data);
 	}
 
@@ -157,11 +196,13 @@ namespace dicom
 	{
 	}
 
-	void CStoreSCU::writeRQ(const UID& instUID, const DataSet& data,/*TS ts,*/ UINT16 priority)
+	UINT16 CStoreSCU::writeRQ(const UID& instUID, const DataSet& data,/*TS ts,*/ UINT16 priority)
 	{
-		CommandSet::CStoreRQ rq(uniq16odd(), classUID_, instUID, priority);
+		UINT16 msgID=uniq16odd();
+		CommandSet::CStoreRQ rq(msgID, classUID_, instUID, priority);
 		service_.WriteCommand(rq, classUID_);
 		service_.WriteDataSet(data, classUID_/*,ts*/);
+		return msgID;
 	}
 
 	void CStoreSCU::readRSP(UINT16& status)//maybe status should be a return value?TODO
@@ -185,11 +226,20 @@ namespace dicom
 	{
 	}
 
-	void CFindSCU::writeRQ(const DataSet& data, UINT16 priority)
+	UINT16 CFindSCU::writeRQ(const DataSet& data, UINT16 priority)
 	{
-		CommandSet::CFindRQ rq(uniq16odd(), classUID_, priority);
+		UINT16 msgID=uniq16odd();
+		CommandSet::CFindRQ rq(msgID, classUID_, priority);
 		service_.WriteCommand(rq, classUID_);
 		service_.WriteDataSet(data, classUID_);
+		return msgID;
+	}
+
+	void CFindSCU::writeCancelRQ(UINT16 msgID)
+	{
+		//goes on the same presentation context as the request.
+		CommandSet::CCancelRQ rq(msgID);
+		service_.WriteCommand(rq, classUID_);
 	}
 
 	void CFindSCU::readRSP(UINT16& status, DataSet&  data)
@@ -22,11 +22,11 @@ namespace dicom
 
 /*
 	First we define the signature of callback functions that will be called
-	by instances of ThreadSpecificServer on receiving CDIMSE commands, such as
-	C-MOVE, C-FIND etc...
+	by a Server on receiving CDIMSE commands, such as C-MOVE, C-FIND etc...
 
 	A developer of a DICOM server must implement functions that match these
-	signatures and register them with a Server object by calling Server::AddHandler(...)
+	signatures and register them with a Server object by calling Server::AddStoreHandler(...)
+	and friends.
 
 	See comments in Server.hpp
 
@@ -109,7 +109,8 @@ namespace dicom
 	{
 	public:
 		CStoreSCU(ServiceBase& service,const UID& classUID);
-		void writeRQ(const UID& instUID,
+		//!Returns the message ID, which the response will quote back.
+		UINT16 writeRQ(const UID& instUID,
 			const DataSet& data,/*TS ts,*/ UINT16 priority = Priority::MEDIUM);
 		void readRSP(UINT16& status);
 		void readRSP(UINT16& status, DataSet& response);
@@ -119,7 +120,10 @@ namespace dicom
 	{
 	public:
 		CFindSCU(ServiceBase& service,const UID& classUID);
-		void writeRQ(const DataSet& data, UINT16 priority = Priority::MEDIUM);
+		//!Returns the message ID, which the responses will quote back.
+		UINT16 writeRQ(const DataSet& data, UINT16 priority = Priority::MEDIUM);
+		//!Ask the peer to stop sending matches, see Part 7, section 9.1.2.1.4
+		void writeCancelRQ(UINT16 msgID);
 		void readRSP(UINT16& status, DataSet&  data);
 		void readRSP(UINT16& status, DataSet& response, DataSet&  data);
 	};
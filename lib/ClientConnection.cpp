@@ -6,6 +6,7 @@
 *	See LICENSE.txt for copyright and licensing info.
 *************************************************************************/
 #include <iostream>
+#include <map>
 #include "socket/Socket.hpp"
 #include "UIDs.hpp"
 #include "ImplementationUID.hpp"
@@ -13,6 +14,7 @@
 #include "aarj.hpp"
 #include "AssociationRejection.hpp"
 #include "Cdimse.hpp"
+#include "Utility.hpp"
 
 using std::cout;using std::endl;
 
@@ -37,9 +39,11 @@ namespace dicom
 	ClientConnection::ClientConnection(std::string Host, unsigned short Port,
 		std::string LocalAET,std::string RemoteAET,
 		//const std::vector<PresentationContext>& ProposedPresentationContexts)
-		const PresentationContexts& ProposedPresentationContexts)
+		const PresentationContexts& ProposedPresentationContexts,
+		UINT16 MaxOperationsInvoked,
+		UINT32 MaxPDULength)
 		//: ServiceBase(new Network::ClientSocket(Host,Port))
-        : socket_(new Network::ClientSocket(Host,Port))
+        : socket_(new Network::ClientSocket(Host,Port)),OperationsWindow_(1)
 
 	{
 
@@ -68,13 +72,22 @@ namespace dicom
 		//last bit to do is:
 		UserInformation UserInfo;
 		MaximumSubLength MaxSubLength;
-		MaxSubLength.Set(16384);	// we can do all DICOM can handle???
+		//The largest PDU we're prepared to receive, 0 for no limit.  Large PDUs
+		//mean far fewer headers to parse and system calls for big images.
+		MaxSubLength.Set(MaxPDULength);
+		MaxPDULength_=MaxPDULength;
 		UserInfo.ImpClass_.UID_=ImplementationClassUID;
 		UserInfo.ImpVersion_.Name=ImplementationVersionName;
 		UserInfo.SetMax(MaxSubLength);
 
+		//Only bother negotiating this if the caller wants more than the default.
+		//We never perform operations on behalf of the server, so one is plenty.
+		if(MaxOperationsInvoked!=1)
+			UserInfo.SetAsyncOperationsWindow(AsyncOperationsWindow(MaxOperationsInvoked,1));
+
 		association_request.SetUserInformation ( UserInfo );
 
+		const boost::uint64_t Start=MonotonicNanoseconds();
 		association_request.Write(*socket_);
 
 		//examine response from server.
@@ -92,6 +105,7 @@ namespace dicom
 				{
 					throw FailedAssociation();//need a more detailed error here.
 				}
+				RecordNegotiation(MonotonicNanoseconds()-Start);
 				return;//negotiation succesful!
 			}
 		case	0x03:
@@ -147,6 +161,19 @@ namespace dicom
 		return (PCA.Result_!=0);
 	}
 
+	namespace
+	{
+		//!The smaller of two operation limits, where 0 means unlimited.
+		UINT16 MinimumWindow(UINT16 a,UINT16 b)
+		{
+			if(0==a)
+				return b;
+			if(0==b)
+				return a;
+			return std::min(a,b);
+		}
+	}
+
 	/*!
 		copy all succesfully proposed PresentationContexts onto
 		AcceptedPresentationContexts_
@@ -157,10 +184,22 @@ namespace dicom
 		AcceptedPresentationContexts_=acknowledgement.PresContextAccepts_;
 		//AcceptedPresentationContexts_.clear();
 
+		//what we must slice our P-DATA-TFs to.
+		PeerMaxPDULength_=acknowledgement.UserInfo_.MaxSubLength_.MaximumLength_;
+
 
         
         AcceptedPresentationContexts_ = acknowledgement.PresContextAccepts_;
 
+		//If the server doesn't reply with a window, it's 1.  The number of operations
+		//it will perform for us limits the number we may invoke.
+		const UserInformation& Proposed=AAssociateRQ_.UserInfo_;
+		if(Proposed.HasAsyncOpsWindow_ && acknowledgement.UserInfo_.HasAsyncOpsWindow_)
+			OperationsWindow_=MinimumWindow(Proposed.AsyncOpsWindow_.MaxOperationsInvoked_,
+				acknowledgement.UserInfo_.AsyncOpsWindow_.MaxOperationsPerformed_);
+		else
+			OperationsWindow_=1;
+
         int unaccepted = std::count_if(acknowledgement.PresContextAccepts_.begin(),acknowledgement.PresContextAccepts_.end(),IsBad);
         return (AcceptedPresentationContexts_.size()>unaccepted);
 
@@ -212,23 +251,43 @@ namespace dicom
 	}
 
 
-	DataSet ClientConnection::Move(const std::string& destination,const DataSet& query,QueryRetrieve::Root root)
+	std::vector<DataSet> ClientConnection::Store(const std::vector<DataSet>& data)
 	{
-		UID classUID;
-		switch(root)
+		std::vector<DataSet> responses(data.size());
+		std::map<UINT16,size_t> outstanding;//message ID to index into data
+		size_t next=0;
+
+		while(next<data.size() || !outstanding.empty())
 		{
-		case QueryRetrieve::STUDY_ROOT:
-			classUID=STUDY_ROOT_QR_MOVE_SOP_CLASS;
-			break;
-		case QueryRetrieve::PATIENT_ROOT:
-			classUID=PATIENT_ROOT_QR_MOVE_SOP_CLASS;
-			break;
-		case QueryRetrieve::PATIENT_STUDY_ONLY:
-			classUID=PATIENT_STUDY_ONLY_QR_MOVE_SOP_CLASS;
-			break;
-		default:
-			throw dicom::exception("Unknown QR root specified.");
+			//keep the window full...
+			if(next<data.size() && (0==OperationsWindow_ || outstanding.size()<OperationsWindow_))
+			{
+				const DataSet& ds=data[next];
+				UID classUID(ds(TAG_SOP_CLASS_UID).Get<UID>());
+				UID instUID(ds(TAG_SOP_INST_UID).Get<UID>());
+				CStoreSCU storeSCU(*this,classUID);
+				outstanding[storeSCU.writeRQ(instUID,ds)]=next++;
+				continue;
+			}
+
+			//...and only block when it's full, or there's nothing left to send.
+			DataSet response;
+			if(!Read(response))
+				throw exception("Association released with C-STOREs outstanding");
+			UINT16 msgID;
+			response(TAG_MSG_ID_RSP)>>msgID;
+			std::map<UINT16,size_t>::iterator I=outstanding.find(msgID);
+			if(I==outstanding.end())
+				throw exception("C-STORE-RSP to a request we didn't send");
+			responses[I->second]=response;
+			outstanding.erase(I);
 		}
+		return responses;
+	}
+
+	DataSet ClientConnection::Move(const std::string& destination,const DataSet& query,QueryRetrieve::Root root)
+	{
+		UID classUID=QueryRetrieve::MoveSOPClass(root);
 
 		//build a C-MOVE identifier...
 		CMoveSCU moveSCU(*this, classUID);
@@ -244,36 +303,37 @@ namespace dicom
 	}
 
 
+	namespace
+	{
+		//!FindCallback that keeps everything.
+		struct AppendMatch
+		{
+			std::vector<DataSet>& Matches_;
+			AppendMatch(std::vector<DataSet>& Matches):Matches_(Matches){}
+			bool operator()(const DataSet& match)
+			{
+				Matches_.push_back(match);
+				return true;
+			}
+		};
+	}
+
 	/*
 		This utility function waits until all responses have been
 		sent back, then returns them in a vector.  If you want to
-		process each response as it comes in, you'll have to
-		implement your own function, which should be straightforward
-		if you borrow the code here.
+		process each response as it comes in, use the overload that
+		takes a callback.
 	*/
 	std::vector<DataSet> ClientConnection::Find(const DataSet& Query,QueryRetrieve::Root root)
 	{
-		UID classUID;
-		switch(root)
-		{
-		case QueryRetrieve::STUDY_ROOT:
-			classUID=STUDY_ROOT_QR_FIND_SOP_CLASS;
-			break;
-		case QueryRetrieve::PATIENT_ROOT:
-			classUID=PATIENT_ROOT_QR_FIND_SOP_CLASS;
-			break;
-		case QueryRetrieve::PATIENT_STUDY_ONLY:
-			classUID=PATIENT_STUDY_ONLY_QR_FIND_SOP_CLASS;
-			break;
-		case QueryRetrieve::MODALITY_WORKLIST:
-			classUID=MODALITY_WORKLIST_SOP_CLASS;
-			break;
-		case QueryRetrieve::GENERAL_PURPOSE_WORKLIST:
-			classUID=GENERAL_PURPOSE_WORKLIST_SOP_CLASS;
-			break;
-		default:
-			throw dicom::exception("Unknown QR root specified.");
-		}
+		std::vector<DataSet> Responses;
+		Find(Query,root,AppendMatch(Responses));
+		return Responses;
+	}
+
+	DataSet ClientConnection::Find(const DataSet& Query,QueryRetrieve::Root root,FindCallback callback)
+	{
+		UID classUID=QueryRetrieve::FindSOPClass(root);
 		//Check the SOPClass in data and find the accepted transfer syntax
 		BYTE presid;
 		try
@@ -282,26 +342,31 @@ namespace dicom
 		}
 		catch (dicom::exception& e)
 		{
-			cout << "In ClientConnection::Store: " << e.what();
+			cout << "In ClientConnection::Find: " << e.what();
 		}
 		SetCurrentPCID(presid);
 
 		CFindSCU findSCU(*this,classUID);
 
-		findSCU.writeRQ(Query);
+		UINT16 msgID=findSCU.writeRQ(Query);
 
 		UINT16 status = Status::PENDING;
-		std::vector<DataSet> Responses;
+		DataSet response;
+		bool cancelled=false;
 		while (status==Status::PENDING || status == Status::PENDING1)
 		{
-			DataSet response;
 			DataSet data;
+			response=DataSet();
 			findSCU.readRSP(status,response,data);
-			if(data.size())
-				Responses.push_back(data);
+			if(cancelled || !data.size())
+				continue;//keep draining until the final response.
+			if(!callback(data))
+			{
+				findSCU.writeCancelRQ(msgID);
+				cancelled=true;
+			}
 		}
-		return Responses;
-
+		return response;
 	}
 
 	DataSet ClientConnection::Echo()
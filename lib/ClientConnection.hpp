@@ -2,6 +2,7 @@
 #define CLIENT_CONNECTION_HPP_INCLUDE_GUARD_35872343523
 #include <string>
 #include <boost/scoped_ptr.hpp>
+#include <boost/function.hpp>
 #include "ServiceBase.hpp"
 #include "aaac.hpp"
 #include "PresentationContexts.hpp"
@@ -66,15 +67,50 @@ namespace dicom
 		ClientConnection(std::string Host, unsigned short Port,
 			std::string LocalAET,std::string RemoteAET,
 			//const std::vector<PresentationContext>& ProposedPresentationContexts);
-			const PresentationContexts& ProposedPresentationContexts);
+			const PresentationContexts& ProposedPresentationContexts,
+			UINT16 MaxOperationsInvoked=1,
+			UINT32 MaxPDULength=primitive::MaximumSubLength::DefaultMaximumLength_);
 		virtual ~ClientConnection();
 
 		//!Send a dataset, return response  (i.e. perform a C-STORE)
 		DataSet Store(const DataSet& query/*,TS ts = TS(IMPL_VR_LE_TRANSFER_SYNTAX)*/);//be careful with this, ts should match the syntax you negotiated.
 
+		//!Send several datasets, keeping up to GetOperationsWindow() requests in flight.
+		/*!
+			Rather than waiting a round trip for each response before sending the
+			next image, this streams requests out and matches the responses up by
+			message ID as they come back.  On a high latency link that makes a big
+			difference.
+
+			Responses are returned in the same order as the datasets.
+		*/
+		std::vector<DataSet> Store(const std::vector<DataSet>& data);
+
+		//!How many operations we may have outstanding, 0 meaning no limit.
+		/*!
+			This is 1 unless we asked for more in the constructor and the peer
+			agreed, see Part 7, Annex D.3.3.3
+		*/
+		UINT16 GetOperationsWindow() const{return OperationsWindow_;}
+
 		//!Provide a query, get back a list of matches
 		std::vector<DataSet> Find(const DataSet& query,QueryRetrieve::Root root);
 
+		//!Called with each C-FIND match as it arrives.  Return false to cancel the query.
+		typedef boost::function<bool(const DataSet&)> FindCallback;
+
+		//!Provide a query, have each match handed to callback as soon as it's decoded.
+		/*!
+			Nothing is accumulated, so this is the one to use for queries that might
+			match many thousands of records.  If callback returns false we send a
+			C-CANCEL-RQ and quietly discard any matches the peer sent before it
+			noticed.
+
+			Returns the final response command set.  Its status is Status::CANCEL
+			if the peer honoured a cancel.
+		*/
+		DataSet Find(const DataSet& query,QueryRetrieve::Root root,FindCallback callback);
+
 		//!
 		DataSet Move(const std::string& destination,const DataSet& query,QueryRetrieve::Root root);
 
@@ -89,6 +125,9 @@ namespace dicom
 	protected:
 		bool InterogateAAssociateAC(primitive::AAssociateAC& acknowledgement);
 
+	private:
+		UINT16 OperationsWindow_;
+
 	};
 
 }//namespace dicom
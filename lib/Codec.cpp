@@ -0,0 +1,242 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <map>
+#include <boost/bind.hpp>
+#include "Codec.hpp"
+#include "RLECodec.hpp"
+#include "UIDs.hpp"
+
+namespace dicom
+{
+	namespace
+	{
+		typedef std::map<UID,boost::shared_ptr<Codec> > CodecMap;
+
+		boost::mutex RegistryMutex;
+
+		//!Built in codecs are registered the first time anybody looks.
+		CodecMap& Registry()
+		{
+			static CodecMap codecs;
+			static bool initialised=false;
+			if(!initialised)
+			{
+				codecs[RLE_LOSSLESS]=boost::shared_ptr<Codec>(new RLECodec);
+				initialised=true;
+			}
+			return codecs;
+		}
+
+		boost::shared_ptr<Codec> GetCodec(FrameReader& reader)
+		{
+			if(!reader.isEncapsulated())
+				throw CodecError("Pixel data isn't encapsulated, use FrameReader::GetFrame()");
+			if(!reader.Header().exists(TAG_TRANSFER_SYNTAX_UID))
+				throw CodecError("Don't know the transfer syntax of the pixel data");
+			UID TransferSyntax;
+			reader.Header()(TAG_TRANSFER_SYNTAX_UID) >> TransferSyntax;
+			boost::shared_ptr<Codec> codec=FindCodec(TransferSyntax);
+			if(!codec)
+				throw CodecError("No codec registered for " + TransferSyntax.str());
+			return codec;
+		}
+
+		void DecodeTask(boost::shared_ptr<Codec> codec,boost::shared_ptr<std::vector<BYTE> > Encoded,
+			const ImageInfo& Image,BYTE* Frame)
+		{
+			codec->Decode(*Encoded,Image,Frame);
+		}
+
+		//!Keeps track of the frames of one call to DecodeFrames() or EncodePixelData()
+		struct Batch
+		{
+			Batch(size_t Frames):Remaining_(Frames),Failed_(false){}
+
+			boost::mutex mutex_;
+			boost::condition_variable done_;
+			size_t Remaining_;
+			bool Failed_;
+			std::string Error_;
+
+			void Run(ThreadPool::Task task)
+			{
+				std::string Error;
+				bool Failed=false;
+				try
+				{
+					task();
+				}
+				catch(std::exception& e)
+				{
+					Failed=true;
+					Error=e.what();
+				}
+
+				boost::mutex::scoped_lock lock(mutex_);
+				if(Failed && !Failed_)
+				{
+					Failed_=true;
+					Error_=Error;
+				}
+				if(0==--Remaining_)
+					done_.notify_all();
+			}
+
+			void Post(ThreadPool& pool,ThreadPool::Task task)
+			{
+				pool.Post(boost::bind(&Batch::Run,this,task));
+			}
+
+			//!Stop waiting for tasks that were never posted.
+			void Cancel(size_t Tasks)
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				Remaining_-=Tasks;
+			}
+
+			void Wait()
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				while(Remaining_>0)
+					done_.wait(lock);
+			}
+		};
+	}
+
+	void Codec::Encode(const BYTE*,const ImageInfo&,std::vector<BYTE>&)
+	{
+		throw CodecError("This codec can't compress");
+	}
+
+	void RegisterCodec(const UID& TransferSyntax,boost::shared_ptr<Codec> codec)
+	{
+		boost::mutex::scoped_lock lock(RegistryMutex);
+		Registry()[TransferSyntax]=codec;
+	}
+
+	boost::shared_ptr<Codec> FindCodec(const UID& TransferSyntax)
+	{
+		boost::mutex::scoped_lock lock(RegistryMutex);
+		CodecMap::const_iterator I=Registry().find(TransferSyntax);
+		if(I==Registry().end())
+			return boost::shared_ptr<Codec>();
+		return I->second;
+	}
+
+	void DecodeFrame(FrameReader& reader,size_t N,BYTE* Frame)
+	{
+		boost::shared_ptr<Codec> codec=GetCodec(reader);
+		std::vector<BYTE> Encoded;
+		reader.GetFrame(N,Encoded);
+		codec->Decode(Encoded,reader.Image(),Frame);
+	}
+
+	void DecodeFrames(FrameReader& reader,size_t First,size_t Last,BYTE* Output,ThreadPool& pool)
+	{
+		if(Last<=First)
+			return;
+		boost::shared_ptr<Codec> codec=GetCodec(reader);
+
+		Batch batch(Last-First);
+		size_t Posted=0;
+		try
+		{
+			for(size_t N=First;N<Last;N++,Posted++)
+			{
+				boost::shared_ptr<std::vector<BYTE> > Encoded(new std::vector<BYTE>);
+				reader.GetFrame(N,*Encoded);
+				batch.Post(pool,boost::bind(&DecodeTask,codec,Encoded,
+					boost::cref(reader.Image()),Output+(N-First)*reader.FrameSize()));
+			}
+		}
+		catch(...)
+		{
+			//the workers still have pointers to batch, so let them finish first.
+			batch.Cancel((Last-First)-Posted);
+			batch.Wait();
+			throw;
+		}
+
+		batch.Wait();
+		if(batch.Failed_)
+			throw CodecError(batch.Error_);
+	}
+
+	void DecodePixelData(DataSet& data,ThreadPool& pool)
+	{
+		FrameReader reader(data);
+		if(!reader.isEncapsulated())
+			return;
+
+		//decode everything before touching data, so a bad fragment leaves it as it was.
+		size_t Bytes=reader.NumberOfFrames()*reader.FrameSize();
+		if(16==reader.Image().BitsAllocated_)
+		{
+			std::vector<UINT16> Pixels(Bytes/2);
+			if(!Pixels.empty())
+				DecodeFrames(reader,0,reader.NumberOfFrames(),reinterpret_cast<BYTE*>(&Pixels[0]),pool);
+			data.erase(TAG_PIXEL_DATA);
+			data.Put<VR_OW>(TAG_PIXEL_DATA,Pixels);
+		}
+		else
+		{
+			std::vector<BYTE> Pixels(Bytes);
+			if(!Pixels.empty())
+				DecodeFrames(reader,0,reader.NumberOfFrames(),&Pixels[0],pool);
+			data.erase(TAG_PIXEL_DATA);
+			data.Put<VR_OB>(TAG_PIXEL_DATA,Pixels);
+		}
+		data.erase(TAG_TRANSFER_SYNTAX_UID);
+	}
+
+	void EncodePixelData(DataSet& data,const UID& TransferSyntax,ThreadPool& pool)
+	{
+		boost::shared_ptr<Codec> codec=FindCodec(TransferSyntax);
+		if(!codec)
+			throw CodecError("No codec registered for " + TransferSyntax.str());
+
+		FrameReader reader(data);
+		if(reader.isEncapsulated())
+			throw CodecError("Pixel data is already encapsulated");
+
+		size_t Frames=reader.NumberOfFrames();
+		std::vector<std::vector<BYTE> > Native(Frames);
+		std::vector<std::vector<BYTE> > Encoded(Frames);
+
+		Batch batch(Frames);
+		size_t Posted=0;
+		try
+		{
+			for(size_t N=0;N<Frames;N++,Posted++)
+			{
+				reader.GetFrame(N,Native[N]);
+				batch.Post(pool,boost::bind(&Codec::Encode,codec,Native[N].empty() ? 0 : &Native[N][0],
+					boost::cref(reader.Image()),boost::ref(Encoded[N])));
+			}
+		}
+		catch(...)
+		{
+			batch.Cancel(Frames-Posted);
+			batch.Wait();
+			throw;
+		}
+
+		batch.Wait();
+		if(batch.Failed_)
+			throw CodecError(batch.Error_);
+
+		data.erase(TAG_PIXEL_DATA);
+		for(size_t N=0;N<Frames;N++)
+			data.Put<VR_OB>(TAG_PIXEL_DATA,Encoded[N]);
+
+		//as for ReadFromStream(), so that the pixel data can be interpreted.
+		data.erase(TAG_TRANSFER_SYNTAX_UID);
+		data.Put<VR_UI>(TAG_TRANSFER_SYNTAX_UID,TransferSyntax);
+	}
+
+}//namespace dicom
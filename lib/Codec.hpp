@@ -0,0 +1,90 @@
+#ifndef CODEC_HPP_INCLUDE_GUARD_5510379286
+#define CODEC_HPP_INCLUDE_GUARD_5510379286
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "Exceptions.hpp"
+#include "FrameReader.hpp"
+#include "ThreadPool.hpp"
+#include "Types.hpp"
+#include "UID.hpp"
+
+namespace dicom
+{
+	//!Thrown if compressed pixel data can't be decoded, or there's no codec for it.
+	struct CodecError : public dicom::exception
+	{
+		CodecError(std::string Description):dicom::exception(Description){}
+		virtual ~CodecError() throw(){}
+	};
+
+	//!Decompresses one frame of encapsulated pixel data.
+	/*!
+		Part 5, Annex A.4 describes how compressed frames are encapsulated.
+		This library only knows how to pull the fragments out (see FrameReader),
+		turning them back into pixels is the job of a Codec.
+
+		We ship an RLE Lossless codec, as it is simple and commonly sent by
+		ultrasound modalities.  JPEG, JPEG-LS and JPEG 2000 need an external
+		library, so applications that want them should wrap it in a Codec and call
+		RegisterCodec() at startup.
+
+		Implementations must be safe to call from several threads at once,
+		as DecodeFrames() shares one instance between all the workers.
+	*/
+	class Codec
+	{
+	public:
+		virtual ~Codec(){}
+
+		/*!
+			Decode a single frame onto Frame, which has room for Image.FrameSize() bytes.
+			The output is laid out as native pixel data would be, (Part 5, section 8.1)
+			with multi-byte samples in host byte order.
+		*/
+		virtual void Decode(const std::vector<BYTE>& Encoded,const ImageInfo& Image,BYTE* Frame)=0;
+
+		//!Compress a native frame (laid out as for Decode()) onto Encoded.
+		/*!
+			Not every codec can do this, the default throws a CodecError.
+		*/
+		virtual void Encode(const BYTE* Frame,const ImageInfo& Image,std::vector<BYTE>& Encoded);
+	};
+
+	//!Make Codec responsible for TransferSyntax, replacing any codec already registered.
+	void RegisterCodec(const UID& TransferSyntax,boost::shared_ptr<Codec> codec);
+
+	//!Returns an empty pointer if there's no codec for TransferSyntax.
+	boost::shared_ptr<Codec> FindCodec(const UID& TransferSyntax);
+
+	//!Decode frame N of an encapsulated image onto Frame, which must hold reader.FrameSize() bytes.
+	void DecodeFrame(FrameReader& reader,size_t N,BYTE* Frame);
+
+	//!Decode frames [First,Last) across the pool.
+	/*!
+		Compressed frames are read by the calling thread, (FrameReader isn't thread safe)
+		and decoded by the workers.  Frame I ends up at Output+(I-First)*reader.FrameSize().
+		Returns once every frame is done.  If any frame fails, the first error is
+		re-thrown as a CodecError.
+	*/
+	void DecodeFrames(FrameReader& reader,size_t First,size_t Last,BYTE* Output,ThreadPool& pool);
+
+	//!Replace encapsulated pixel data with native pixel data.
+	/*!
+		Data would normally have come from Read(), which keeps the fragments as
+		separate values, and records the transfer syntax.  TAG_TRANSFER_SYNTAX_UID is
+		removed afterwards, so the data set can be written with any native syntax.
+		Does nothing if pixel data isn't encapsulated.  If decoding fails data is
+		left untouched.
+	*/
+	void DecodePixelData(DataSet& data,ThreadPool& pool);
+
+	//!Compress native pixel data, one fragment per frame, with the codec for TransferSyntax.
+	/*!
+		Frames are encoded in parallel across the pool.  Afterwards data should be
+		written with TransferSyntax, e.g. Write(data,FileName,TS(RLE_LOSSLESS))
+	*/
+	void EncodePixelData(DataSet& data,const UID& TransferSyntax,ThreadPool& pool);
+
+}//namespace dicom
+
+#endif //CODEC_HPP_INCLUDE_GUARD_5510379286
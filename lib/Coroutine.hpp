@@ -0,0 +1,255 @@
+#ifndef COROUTINE_HPP_INCLUDE_GUARD_6650138842
+#define COROUTINE_HPP_INCLUDE_GUARD_6650138842
+/*
+	Minimal coroutine types for the asynchronous client interface.
+	These need a C++20 compiler (configure with DICOMLIB_COROUTINES=ON),
+	everywhere else this header is empty.
+*/
+#if defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+namespace dicom
+{
+	//!Bookkeeping shared by Task and AsyncGenerator promises.
+	struct PromiseBase
+	{
+		//!Who to resume when we finish (or yield), if anyone.
+		std::coroutine_handle<> Continuation_;
+		std::exception_ptr Error_;
+
+		//!Hands control straight back to whoever is waiting on us.
+		struct ResumeContinuation
+		{
+			bool await_ready() noexcept{return false;}
+			template<typename Promise>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+			{
+				std::coroutine_handle<> c=h.promise().Continuation_;
+				return c ? c : std::noop_coroutine();
+			}
+			void await_resume() noexcept{}
+		};
+
+		std::suspend_always initial_suspend() noexcept{return {};}
+		ResumeContinuation final_suspend() noexcept{return {};}
+		void unhandled_exception(){Error_=std::current_exception();}
+	};
+
+	template<typename T>
+	struct TaskPromise : PromiseBase
+	{
+		std::optional<T> Value_;
+		void return_value(T value){Value_=std::move(value);}
+		T Result()
+		{
+			if(Error_)
+				std::rethrow_exception(Error_);
+			return std::move(*Value_);
+		}
+	};
+
+	template<>
+	struct TaskPromise<void> : PromiseBase
+	{
+		void return_void(){}
+		void Result()
+		{
+			if(Error_)
+				std::rethrow_exception(Error_);
+		}
+	};
+
+	//!A coroutine that produces one T.
+	/*!
+		Nothing runs until the task is co_awaited (or handed to Spawn() or Wait()).
+		Exceptions thrown inside the coroutine come out of the co_await.
+	*/
+	template<typename T>
+	class Task
+	{
+	public:
+		struct promise_type : TaskPromise<T>
+		{
+			Task get_return_object(){return Task(std::coroutine_handle<promise_type>::from_promise(*this));}
+		};
+
+		Task(Task&& other) noexcept:h_(std::exchange(other.h_,nullptr)){}
+		Task(const Task&)=delete;
+		Task& operator=(const Task&)=delete;
+		~Task()
+		{
+			if(h_)
+				h_.destroy();
+		}
+
+		bool await_ready() const noexcept{return false;}
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+		{
+			h_.promise().Continuation_=awaiting;
+			return h_;
+		}
+		T await_resume(){return h_.promise().Result();}
+
+	private:
+		explicit Task(std::coroutine_handle<promise_type> h):h_(h){}
+
+		std::coroutine_handle<promise_type> h_;
+	};
+
+	//!A coroutine that produces a sequence of T, each of which may take a while to arrive.
+	/*!
+		Use like this:
+		<pre>
+			AsyncGenerator<DataSet> results=client.FindAsync(query);
+			while(std::optional<DataSet> result=co_await results.Next())
+				...
+		</pre>
+		Next() yields an empty optional when the sequence is finished.
+	*/
+	template<typename T>
+	class AsyncGenerator
+	{
+	public:
+		struct promise_type : PromiseBase
+		{
+			std::optional<T> Current_;
+
+			AsyncGenerator get_return_object(){return AsyncGenerator(std::coroutine_handle<promise_type>::from_promise(*this));}
+			ResumeContinuation yield_value(T value)
+			{
+				Current_=std::move(value);
+				return ResumeContinuation();
+			}
+			void return_void(){}
+		};
+
+		struct NextAwaiter
+		{
+			std::coroutine_handle<promise_type> h_;
+			bool await_ready() const noexcept{return h_.done();}
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+			{
+				h_.promise().Continuation_=awaiting;
+				return h_;
+			}
+			std::optional<T> await_resume()
+			{
+				promise_type& p=h_.promise();
+				if(p.Error_)
+					std::rethrow_exception(std::exchange(p.Error_,nullptr));
+				std::optional<T> result;
+				result.swap(p.Current_);
+				return result;
+			}
+		};
+
+		AsyncGenerator(AsyncGenerator&& other) noexcept:h_(std::exchange(other.h_,nullptr)){}
+		AsyncGenerator(const AsyncGenerator&)=delete;
+		AsyncGenerator& operator=(const AsyncGenerator&)=delete;
+		~AsyncGenerator()
+		{
+			if(h_)
+				h_.destroy();
+		}
+
+		//!Run the generator on to its next value.
+		NextAwaiter Next(){return NextAwaiter{h_};}
+
+	private:
+		explicit AsyncGenerator(std::coroutine_handle<promise_type> h):h_(h){}
+
+		std::coroutine_handle<promise_type> h_;
+	};
+
+	//!Coroutine that starts straight away and cleans up after itself.
+	struct Detached
+	{
+		struct promise_type
+		{
+			Detached get_return_object(){return Detached();}
+			std::suspend_never initial_suspend() noexcept{return {};}
+			std::suspend_never final_suspend() noexcept{return {};}
+			void return_void(){}
+			//Like a thread, a spawned task has nowhere to send its exceptions.
+			void unhandled_exception(){std::terminate();}
+		};
+	};
+
+	inline Detached RunDetached(Task<void> task)
+	{
+		co_await task;
+	}
+
+	//!Start a task running without waiting for it.  It must not throw.
+	inline void Spawn(Task<void> task)
+	{
+		RunDetached(std::move(task));
+	}
+
+	//!Where a Wait()ed task leaves its result.
+	/*!
+		Shared, because the task may still be unwinding on another thread
+		after the waiter has woken and gone.
+	*/
+	template<typename T>
+	struct WaitState
+	{
+		WaitState():done_(false){}
+		boost::mutex mutex_;
+		boost::condition_variable finished_;
+		bool done_;
+		//!Unused for Task<void>
+		std::optional<typename std::conditional<std::is_void<T>::value,bool,T>::type> Value_;
+		std::exception_ptr Error_;
+	};
+
+	template<typename T>
+	Detached RunAndSignal(Task<T> task,boost::shared_ptr<WaitState<T> > state)
+	{
+		try
+		{
+			if constexpr (std::is_void<T>::value)
+				co_await task;
+			else
+				state->Value_.emplace(co_await task);
+		}
+		catch(...)
+		{
+			state->Error_=std::current_exception();
+		}
+		boost::mutex::scoped_lock lock(state->mutex_);
+		state->done_=true;
+		state->finished_.notify_all();
+	}
+
+	//!Block the calling thread until the task finishes, and return its result.
+	/*!
+		For use from ordinary code (e.g. main()), never from inside a coroutine
+		or on a reactor thread.
+	*/
+	template<typename T>
+	T Wait(Task<T> task)
+	{
+		boost::shared_ptr<WaitState<T> > state(new WaitState<T>);
+		RunAndSignal(std::move(task),state);
+
+		boost::mutex::scoped_lock lock(state->mutex_);
+		while(!state->done_)
+			state->finished_.wait(lock);
+		if(state->Error_)
+			std::rethrow_exception(state->Error_);
+		if constexpr (!std::is_void<T>::value)
+			return std::move(*state->Value_);
+	}
+}//namespace dicom
+
+#endif //__cpp_impl_coroutine
+
+#endif //COROUTINE_HPP_INCLUDE_GUARD_6650138842
@@ -623,8 +623,8 @@ namespace dicom
 			{0x00280000,VR_UL,"GroupLength"},
 			{TAG_SAMPLES_PER_PX,VR_US,"SamplesperPixel"},
 			{TAG_PHOTOMETRIC,VR_CS,"PhotometricInterpretation"},
-			{0x00280006,VR_US,"PlanarConfiguration"},
-			{0x00280008,VR_IS,"NumberofFrames"},
+			{TAG_PLANAR_CONFIG,VR_US,"PlanarConfiguration"},
+			{TAG_NUM_OF_FRAMES,VR_IS,"NumberofFrames"},
 			{0x00280009,VR_AT,"FrameIncrementPointer"},
 			{TAG_ROWS,VR_US,"Rows"},
 			{TAG_COLUMNS,VR_US,"Columns"},
@@ -8,6 +8,8 @@
 #include <boost/type_traits.hpp>
 #include <exception>
 #include <map>
+#include <iterator>
+#include <vector>
 #include "VR.hpp"
 #include "Value.hpp"
 #include "Tag.hpp"
@@ -24,16 +26,220 @@ namespace dicom
 	Multiple elements may have the same tag.  This is called
 	'value multiplicity' in DICOM terminology (see PS3.5/section 6.4).
 
-	We implement this by using a std::multimap, and for convenience
-	provide a couple of accessor functions.  Note that you can still
-	always use any of the functions that std::multimap provides, such
-	as equal_range(), count() and find()
+	We used to implement this by inheriting from std::multimap, and the
+	interface still looks like one: equal_range(), count(), find(), insert(),
+	erase() etc all behave as you'd expect, and iteration is in tag order.
+
+	Internally though, elements are kept in one multimap per group, held by
+	shared_ptr.  Copying a DataSet only copies the list of groups, and the
+	groups themselves are shared until one copy modifies them, at which point
+	just that group is duplicated.  So a router that makes several copies of
+	an instance, each with a few tags changed, doesn't end up copying every
+	element each time.  (Values themselves were already shared, see Value.hpp)
+
+	The price is that elements can only be modified by Put(), insert() and
+	erase(), and iterators are all const.  As with any container, assume that
+	iterators are invalidated by modifying the DataSet.
 
 */
-	class DataSet:public std::multimap<Tag,Value>
+	class DataSet
 	{
 	public:
+		//!All the elements of one group.
+		typedef std::multimap<Tag,Value> Elements;
+
+		typedef Elements::key_type key_type;
+		typedef Elements::mapped_type mapped_type;
+		typedef Elements::value_type value_type;
+		typedef Elements::size_type size_type;
+
+	private:
+		typedef std::map<UINT16,boost::shared_ptr<Elements> > Groups;
+
+	public:
+		//!Walks over each group in turn, then over the elements in it.
+		class const_iterator
+		{
+		public:
+			typedef std::bidirectional_iterator_tag iterator_category;
+			typedef DataSet::value_type value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const value_type* pointer;
+			typedef const value_type& reference;
+
+			const_iterator():groups_(0){}
+
+			reference operator*() const{return *e_;}
+			pointer operator->() const{return &*e_;}
+
+			const_iterator& operator++()
+			{
+				++e_;
+				if(e_==g_->second->end())
+				{
+					++g_;
+					if(g_!=groups_->end())
+						e_=g_->second->begin();
+				}
+				return *this;
+			}
+			const_iterator operator++(int)
+			{
+				const_iterator I=*this;
+				++*this;
+				return I;
+			}
+			const_iterator& operator--()
+			{
+				if(g_==groups_->end() || e_==g_->second->begin())
+				{
+					--g_;
+					e_=g_->second->end();
+				}
+				--e_;
+				return *this;
+			}
+			const_iterator operator--(int)
+			{
+				const_iterator I=*this;
+				--*this;
+				return I;
+			}
+
+			bool operator==(const const_iterator& I) const
+			{
+				return g_==I.g_ && (g_==groups_->end() || e_==I.e_);
+			}
+			bool operator!=(const const_iterator& I) const
+			{
+				return !(*this==I);
+			}
+
+		private:
+			friend class DataSet;
+
+			//!Never leave e_ pointing at the end of a group, (we don't keep empty groups.)
+			const_iterator(const Groups* groups,Groups::const_iterator g,Elements::const_iterator e)
+				:groups_(groups),g_(g),e_(e)
+			{
+				if(g_!=groups_->end() && e_==g_->second->end())
+				{
+					++g_;
+					if(g_!=groups_->end())
+						e_=g_->second->begin();
+				}
+			}
+
+			const Groups* groups_;
+			Groups::const_iterator g_;
+			Elements::const_iterator e_;
+		};
 
+		//!Elements are immutable in place, so there's only one kind of iterator.
+		typedef const_iterator iterator;
+
+		DataSet():size_(0){}
+
+		const_iterator begin() const
+		{
+			if(groups_.empty())
+				return end();
+			return const_iterator(&groups_,groups_.begin(),groups_.begin()->second->begin());
+		}
+		const_iterator end() const
+		{
+			return const_iterator(&groups_,groups_.end(),Elements::const_iterator());
+		}
+
+		size_type size() const{return size_;}
+		bool empty() const{return 0==size_;}
+
+		void clear()
+		{
+			groups_.clear();
+			size_=0;
+		}
+
+		const_iterator lower_bound(const Tag tag) const
+		{
+			Groups::const_iterator g=groups_.lower_bound(GroupTag(tag));
+			if(g==groups_.end())
+				return end();
+			if(g->first!=GroupTag(tag))
+				return const_iterator(&groups_,g,g->second->begin());
+			return const_iterator(&groups_,g,g->second->lower_bound(tag));
+		}
+
+		const_iterator upper_bound(const Tag tag) const
+		{
+			Groups::const_iterator g=groups_.lower_bound(GroupTag(tag));
+			if(g==groups_.end())
+				return end();
+			if(g->first!=GroupTag(tag))
+				return const_iterator(&groups_,g,g->second->begin());
+			return const_iterator(&groups_,g,g->second->upper_bound(tag));
+		}
+
+		std::pair<const_iterator,const_iterator> equal_range(const Tag tag) const
+		{
+			return std::make_pair(lower_bound(tag),upper_bound(tag));
+		}
+
+		const_iterator find(const Tag tag) const
+		{
+			const_iterator I=lower_bound(tag);
+			if(I==end() || I->first!=tag)
+				return end();
+			return I;
+		}
+
+		size_type count(const Tag tag) const
+		{
+			Groups::const_iterator g=groups_.find(GroupTag(tag));
+			if(g==groups_.end())
+				return 0;
+			return g->second->count(tag);
+		}
+
+		const_iterator insert(const value_type& element)
+		{
+			UINT16 group=GroupTag(element.first);
+			Elements::const_iterator e=Mutable(group).insert(element);
+			size_++;
+			return const_iterator(&groups_,groups_.find(group),e);
+		}
+
+		//!Remove every element with this tag, returns how many there were.
+		size_type erase(const Tag tag)
+		{
+			Groups::iterator g=groups_.find(GroupTag(tag));
+			if(g==groups_.end() || 0==g->second->count(tag))
+				return 0;
+			Elements& elements=Mutable(GroupTag(tag));
+			size_type n=elements.erase(tag);
+			if(elements.empty())
+				groups_.erase(GroupTag(tag));
+			size_-=n;
+			return n;
+		}
+
+		void erase(const_iterator position)
+		{
+			/*
+				position may point into a group we share with another DataSet,
+				so find the equivalent element in our own copy.
+			*/
+			Tag tag=position->first;
+			const Elements& shared=*position.g_->second;
+			Elements::size_type n=std::distance(shared.lower_bound(tag),position.e_);
+			Elements& elements=Mutable(GroupTag(tag));
+			Elements::iterator I=elements.lower_bound(tag);
+			std::advance(I,n);
+			elements.erase(I);
+			if(elements.empty())
+				groups_.erase(GroupTag(tag));
+			size_--;
+		}
 
 		//!access an element
 		/*!
@@ -98,6 +304,22 @@ namespace dicom
 		{
 			return (find(tag) != end());
 		}
+
+	private:
+
+		//!Get a group we can modify, copying it first if it's shared.
+		Elements& Mutable(UINT16 group)
+		{
+			boost::shared_ptr<Elements>& elements=groups_[group];
+			if(!elements)
+				elements.reset(new Elements);
+			else if(elements.use_count()>1)
+				elements.reset(new Elements(*elements));
+			return *elements;
+		}
+
+		Groups groups_;
+		size_type size_;
 	};
 
 	
@@ -18,6 +18,7 @@
 #include "Exceptions.hpp"
 #include "DataDictionary.hpp"
 #include "ValueToStream.hpp"
+#include "Profiling.hpp"
 
 #include "Dumper.hpp"
 
@@ -30,7 +31,8 @@ namespace dicom{
 		void Decode();
 		void DecodeElement();
 
-		Decoder(Buffer& buffer,DataSet& ds,TS ts):buffer_(buffer),dataset_(ds),ts_(ts){}
+		Decoder(Buffer& buffer,DataSet& ds,TS ts,const ReadOptions* options=0)
+			:buffer_(buffer),dataset_(ds),ts_(ts),options_(options){}
 
 		//!see 5/7.5.2
 		struct EndOfSequence{};
@@ -50,9 +52,18 @@ namespace dicom{
 
 		void DecodeVRAndLength(Tag tag, VR& vr, UINT32& length);
 
+		//!The tag of the next element, without moving past it.
+		Tag PeekTag();
+
+		//!Move past the value of an element we don't want, see ReadOptions::TagFilter_
+		void Skip(UINT32 length);
+		void SkipUntil(Tag Delimiter);
+
 		Buffer& buffer_;
 		DataSet& dataset_;
 		TS ts_;
+		//!Null for everything but the top level data set.
+		const ReadOptions* options_;
 
 		void DecodeSequence(Tag tag, UINT32  length);
 
@@ -227,7 +238,7 @@ namespace dicom{
 
 
 	//!DICOM messages need to have even byte length.(Part 5 section 7.1)
-	void CheckEven(int ByteLength)throw (exception)
+	void CheckEven(int ByteLength)
 	{
 		if(ByteLength & 1)
 			throw dicom::exception("Byte length not even.");
@@ -284,6 +295,7 @@ namespace dicom{
 	*/
 	void Decoder::DecodeElement()
 	{
+		DICOMLIB_COUNT(ELEMENTS_DECODED,1);
 		
 		
 		Tag tag;
@@ -304,6 +316,9 @@ namespace dicom{
 
 		DecodeVRAndLength(tag,vr,length);
 
+		if(options_ && !options_->TagFilter_(tag,vr,length))
+			return Skip(length);
+
 		if(tag==TAG_NULL)
 		{
 			//cout<< "null tag, length=" << length << endl;
@@ -526,12 +541,68 @@ namespace dicom{
 		dataset_.Put<VR_SQ>(SequenceTag,sequence);
 	}
 
+	Tag Decoder::PeekTag()
+	{
+		if(buffer_.end()-buffer_.position()<4)
+			throw ReadBeyondBuffer("Attempting to read beyond end of buffer");
+		Buffer::iterator p=buffer_.position();
+		UINT16 Group,Element;
+		std::copy(p,p+2,reinterpret_cast<BYTE*>(&Group));
+		std::copy(p+2,p+4,reinterpret_cast<BYTE*>(&Element));
+		if(buffer_.GetEndian()!=__BYTE_ORDER)
+		{
+			Group=SwitchEndian<UINT16>(Group);
+			Element=SwitchEndian<UINT16>(Element);
+		}
+		return makeTag(Group,Element);
+	}
+
+	void Decoder::Skip(UINT32 length)
+	{
+		if(UNDEFINED_LENGTH==length)
+			SkipUntil(TAG_SEQ_DELIM_ITEM);
+		else
+			buffer_.Increment(length);
+	}
+
+	/*!
+		Walks items and the elements in them by their headers alone, see
+		Part 5, section 7.5.  Item and delimiter headers never have a VR.
+	*/
+	void Decoder::SkipUntil(Tag Delimiter)
+	{
+		for(;;)
+		{
+			Tag tag;
+			buffer_ >> tag;
+			UINT32 length;
+			if(GroupTag(tag)==0xfffe)
+				buffer_ >> length;
+			else
+			{
+				VR vr;
+				DecodeVRAndLength(tag,vr,length);
+			}
+
+			if(tag==Delimiter)
+				return;
+			if(UNDEFINED_LENGTH==length)
+				SkipUntil(tag==TAG_ITEM ? TAG_ITEM_DELIM_ITEM : TAG_SEQ_DELIM_ITEM);
+			else
+				buffer_.Increment(length);
+		}
+	}
+
 	void Decoder::Decode()
 	{
 		try
 		{
 			while(buffer_.position()!=buffer_.end())
+			{
+				if(options_ && PeekTag()>=options_->StopBeforeTag_)
+					return;
 				DecodeElement();
+			}
 		}
 		catch(EndOfSequence)
 		{
@@ -597,10 +668,20 @@ namespace dicom{
 
 	void ReadFromBuffer(Buffer& buffer, DataSet& data, TS transfer_syntax)
 	{
+		DICOMLIB_PROFILE("ReadFromBuffer");
+		DICOMLIB_COUNT(BYTES_DECODED,buffer.end()-buffer.position());
 		Decoder d(buffer,data,transfer_syntax);
 		d.Decode();
 	}
 
+	void ReadFromBuffer(Buffer& buffer, DataSet& data, TS transfer_syntax, const ReadOptions& options)
+	{
+		DICOMLIB_PROFILE("ReadFromBuffer");
+		DICOMLIB_COUNT(BYTES_DECODED,buffer.end()-buffer.position());
+		Decoder d(buffer,data,transfer_syntax,&options);
+		d.Decode();
+	}
+
 	void ReadElementFromBuffer(Buffer& buffer, DataSet& ds,TS transfer_syntax)
 	{
 		Decoder d(buffer,ds,transfer_syntax);
@@ -6,6 +6,7 @@
 #include "TransferSyntax.hpp"
 #include "Exceptions.hpp"
 #include "Buffer.hpp"
+#include "TagFilter.hpp"
 /*
 	TODO
 	
@@ -24,10 +25,33 @@ namespace dicom
 		virtual ~DecoderError()throw(){}
 	};
 	
+	//!Which elements a read should decode, and where it should stop.
+	/*!
+		Both only apply to top level elements; items of a sequence that is
+		read are read whole.
+	*/
+	struct ReadOptions
+	{
+		ReadOptions():StopBeforeTag_(Tag(0xffffffff)){}
+
+		//!Stop at the first element with this tag or greater, e.g. TAG_PIXEL_DATA
+		/*!
+			Elements are in ascending tag order (Part 5, section 7.1), so
+			nothing after that point would be wanted anyway.
+		*/
+		Tag StopBeforeTag_;
+
+		//!Only elements passing this are put on the data set, by default all of them.
+		TagFilter TagFilter_;
+	};
+
 	//!This function seems only to be used by FileMetaInformation
 	void ReadElementFromBuffer(Buffer& buffer, DataSet& data,TS transfer_syntax);
 	
 	void ReadFromBuffer(Buffer& buffer, DataSet& data, TS transfer_syntax);
 
+	//!As above, but if decoding stops at options.StopBeforeTag_ the buffer is left at the start of that element.
+	void ReadFromBuffer(Buffer& buffer, DataSet& data, TS transfer_syntax, const ReadOptions& options);
+
 }//namespace dicom
 #endif //DECODER_HPP_INCLUDE_GUARD_5823561955
@@ -0,0 +1,92 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include "DescriptorStream.hpp"
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#ifdef _WIN32
+	#include <io.h>
+	#define read _read
+#else
+	#include <unistd.h>
+#endif
+
+namespace dicom
+{
+	DescriptorStreamBuf::DescriptorStreamBuf(int fd,size_t BlockSize)
+		:fd_(fd),Block_(BlockSize),Position_(0)
+	{
+		setg(&Block_[0],&Block_[0],&Block_[0]);
+	}
+
+	size_t DescriptorStreamBuf::Read(char* s,size_t n)
+	{
+		for(;;)
+		{
+			int got=read(fd_,s,unsigned(std::min<size_t>(n,0x40000000)));
+			if(got>=0)
+			{
+				Position_+=got;
+				return size_t(got);
+			}
+			if(errno!=EINTR)
+				return 0;
+		}
+	}
+
+	DescriptorStreamBuf::int_type DescriptorStreamBuf::underflow()
+	{
+		if(gptr()<egptr())
+			return traits_type::to_int_type(*gptr());
+		size_t got=Read(&Block_[0],Block_.size());
+		setg(&Block_[0],&Block_[0],&Block_[0]+got);
+		if(0==got)
+			return traits_type::eof();
+		return traits_type::to_int_type(*gptr());
+	}
+
+	std::streamsize DescriptorStreamBuf::xsgetn(char* s,std::streamsize n)
+	{
+		std::streamsize done=0;
+		while(done<n)
+		{
+			if(gptr()==egptr())
+			{
+				if(size_t(n-done)>=Block_.size())
+				{
+					//Not worth copying through the block.
+					size_t got=Read(s+done,size_t(n-done));
+					if(0==got)
+						break;
+					done+=got;
+					continue;
+				}
+				if(traits_type::eq_int_type(underflow(),traits_type::eof()))
+					break;
+			}
+			std::streamsize count=std::min<std::streamsize>(n-done,egptr()-gptr());
+			std::memcpy(s+done,gptr(),size_t(count));
+			gbump(int(count));
+			done+=count;
+		}
+		return done;
+	}
+
+	DescriptorStreamBuf::pos_type DescriptorStreamBuf::seekoff(off_type off,std::ios_base::seekdir dir,std::ios_base::openmode which)
+	{
+		if(off!=0 || dir!=std::ios_base::cur || !(which & std::ios_base::in))
+			return pos_type(off_type(-1));
+		return pos_type(off_type(Position_-(egptr()-gptr())));
+	}
+
+	DescriptorStream::DescriptorStream(int fd,size_t BlockSize)
+		:std::istream(0),buf_(fd,BlockSize)
+	{
+		rdbuf(&buf_);
+	}
+}//namespace dicom
@@ -0,0 +1,51 @@
+#ifndef DESCRIPTOR_STREAM_HPP_INCLUDE_GUARD_4471093862
+#define DESCRIPTOR_STREAM_HPP_INCLUDE_GUARD_4471093862
+#include <istream>
+#include <streambuf>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/utility.hpp>
+
+namespace dicom
+{
+	//!Reads a file descriptor (a file, a pipe, stdin...) a block at a time.
+	/*!
+		Reads bigger than a block go straight into the caller's memory.  It
+		can't seek, as pipes can't, but tellg() works, counting from wherever
+		the descriptor was when we got it.  The descriptor isn't closed.
+
+		A read error looks like the end of the stream.
+	*/
+	class DescriptorStreamBuf : public std::streambuf, boost::noncopyable
+	{
+	public:
+		static const size_t DefaultBlockSize=256*1024;
+
+		explicit DescriptorStreamBuf(int fd,size_t BlockSize=DefaultBlockSize);
+
+	protected:
+		virtual int_type underflow();
+		virtual std::streamsize xsgetn(char* s,std::streamsize n);
+		virtual pos_type seekoff(off_type off,std::ios_base::seekdir dir,std::ios_base::openmode which);
+
+	private:
+		//!read(), until it gets something or the end.
+		size_t Read(char* s,size_t n);
+
+		int fd_;
+		std::vector<char> Block_;
+		//!How many bytes we've had from the descriptor.
+		boost::uint64_t Position_;
+	};
+
+	//!An istream on a DescriptorStreamBuf, e.g. DescriptorStream In(0) for stdin.
+	class DescriptorStream : public std::istream
+	{
+	public:
+		explicit DescriptorStream(int fd,size_t BlockSize=DescriptorStreamBuf::DefaultBlockSize);
+	private:
+		DescriptorStreamBuf buf_;
+	};
+}//namespace dicom
+
+#endif //DESCRIPTOR_STREAM_HPP_INCLUDE_GUARD_4471093862
@@ -8,6 +8,7 @@
 #include <iostream>
 #include "Encoder.hpp"
 #include "Exceptions.hpp"
+#include "Profiling.hpp"
 #include "iso646.h"
 using namespace std;
 
@@ -137,7 +138,10 @@ namespace dicom
 
 			Enforce(ts_.isEncapsulated() || (1==fragments),"Only encoded data can have multiple image fragments.");
 
-			if(1==fragments)//just send the data
+			//encapsulated pixel data always has an offset table, even with only one fragment. (Part 5, A.4)
+			bool Encapsulated=ts_.isEncapsulated() && TAG_PIXEL_DATA==tag;
+
+			if(1==fragments && !Encapsulated)//just send the data
 			{
 				const Type& ByteVector = Begin->second.Get<Type>();
 				sentlength += WriteLengthAndVR((UINT32)ByteVector.size(),VR_OB);
@@ -182,6 +186,7 @@ namespace dicom
 		UINT32 sentlength=0;
 		Tag tag = Begin->first;
 		VR vr = Begin->second.vr();
+		DICOMLIB_COUNT(ELEMENTS_ENCODED,1);
 
 		buffer_ << tag;
 		sentlength += sizeof(Tag);
@@ -412,7 +417,10 @@ namespace dicom
 
 	UINT32 WriteToBuffer(const DataSet& data, Buffer& buffer, TS transfer_syntax)
 	{
+		DICOMLIB_PROFILE("WriteToBuffer");
 		Encoder E(buffer,data,transfer_syntax);
-		return E.Encode();
+		const UINT32 Length=E.Encode();
+		DICOMLIB_COUNT(BYTES_ENCODED,Length);
+		return Length;
 	}
 }//namespace dicom
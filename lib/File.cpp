@@ -11,6 +11,8 @@
 #include "TransferSyntax.hpp"
 #include "Decoder.hpp"
 #include "Encoder.hpp"
+#include "DataDictionary.hpp"
+#include "DescriptorStream.hpp"
 
 
 namespace dicom
@@ -64,11 +66,193 @@ namespace dicom
 		return ;
 	}
 
+	namespace
+	{
+		//!ReadElementsFromStream() decodes what it's read whenever it has this much.
+		const Buffer::size_type DecodeBlockSize=256*1024;
+
+		/*!
+			Walks the elements in a stream without interpreting their values,
+			copying the raw bytes onto a buffer that can then be handed to
+			ReadFromBuffer().  This lets us stop at a given tag (usually pixel data)
+			without having to know in advance how many bytes precede it.
+		*/
+		struct StreamScanner
+		{
+			StreamScanner(std::istream& In,TS ts,Buffer& buffer):In_(In),ts_(ts),buffer_(buffer){}
+
+			//!Read a value of type T, keeping a copy of the raw bytes.
+			template<typename T>
+			T Get()
+			{
+				T data;
+				Copy(sizeof(T));
+				std::copy(buffer_.end()-sizeof(T),buffer_.end(),reinterpret_cast<BYTE*>(&data));
+				if(ts_.isBigEndian() && sizeof(T)!=1)
+					data=SwitchEndian<T>(data);
+				return data;
+			}
+
+			//!Append the next Length bytes of the stream to the buffer.
+			void Copy(UINT32 Length)
+			{
+				if(0==Length)
+					return;
+				Buffer::size_type Size=buffer_.size();
+				buffer_.resize(Size+Length);
+				In_.read((char*)(&buffer_[Size]),Length);
+				if(UINT32(In_.gcount())!=Length)
+					throw FileException("Unexpected end of file");
+			}
+
+			//!Move past the next Length bytes of the stream.
+			void Skip(UINT32 Length)
+			{
+				if(0==Length)
+					return;
+				In_.ignore(Length);
+				if(UINT32(In_.gcount())!=Length)
+					throw FileException("Unexpected end of file");
+			}
+
+			/*!
+				See Part 5, section 7.1.  Items and delimiters (group 0xfffe) never
+				have an explicit VR, even in explicit transfer syntaxes. (7.5)
+			*/
+			void ReadHeader(ElementHeader& header)
+			{
+				UINT16 Group=Get<UINT16>();
+				UINT16 Element=Get<UINT16>();
+				header.tag_=makeTag(Group,Element);
+				if(Group==0xfffe)
+				{
+					header.vr_=VR_UN;
+					header.length_=Get<UINT32>();
+				}
+				else if(ts_.isExplicitVR())
+				{
+					BYTE b1=Get<BYTE>();
+					BYTE b2=Get<BYTE>();
+					header.vr_=VR((UINT16(b2)<<8)|b1);
+					if(header.vr_==VR_UN || header.vr_==VR_SQ || header.vr_==VR_OW || header.vr_==VR_OB || header.vr_==VR_UT)
+					{
+						Get<UINT16>();//reserved
+						header.length_=Get<UINT32>();
+					}
+					else
+						header.length_=Get<UINT16>();
+				}
+				else
+				{
+					header.vr_=GetVR(header.tag_);
+					header.length_=Get<UINT32>();
+				}
+			}
+
+			//!Copy elements or items until we hit Delimiter, see Part 5, section 7.5
+			/*!
+				If Keep is false, they're skipped instead, and nothing is added
+				to the buffer.
+			*/
+			void CopyUntil(Tag Delimiter,bool Keep=true)
+			{
+				for(;;)
+				{
+					Buffer::size_type Start=buffer_.size();
+					ElementHeader header;
+					ReadHeader(header);
+					if(!Keep)
+						buffer_.resize(Start);
+					if(header.tag_==Delimiter)
+						return;
+					if(UNDEFINED_LENGTH==header.length_)
+						CopyUntil(header.tag_==TAG_ITEM ? TAG_ITEM_DELIM_ITEM : TAG_SEQ_DELIM_ITEM,Keep);
+					else if(Keep)
+						Copy(header.length_);
+					else
+						Skip(header.length_);
+				}
+			}
+
+			std::istream& In_;
+			TS ts_;
+			Buffer& buffer_;
+		};
+	}
+
+	bool ReadElementsFromStream(std::istream& In, DataSet& data, TS ts, const ReadOptions& options, ElementHeader& Stop)
+	{
+		Buffer buffer(ts.isBigEndian() ? __BIG_ENDIAN:__LITTLE_ENDIAN);
+		StreamScanner scanner(In,ts,buffer);
+		bool Stopped=false;
+
+		while(In.peek()!=std::istream::traits_type::eof())
+		{
+			Buffer::size_type Start=buffer.size();
+			scanner.ReadHeader(Stop);
+			if(Stop.tag_>=options.StopBeforeTag_)
+			{
+				buffer.resize(Start);//caller gets the header, not the decoder.
+				Stopped=true;
+				break;
+			}
+			const bool Keep=options.TagFilter_(Stop.tag_,Stop.vr_,Stop.length_);
+			if(!Keep)
+				buffer.resize(Start);
+			if(UNDEFINED_LENGTH==Stop.length_)
+				scanner.CopyUntil(TAG_SEQ_DELIM_ITEM,Keep);
+			else if(Keep)
+				scanner.Copy(Stop.length_);
+			else
+				scanner.Skip(Stop.length_);
+
+			/*
+				Decode as we go, rather than at the end, so that we only ever
+				hold a block of the stream (or one element, if that's bigger)
+				as well as the data set.
+			*/
+			if(buffer.size()>=DecodeBlockSize)
+			{
+				ReadFromBuffer(buffer,data,ts);
+				buffer.clear();
+			}
+		}
+
+		ReadFromBuffer(buffer,data,ts);
+		return Stopped;
+	}
+
+	bool ReadElementsFromStream(std::istream& In, DataSet& data, TS ts, Tag StopTag, ElementHeader& Stop)
+	{
+		ReadOptions options;
+		options.StopBeforeTag_=StopTag;
+		return ReadElementsFromStream(In,data,ts,options,Stop);
+	}
+
+	TS ReadHeaderFromStream(std::istream& In, DataSet& data, ElementHeader& PixelData, bool& HasPixelData)
+	{
+		data.clear();
+		UID TransferSyntaxUID=IMPL_VR_LE_TRANSFER_SYNTAX;//default
+		FileMetaInformation MetaInfo(In);
+		MetaInfo.MetaElements_(TAG_TRANSFER_SYNTAX_UID) >> TransferSyntaxUID;
+
+		TS ts(TransferSyntaxUID);
+		Enforce(!ts.isDeflated(),"Can't scan a deflated data set");
+
+		HasPixelData=ReadElementsFromStream(In,data,ts,TAG_PIXEL_DATA,PixelData);
+		if(HasPixelData && PixelData.tag_!=TAG_PIXEL_DATA)
+			HasPixelData=false;
+
+		data.Put<VR_UI>(TAG_TRANSFER_SYNTAX_UID,TransferSyntaxUID);
+		return ts;
+	}
+
 	/*
 	I add a limit to the buffer so that I can read the header only -Sam 29July2009
 	*/
 	void ReadFromStream(std::ifstream& In, DataSet& data,size_t max_number_of_byte_to_read)
 	{
+
 		data.clear();
 
 
@@ -105,6 +289,16 @@ namespace dicom
 			file to start reading the DataSet.
 		*/
 
+		if(size_t(-1)==max_number_of_byte_to_read && !ts.isDeflated())
+		{
+			//Decode it a block at a time, rather than reading it all in first.
+			ElementHeader Stop;
+			ReadElementsFromStream(In,data,ts,ReadOptions(),Stop);
+			if(ts.isEncapsulated())
+				data.Put<VR_UI>(TAG_TRANSFER_SYNTAX_UID,TransferSyntaxUID);
+			return;
+		}
+
 		size_t BytesToRead=GetStreamSize(In)-In.tellg();
 		BytesToRead=std::min(BytesToRead,max_number_of_byte_to_read);
 
@@ -128,6 +322,49 @@ namespace dicom
 			data.Put<VR_UI>(TAG_TRANSFER_SYNTAX_UID,TransferSyntaxUID);
 	}
 
+	void ReadFromStream(std::istream& In, DataSet& data, const ReadOptions& options)
+	{
+		data.clear();
+		UID TransferSyntaxUID=IMPL_VR_LE_TRANSFER_SYNTAX;//default
+		FileMetaInformation MetaInfo(In);
+		MetaInfo.MetaElements_(TAG_TRANSFER_SYNTAX_UID) >> TransferSyntaxUID;
+
+		TS ts(TransferSyntaxUID);
+		Enforce(!ts.isDeflated(),"Can't scan a deflated data set");
+
+		ElementHeader Stop;
+		ReadElementsFromStream(In,data,ts,options,Stop);
+
+		if(ts.isEncapsulated())
+			data.Put<VR_UI>(TAG_TRANSFER_SYNTAX_UID,TransferSyntaxUID);
+	}
+
+	void ReadFromDescriptor(int fd, DataSet& data, const ReadOptions& options)
+	{
+		DescriptorStream In(fd);
+		ReadFromStream(In,data,options);
+	}
+
+	namespace
+	{
+		//!Reads straight out of someone else's memory, rather than copying it as a stringstream would.
+		struct MemoryStreamBuf : public std::streambuf
+		{
+			MemoryStreamBuf(const BYTE* Data,size_t Size)
+			{
+				char* Begin=const_cast<char*>(reinterpret_cast<const char*>(Data));
+				setg(Begin,Begin,Begin+Size);
+			}
+		};
+	}
+
+	void ReadFromMemory(const BYTE* Data, size_t Size, DataSet& data, const ReadOptions& options)
+	{
+		MemoryStreamBuf buffer(Data,Size);
+		std::istream In(&buffer);
+		ReadFromStream(In,data,options);
+	}
+
 	void WriteToStream(const DataSet& data,std::ostream& Out,TS ts, bool Tiff)
 	{
 		FileMetaInformation MetaInfo(data,ts);
@@ -184,6 +421,14 @@ namespace dicom
 		ReadFromStream(in,data,max_number_of_byte_to_read);
 	}
 
+	void Read(std::string FileName,DataSet& data,const ReadOptions& options)
+	{
+		std::ifstream in(FileName.c_str(),std::ios::binary);
+		if(in.fail())
+			throw dicom::exception("Couldn't open input file");
+		ReadFromStream(in,data,options);
+	}
+
 	//supply a false if you want to write a Pure Dicom file
 	//here pure means NOT-TIFF-Compatible
 	void Write(const DataSet& data, std::string FileName, TS ts, bool Tiff)
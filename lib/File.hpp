@@ -4,6 +4,8 @@
 #include "UIDs.hpp"
 #include "Exceptions.hpp"
 #include "FileMetaInformation.hpp"
+#include "TransferSyntax.hpp"
+#include "Decoder.hpp"
 #include <fstream>
 
 
@@ -47,12 +49,76 @@ namespace dicom
 
 	void ReadFileMetaFromStream(std::ifstream& In, DataSet& ds);
 
+	//!Tag, VR and length of an element, as found in the stream before its value.
+	struct ElementHeader
+	{
+		Tag tag_;
+		VR vr_;
+		UINT32 length_;
+	};
+
+	//!Decode top level elements up to, but not including, StopTag.
+	/*!
+		In must be positioned at the start of the data set, i.e. just past
+		the File Meta Information.  Only the bytes of elements preceding
+		StopTag are read from the stream, so this is a cheap way of getting
+		at the header of a large (e.g. multi-frame) object.
+
+		If an element with tag greater than or equal to StopTag is found, its header
+		is returned in Stop, In is left pointing at the first byte of its value,
+		and the function returns true.  Returns false if the end of the stream
+		was reached first.
+	*/
+	bool ReadElementsFromStream(std::istream& In, DataSet& data, TS ts, Tag StopTag, ElementHeader& Stop);
+
+	//!As above, stopping at options.StopBeforeTag_
+	/*!
+		Elements not passing options.TagFilter_ are skipped over in the stream,
+		so their values are neither read into memory nor decoded.
+	*/
+	bool ReadElementsFromStream(std::istream& In, DataSet& data, TS ts, const ReadOptions& options, ElementHeader& Stop);
+
+	//!Read meta information and every element before pixel data.
+	/*!
+		Returns the transfer syntax of the file.  If the file has pixel data,
+		HasPixelData is set true and In is left at the start of its value.
+	*/
+	TS ReadHeaderFromStream(std::istream& In, DataSet& data, ElementHeader& PixelData, bool& HasPixelData);
+
+	//!Read a whole file, or with max_number_of_byte_to_read, the start of one.
+	/*!
+		Without a limit, the file is decoded as it's read, a block at a time.
+	*/
 	void ReadFromStream(std::ifstream& In, DataSet& data,size_t max_number_of_byte_to_read=-1);
 
+	//!Read meta information, then the elements options asks for.
+	/*!
+		Unlike max_number_of_byte_to_read above, which can cut an element in
+		half, this stops cleanly on an element boundary, and only reads from
+		In as far as it has to.  e.g. to get at the header of a file:
+
+		ReadOptions options;
+		options.StopBeforeTag_=TAG_PIXEL_DATA;
+		Read(FileName,data,options);
+	*/
+	void ReadFromStream(std::istream& In, DataSet& data, const ReadOptions& options);
+
+	//!As above, from a file descriptor, e.g. 0 for stdin, or a pipe from tar or gunzip.
+	/*!
+		The stream's size needn't be known, and only a block of it is held in
+		memory at once, see DescriptorStream.
+	*/
+	void ReadFromDescriptor(int fd, DataSet& data, const ReadOptions& options=ReadOptions());
+
+	//!As above, from a whole file already in memory, e.g. from a BatchReader.
+	void ReadFromMemory(const BYTE* Data, size_t Size, DataSet& data, const ReadOptions& options=ReadOptions());
+
 	void WriteToStream(const DataSet& data,std::ostream& Out,TS ts=TS(IMPL_VR_LE_TRANSFER_SYNTAX)/*::IMPL_VR_LE*/, bool Tiff=true);
 
 
 	void Read(std::string FileName,DataSet& data,size_t max_number_of_byte_to_read=-1);
+
+	void Read(std::string FileName,DataSet& data,const ReadOptions& options);
 	
 	//Note: default Tiff compatible. Still allow to write Pure Dicom when supply false
 	//!mge @ May 2009
@@ -139,7 +139,11 @@ namespace dicom
 	{
 		if(!In)
 			throw FileMetaInfoException("Input stream not open.");
-		if(!In.seekg(0))
+		//Streams that can't tell where they are (pipes) are taken to be at the beginning.
+		const std::streampos Start=In.tellg();
+		if(Start==std::streampos(-1))
+			In.clear();
+		else if(Start!=std::streampos(0) && !In.seekg(0))
 			throw FileMetaInfoException("Couldn't find beginning of stream.");
 		if(!In.read(Preamble_,128))
 			throw FileMetaInfoException("Couldn't read preamble.");
@@ -165,7 +169,7 @@ namespace dicom
 		Tag tag=MetaElements_.begin()->first;
 		if(tag!=TAG_FILE_INFO_GR_LEN)
 			throw exception("First tag must be group length(0x0002,0000) in File Meta Information");
-		Value& value=MetaElements_.begin()->second;
+		const Value& value=MetaElements_.begin()->second;
 
 		UINT32 FileMetaInfoLength;
 		value >> FileMetaInfoLength;
@@ -0,0 +1,333 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "FrameReader.hpp"
+#include "Buffer.hpp"
+#include "TransferSyntax.hpp"
+
+namespace dicom
+{
+	namespace
+	{
+		UINT16 GetUS(const DataSet& data,Tag tag,const char* Name)
+		{
+			if(!data.exists(tag))
+				throw FrameError(std::string("Image has no ")+Name);
+			UINT16 value;
+			data(tag) >> value;
+			return value;
+		}
+
+		/*!
+			Items within encapsulated pixel data are always little endian, and
+			never have an explicit VR.  (Part 5, Annex A.4)
+		*/
+		void ReadItemHeader(std::istream& In,Tag& tag,UINT32& length)
+		{
+			Buffer buffer(__LITTLE_ENDIAN);
+			buffer.resize(8);
+			In.read((char*)(&buffer[0]),8);
+			if(In.gcount()!=8)
+				throw FrameError("Unexpected end of file in encapsulated pixel data");
+			buffer >> tag;
+			buffer >> length;
+		}
+
+		//!JPEG (and JPEG-LS) codestreams start with SOI, JPEG 2000 with SOC.
+		bool IsCodestreamStart(BYTE b1,BYTE b2)
+		{
+			return b1==0xff && (b2==0xd8 || b2==0x4f);
+		}
+	}
+
+	FrameReader::FrameReader(const std::string& FileName)
+		:In_(new std::ifstream(FileName.c_str(),std::ios::binary))
+	{
+		if(In_->fail())
+			throw FileException("Couldn't open input file");
+
+		ElementHeader PixelData;
+		bool HasPixelData;
+		TS ts=ReadHeaderFromStream(*In_,Header_,PixelData,HasPixelData);
+		if(!HasPixelData)
+			throw FrameError("File has no pixel data");
+
+		BigEndian_=ts.isBigEndian();
+		Encapsulated_=(UNDEFINED_LENGTH==PixelData.length_);
+		PixelDataOffset_=In_->tellg();
+		PixelDataLength_=PixelData.length_;
+
+		ReadImageAttributes();
+
+		if(Encapsulated_)
+			IndexFragments(*In_);
+	}
+
+	FrameReader::FrameReader(const DataSet& data)
+		:Header_(data),PixelData_(data.Values(TAG_PIXEL_DATA)),
+		PixelDataOffset_(0),PixelDataLength_(0),
+		BigEndian_(false)//the decoder has already put everything in host byte order.
+	{
+		if(PixelData_.empty())
+			throw FrameError("Data set has no pixel data");
+		Header_.erase(TAG_PIXEL_DATA);
+
+		/*
+			The decoder throws away the offset table and stores each fragment
+			as a separate value, see Decoder::DecodeOB()
+		*/
+		Encapsulated_=PixelData_.size()>1;
+		if(Header_.exists(TAG_TRANSFER_SYNTAX_UID))
+		{
+			UID TransferSyntaxUID;
+			Header_(TAG_TRANSFER_SYNTAX_UID) >> TransferSyntaxUID;
+			Encapsulated_=Encapsulated_ || TS(TransferSyntaxUID).isEncapsulated();
+		}
+
+		ReadImageAttributes();
+
+		if(Encapsulated_)
+		{
+			std::vector<bool> Starts;
+			for(size_t i=0;i<PixelData_.size();i++)
+			{
+				const std::vector<BYTE>& data=PixelData_[i].Get<std::vector<BYTE> >();
+				Fragment fragment;
+				fragment.Offset_=i;
+				fragment.Length_=UINT32(data.size());
+				Fragments_.push_back(fragment);
+				Starts.push_back(data.size()>=2 && IsCodestreamStart(data[0],data[1]));
+			}
+			MapFramesToFragments(std::vector<UINT32>(),Starts,0);
+		}
+	}
+
+	ImageInfo::ImageInfo(const DataSet& data)
+		:SamplesPerPixel_(1),PlanarConfiguration_(0)
+	{
+		Rows_=GetUS(data,TAG_ROWS,"Rows");
+		Columns_=GetUS(data,TAG_COLUMNS,"Columns");
+		BitsAllocated_=GetUS(data,TAG_BITS_ALLOC,"Bits Allocated");
+		if(data.exists(TAG_SAMPLES_PER_PX))
+			data(TAG_SAMPLES_PER_PX) >> SamplesPerPixel_;
+		if(data.exists(TAG_PLANAR_CONFIG))
+			data(TAG_PLANAR_CONFIG) >> PlanarConfiguration_;
+	}
+
+	void FrameReader::ReadImageAttributes()
+	{
+		Image_=ImageInfo(Header_);
+
+		NumberOfFrames_=1;
+		if(Header_.exists(TAG_NUM_OF_FRAMES))
+		{
+			std::string s;
+			Header_(TAG_NUM_OF_FRAMES) >> s;
+			int n=std::atoi(s.c_str());
+			if(n>1)
+				NumberOfFrames_=n;
+		}
+
+		if(!Encapsulated_ && (Image_.BitsAllocated_ & 7))
+			throw FrameError("Can't address frames with bit packed pixel data");
+	}
+
+	/*!
+		We're positioned just after the pixel data element header.
+		See Part 5, Table A.4-2 for the layout.
+	*/
+	void FrameReader::IndexFragments(std::istream& In)
+	{
+		Tag tag;
+		UINT32 length;
+		ReadItemHeader(In,tag,length);
+		if(TAG_ITEM!=tag)
+			throw FrameError("Encapsulated pixel data must start with an offset table");
+
+		Buffer buffer(__LITTLE_ENDIAN);
+		buffer.resize(length);
+		if(length>0)
+			In.read((char*)(&buffer[0]),length);
+		std::vector<UINT32> OffsetTable(length/4);
+		for(size_t i=0;i<OffsetTable.size();i++)
+			buffer >> OffsetTable[i];
+
+		//offsets in the table are measured from the first byte of the first fragment's item tag.
+		std::streamoff FirstItem=In.tellg();
+		std::vector<bool> Starts;
+		for(;;)
+		{
+			ReadItemHeader(In,tag,length);
+			if(TAG_SEQ_DELIM_ITEM==tag)
+				break;
+			if(TAG_ITEM!=tag)
+				throw FrameError("Fragment must be a sequence item");
+
+			Fragment fragment;
+			fragment.Offset_=In.tellg();
+			fragment.Length_=length;
+			Fragments_.push_back(fragment);
+
+			char marker[2]={0,0};
+			if(length>=2)
+				In.read(marker,2);
+			Starts.push_back(IsCodestreamStart(BYTE(marker[0]),BYTE(marker[1])));
+
+			In.seekg(fragment.Offset_+length);
+		}
+		MapFramesToFragments(OffsetTable,Starts,FirstItem);
+	}
+
+	void FrameReader::MapFramesToFragments(const std::vector<UINT32>& OffsetTable,const std::vector<bool>& Starts,std::streamoff FirstItem)
+	{
+		Frames_.clear();
+		if(Fragments_.empty())
+			throw FrameError("Encapsulated pixel data has no fragments");
+
+		if(!OffsetTable.empty())
+		{
+			if(OffsetTable.size()!=NumberOfFrames_)
+				throw FrameError("Offset table doesn't match number of frames");
+
+			size_t j=0;
+			for(size_t i=0;i<NumberOfFrames_;i++)
+			{
+				while(j<Fragments_.size() && Fragments_[j].Offset_-8-FirstItem<std::streamoff(OffsetTable[i]))
+					j++;
+				if(j==Fragments_.size() || Fragments_[j].Offset_-8-FirstItem!=std::streamoff(OffsetTable[i]))
+					throw FrameError("Offset table doesn't point at a fragment");
+				Frames_.push_back(std::make_pair(j,j+1));
+				if(i>0)
+					Frames_[i-1].second=j;
+			}
+			Frames_.back().second=Fragments_.size();
+		}
+		else if(Fragments_.size()==NumberOfFrames_)
+		{
+			for(size_t i=0;i<NumberOfFrames_;i++)
+				Frames_.push_back(std::make_pair(i,i+1));
+		}
+		else if(1==NumberOfFrames_)
+		{
+			Frames_.push_back(std::make_pair(size_t(0),Fragments_.size()));
+		}
+		else
+		{
+			/*
+				No offset table, and frames span more than one fragment.  The best
+				we can do is look for the start of each codestream.
+			*/
+			for(size_t j=0;j<Starts.size();j++)
+			{
+				if(!Starts[j])
+					continue;
+				if(!Frames_.empty())
+					Frames_.back().second=j;
+				Frames_.push_back(std::make_pair(j,Starts.size()));
+			}
+			if(Frames_.size()!=NumberOfFrames_ || Frames_.front().first!=0)
+				throw FrameError("Can't locate frames in encapsulated pixel data");
+		}
+	}
+
+	void FrameReader::ReadNative(size_t N,BYTE* pFrame)
+	{
+		size_t FrameSize=Image_.FrameSize();
+		if(0==FrameSize)
+			return;
+		size_t Offset=N*FrameSize;
+		if(In_)
+		{
+			if(Offset+FrameSize>PixelDataLength_)
+				throw FrameError("Pixel data is too short for number of frames");
+			In_->clear();
+			In_->seekg(PixelDataOffset_+std::streamoff(Offset));
+			In_->read((char*)pFrame,FrameSize);
+			if(size_t(In_->gcount())!=FrameSize)
+				throw FrameError("Unexpected end of file in pixel data");
+
+			int BytesPerSample=Image_.BitsAllocated_/8;
+			if(BigEndian_!=(__BYTE_ORDER==__BIG_ENDIAN) && BytesPerSample>1)
+				for(BYTE* p=pFrame;p<pFrame+FrameSize;p+=BytesPerSample)
+					std::reverse(p,p+BytesPerSample);
+		}
+		else
+		{
+			const Value& value=PixelData_.front();
+			const BYTE* pData;
+			size_t Size;
+			if(VR_OW==value.vr())
+			{
+				const std::vector<UINT16>& data=value.Get<std::vector<UINT16> >();
+				pData=reinterpret_cast<const BYTE*>(data.empty() ? 0 : &data[0]);
+				Size=data.size()*2;
+			}
+			else
+			{
+				const std::vector<BYTE>& data=value.Get<std::vector<BYTE> >();
+				pData=data.empty() ? 0 : &data[0];
+				Size=data.size();
+			}
+			if(Offset+FrameSize>Size)
+				throw FrameError("Pixel data is too short for number of frames");
+			std::memcpy(pFrame,pData+Offset,FrameSize);
+		}
+	}
+
+	void FrameReader::GetFrame(size_t N,std::vector<BYTE>& Frame)
+	{
+		if(N>=NumberOfFrames_)
+			throw FrameError("Frame number out of range");
+
+		if(!Encapsulated_)
+		{
+			Frame.resize(FrameSize());
+			ReadNative(N,Frame.empty() ? 0 : &Frame[0]);
+			return;
+		}
+
+		Frame.clear();
+		for(size_t j=Frames_[N].first;j<Frames_[N].second;j++)
+		{
+			const Fragment& fragment=Fragments_[j];
+			if(In_)
+			{
+				size_t Size=Frame.size();
+				Frame.resize(Size+fragment.Length_);
+				if(0==fragment.Length_)
+					continue;
+				In_->clear();
+				In_->seekg(fragment.Offset_);
+				In_->read((char*)(&Frame[Size]),fragment.Length_);
+				if(UINT32(In_->gcount())!=fragment.Length_)
+					throw FrameError("Unexpected end of file in pixel data");
+			}
+			else
+			{
+				const std::vector<BYTE>& data=PixelData_[size_t(fragment.Offset_)].Get<std::vector<BYTE> >();
+				Frame.insert(Frame.end(),data.begin(),data.end());
+			}
+		}
+	}
+
+	void FrameReader::GetFrame(size_t N,std::vector<UINT16>& Frame)
+	{
+		if(Encapsulated_)
+			throw FrameError("Encapsulated frames are compressed, use GetFrame(N,std::vector<BYTE>&)");
+		if(16!=Image_.BitsAllocated_)
+			throw FrameError("Bits Allocated is not 16");
+		if(N>=NumberOfFrames_)
+			throw FrameError("Frame number out of range");
+
+		Frame.resize(FrameSize()/2);
+		ReadNative(N,Frame.empty() ? 0 : reinterpret_cast<BYTE*>(&Frame[0]));
+	}
+
+}//namespace dicom
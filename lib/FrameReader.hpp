@@ -0,0 +1,123 @@
+#ifndef FRAME_READER_HPP_INCLUDE_GUARD_6120947733
+#define FRAME_READER_HPP_INCLUDE_GUARD_6120947733
+#include <string>
+#include <vector>
+#include <fstream>
+#include <boost/utility.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "DataSet.hpp"
+#include "Exceptions.hpp"
+#include "File.hpp"
+#include "Types.hpp"
+
+namespace dicom
+{
+	//!Thrown if we can't locate or extract a requested frame.
+	struct FrameError : public dicom::exception
+	{
+		FrameError(std::string Description):dicom::exception(Description){}
+		virtual ~FrameError() throw(){}
+	};
+
+	//!Attributes of the Image Pixel Module (Part 3, C.7.6.3) that describe the layout of a frame.
+	struct ImageInfo
+	{
+		ImageInfo():Rows_(0),Columns_(0),SamplesPerPixel_(1),BitsAllocated_(8),PlanarConfiguration_(0){}
+
+		//!Throws FrameError if Rows, Columns or Bits Allocated are missing.
+		ImageInfo(const DataSet& data);
+
+		UINT16 Rows_;
+		UINT16 Columns_;
+		UINT16 SamplesPerPixel_;
+		UINT16 BitsAllocated_;
+		UINT16 PlanarConfiguration_;
+
+		size_t Pixels() const{return size_t(Rows_)*Columns_;}
+
+		//!Size in bytes of one uncompressed frame.
+		size_t FrameSize() const{return Pixels()*SamplesPerPixel_*(BitsAllocated_/8);}
+	};
+
+	//!Random access to individual frames of a multi-frame image.
+	/*!
+		Reading a whole enhanced CT or ultrasound loop onto a DataSet just to look
+		at one slice is very wasteful.  This class reads everything up to pixel data,
+		and then works out where each frame lives:
+
+		Native pixel data (Part 5, section 8.1) - frames are contiguous and all the same
+		size, so the offset of frame N is computed from Rows, Columns, SamplesPerPixel
+		and BitsAllocated.
+
+		Encapsulated pixel data (Part 5, Annex A.4) - we record the position of each
+		fragment without reading it, and use the Basic Offset Table to decide which
+		fragments belong to which frame.  If the table is empty, we assume one fragment
+		per frame, or failing that look for codestream start markers.
+
+		When constructed from a file, GetFrame() only reads the bytes of the requested frame.
+		When constructed from a DataSet that has already been read, only that frame is copied
+		out of the pixel data.
+
+		Frames from an encapsulated transfer syntax are returned still compressed.
+	*/
+	class FrameReader : boost::noncopyable
+	{
+	public:
+		//!Open a DICOM file.
+		FrameReader(const std::string& FileName);
+
+		//!Use a DataSet that's already in memory.  (Pixel data is shared, not copied.)
+		FrameReader(const DataSet& data);
+
+		size_t NumberOfFrames() const{return NumberOfFrames_;}
+
+		//!Size in bytes of one uncompressed frame.
+		size_t FrameSize() const{return Image_.FrameSize();}
+
+		const ImageInfo& Image() const{return Image_;}
+
+		bool isEncapsulated() const{return Encapsulated_;}
+
+		//!Every element except pixel data.
+		const DataSet& Header() const{return Header_;}
+
+		//!Get frame N (counting from zero).  16 bit samples are returned in host byte order.
+		void GetFrame(size_t N,std::vector<BYTE>& Frame);
+
+		//!Get frame N of native pixel data with 16 bits allocated.
+		void GetFrame(size_t N,std::vector<UINT16>& Frame);
+
+	private:
+
+		//!Position (file) or value index (DataSet) of a fragment, and its length.
+		struct Fragment
+		{
+			std::streamoff Offset_;
+			UINT32 Length_;
+		};
+
+		void ReadImageAttributes();
+		void IndexFragments(std::istream& In);
+		void MapFramesToFragments(const std::vector<UINT32>& OffsetTable,const std::vector<bool>& Starts,std::streamoff FirstItem);
+		void ReadNative(size_t N,BYTE* pFrame);
+
+		DataSet Header_;
+		std::vector<Value> PixelData_;
+
+		boost::scoped_ptr<std::ifstream> In_;
+		std::streamoff PixelDataOffset_;
+		UINT32 PixelDataLength_;
+		bool BigEndian_;
+
+		bool Encapsulated_;
+		size_t NumberOfFrames_;
+		ImageInfo Image_;
+
+		std::vector<Fragment> Fragments_;
+		//![first,last) fragment indices for each frame.
+		std::vector<std::pair<size_t,size_t> > Frames_;
+	};
+
+}//namespace dicom
+
+#endif //FRAME_READER_HPP_INCLUDE_GUARD_6120947733
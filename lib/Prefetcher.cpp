@@ -0,0 +1,88 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include "Prefetcher.hpp"
+#include <boost/bind.hpp>
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+namespace dicom
+{
+	Prefetcher::Prefetcher(size_t Depth,size_t Bytes)
+		:Advised_(0),Stop_(false),Depth_(Depth),Bytes_(Bytes)
+	{
+		if(Depth_)
+			thread_=boost::thread(boost::bind(&Prefetcher::Run,this));
+	}
+
+	Prefetcher::~Prefetcher()
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			Stop_=true;
+		}
+		condition_.notify_all();
+		if(thread_.joinable())
+			thread_.join();
+	}
+
+	void Prefetcher::Push(const std::string& Path)
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			Paths_.push_back(Path);
+		}
+		condition_.notify_all();
+	}
+
+	bool Prefetcher::Pop(std::string& Path)
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if(Paths_.empty())
+				return false;
+			Path=Paths_.front();
+			Paths_.pop_front();
+			if(Advised_)
+				Advised_--;
+		}
+		condition_.notify_all();
+		return true;
+	}
+
+	void Prefetcher::Run()
+	{
+		for(;;)
+		{
+			std::string Path;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				while(!Stop_ && !(Advised_<Depth_ && Advised_<Paths_.size()))
+					condition_.wait(lock);
+				if(Stop_)
+					return;
+				Path=Paths_[Advised_++];
+			}
+			//Opening a file can mean waiting on the disk, so not while we hold the lock.
+			WillNeed(Path,Bytes_);
+		}
+	}
+
+	void Prefetcher::WillNeed(const std::string& Path,size_t Bytes)
+	{
+#if !defined(_WIN32) && defined(POSIX_FADV_WILLNEED)
+		int fd=open(Path.c_str(),O_RDONLY);
+		if(fd<0)
+			return;//whoever reads it will find out why.
+		posix_fadvise(fd,0,off_t(Bytes),POSIX_FADV_WILLNEED);
+		//The pages stay in the cache once the file's closed.
+		close(fd);
+#endif
+	}
+}//namespace dicom
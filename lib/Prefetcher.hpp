@@ -0,0 +1,62 @@
+#ifndef PREFETCHER_HPP_INCLUDE_GUARD_5306118297
+#define PREFETCHER_HPP_INCLUDE_GUARD_5306118297
+#include <deque>
+#include <string>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+
+namespace dicom
+{
+	//!Gets the operating system reading the next few files of a batch while this one is decoded.
+	/*!
+		Files are handed out in the order they were pushed.  A thread of its
+		own keeps the kernel (with posix_fadvise(WILLNEED)) reading up to Depth
+		files ahead of the last one popped, so by the time a reader gets to a
+		file it's already in the page cache, and readers never wait for the
+		advice themselves.  It's only advice, so nothing is lost if the kernel
+		ignores it, or on platforms without it.
+
+		This pays on storage where each file costs a seek (e.g. spinning
+		disks, network file systems), and does nothing for files that are
+		already cached.  Usage, with the work on a ThreadPool:
+
+		Prefetcher prefetcher(16);
+		for each file
+		{
+			prefetcher.Push(Path);
+			pool.Post(a task that Pop()s a path and reads it);
+		}
+
+		Push() and Pop() may be called from any thread.
+	*/
+	class Prefetcher : boost::noncopyable
+	{
+	public:
+		//!Bytes is how much of the start of each file to ask for; 0 means all of it.
+		explicit Prefetcher(size_t Depth=16,size_t Bytes=0);
+		~Prefetcher();
+
+		void Push(const std::string& Path);
+
+		//!The next file, or false if there isn't one yet.
+		bool Pop(std::string& Path);
+
+		//!Ask for (the start of) a file to be read into the page cache.
+		static void WillNeed(const std::string& Path,size_t Bytes=0);
+
+	private:
+		void Run();
+
+		//!Paths_ that have been advised but not popped; always at its front.
+		size_t Advised_;
+		std::deque<std::string> Paths_;
+		bool Stop_;
+		boost::mutex mutex_;
+		boost::condition_variable condition_;
+		const size_t Depth_;
+		const size_t Bytes_;
+		boost::thread thread_;
+	};
+}//namespace dicom
+
+#endif //PREFETCHER_HPP_INCLUDE_GUARD_5306118297
@@ -0,0 +1,266 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include "Profiling.hpp"
+#include <set>
+#include <map>
+#include <algorithm>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include "Utility.hpp"
+
+namespace dicom
+{
+	namespace profiling
+	{
+		class Histogram : boost::noncopyable
+		{
+		public:
+			Histogram(const std::string& Name):Name_(Name)
+			{
+				Clear();
+			}
+
+			void Clear()
+			{
+				Count_.store(0);
+				Total_.store(0);
+				Max_.store(0);
+				for(size_t i=0;i<HistogramBuckets;i++)
+					Buckets_[i].store(0);
+			}
+
+			const std::string Name_;
+			boost::atomic<boost::uint64_t> Count_;
+			boost::atomic<boost::uint64_t> Total_;
+			boost::atomic<boost::uint64_t> Max_;
+			boost::atomic<boost::uint64_t> Buckets_[HistogramBuckets];
+		};
+
+		namespace
+		{
+			//!Only ever written by the thread it belongs to, but read by whoever takes a snapshot.
+			struct ThreadCounters
+			{
+				ThreadCounters()
+				{
+					for(size_t i=0;i<COUNTER_COUNT;i++)
+						Counts_[i].store(0);
+				}
+				boost::atomic<boost::uint64_t> Counts_[COUNTER_COUNT];
+			};
+
+			struct Registry
+			{
+				Registry()
+				{
+					std::fill(Retired_,Retired_+COUNTER_COUNT,0);
+					std::fill(Baseline_,Baseline_+COUNTER_COUNT,0);
+				}
+
+				//!Totals across every thread, living or not, since the start.
+				void Totals(boost::uint64_t* totals)
+				{
+					std::copy(Retired_,Retired_+COUNTER_COUNT,totals);
+					for(std::set<ThreadCounters*>::const_iterator I=Live_.begin();I!=Live_.end();I++)
+						for(size_t i=0;i<COUNTER_COUNT;i++)
+							totals[i]+=(*I)->Counts_[i].load(boost::memory_order_relaxed);
+				}
+
+				boost::mutex mutex_;
+				std::set<ThreadCounters*> Live_;
+				//!What threads that have finished counted.
+				boost::uint64_t Retired_[COUNTER_COUNT];
+				//!Totals() at the last Reset().
+				boost::uint64_t Baseline_[COUNTER_COUNT];
+				std::map<std::string,Histogram*> Histograms_;
+			};
+
+			/*
+				Neither of these is ever destroyed, as threads may still be counting
+				while statics are being torn down at exit.
+			*/
+			Registry& TheRegistry()
+			{
+				static Registry* registry=new Registry;
+				return *registry;
+			}
+
+			//!Called by boost.thread as a thread finishes.
+			void Retire(ThreadCounters* counters)
+			{
+				Registry& registry=TheRegistry();
+				boost::mutex::scoped_lock lock(registry.mutex_);
+				for(size_t i=0;i<COUNTER_COUNT;i++)
+					registry.Retired_[i]+=counters->Counts_[i].load();
+				registry.Live_.erase(counters);
+				delete counters;
+			}
+
+			ThreadCounters& Mine()
+			{
+				static boost::thread_specific_ptr<ThreadCounters>* mine=new boost::thread_specific_ptr<ThreadCounters>(Retire);
+				ThreadCounters* counters=mine->get();
+				if(!counters)
+				{
+					counters=new ThreadCounters;
+					Registry& registry=TheRegistry();
+					boost::mutex::scoped_lock lock(registry.mutex_);
+					registry.Live_.insert(counters);
+					mine->reset(counters);
+				}
+				return *counters;
+			}
+
+			//!How many bits it takes to write n down.
+			size_t Bucket(boost::uint64_t n)
+			{
+				size_t bits=0;
+				while(n)
+				{
+					bits++;
+					n>>=1;
+				}
+				return std::min(bits,HistogramBuckets-1);
+			}
+		}
+
+		const char* CounterName(Counter counter)
+		{
+			static const char* Names[COUNTER_COUNT]=
+			{
+				"bytes_decoded",
+				"elements_decoded",
+				"bytes_encoded",
+				"elements_encoded",
+				"allocations",
+				"pdus_sent",
+				"pdus_received",
+				"bytes_sent",
+				"bytes_received",
+				"syscalls"
+			};
+			return Names[counter];
+		}
+
+		bool Enabled()
+		{
+#ifdef DICOMLIB_PROFILING
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		void Count(Counter counter,boost::uint64_t n)
+		{
+			//Nobody else writes it, so there's no need for a locked add.
+			boost::atomic<boost::uint64_t>& count=Mine().Counts_[counter];
+			count.store(count.load(boost::memory_order_relaxed)+n,boost::memory_order_relaxed);
+		}
+
+		Histogram& GetHistogram(const char* Name)
+		{
+			Registry& registry=TheRegistry();
+			boost::mutex::scoped_lock lock(registry.mutex_);
+			Histogram*& histogram=registry.Histograms_[Name];
+			if(!histogram)
+				histogram=new Histogram(Name);
+			return *histogram;
+		}
+
+		void Record(Histogram& histogram,boost::uint64_t Nanoseconds)
+		{
+			histogram.Count_.fetch_add(1,boost::memory_order_relaxed);
+			histogram.Total_.fetch_add(Nanoseconds,boost::memory_order_relaxed);
+			histogram.Buckets_[Bucket(Nanoseconds)].fetch_add(1,boost::memory_order_relaxed);
+			boost::uint64_t Max=histogram.Max_.load(boost::memory_order_relaxed);
+			while(Nanoseconds>Max && !histogram.Max_.compare_exchange_weak(Max,Nanoseconds,boost::memory_order_relaxed))
+				;
+		}
+
+		ScopedProfiler::ScopedProfiler(Histogram& histogram)
+			:histogram_(histogram),start_(MonotonicNanoseconds())
+		{
+		}
+
+		ScopedProfiler::~ScopedProfiler()
+		{
+			Record(histogram_,MonotonicNanoseconds()-start_);
+		}
+
+		boost::uint64_t HistogramSnapshot::Percentile(double p) const
+		{
+			if(!Count_)
+				return 0;
+			const boost::uint64_t Wanted=std::max<boost::uint64_t>(1,boost::uint64_t(p*double(Count_)+0.5));
+			boost::uint64_t Seen=0;
+			for(size_t i=0;i+1<Buckets_.size();i++)
+			{
+				Seen+=Buckets_[i];
+				if(Seen>=Wanted)
+					return std::min(boost::uint64_t(1)<<i,MaxNanoseconds_);
+			}
+			return MaxNanoseconds_;
+		}
+
+		Snapshot TakeSnapshot()
+		{
+			Snapshot snapshot;
+			Registry& registry=TheRegistry();
+			boost::mutex::scoped_lock lock(registry.mutex_);
+			registry.Totals(snapshot.Counters_);
+			for(size_t i=0;i<COUNTER_COUNT;i++)
+				snapshot.Counters_[i]-=std::min(snapshot.Counters_[i],registry.Baseline_[i]);
+			for(std::map<std::string,Histogram*>::const_iterator I=registry.Histograms_.begin();I!=registry.Histograms_.end();I++)
+			{
+				const Histogram& histogram=*I->second;
+				HistogramSnapshot h;
+				h.Name_=histogram.Name_;
+				h.Count_=histogram.Count_.load();
+				h.TotalNanoseconds_=histogram.Total_.load();
+				h.MaxNanoseconds_=histogram.Max_.load();
+				for(size_t i=0;i<HistogramBuckets;i++)
+					h.Buckets_.push_back(histogram.Buckets_[i].load());
+				snapshot.Histograms_.push_back(h);
+			}
+			return snapshot;
+		}
+
+		void Reset()
+		{
+			/*
+				Threads' own counters can't be cleared under their feet, so we
+				remember where they'd got to and count from there.
+			*/
+			Registry& registry=TheRegistry();
+			boost::mutex::scoped_lock lock(registry.mutex_);
+			registry.Totals(registry.Baseline_);
+			for(std::map<std::string,Histogram*>::iterator I=registry.Histograms_.begin();I!=registry.Histograms_.end();I++)
+				I->second->Clear();
+		}
+
+		std::ostream& operator<<(std::ostream& out,const Snapshot& snapshot)
+		{
+			for(size_t i=0;i<COUNTER_COUNT;i++)
+				out << CounterName(Counter(i)) << " " << snapshot.Counters_[i] << std::endl;
+			for(std::vector<HistogramSnapshot>::const_iterator I=snapshot.Histograms_.begin();I!=snapshot.Histograms_.end();I++)
+			{
+				out << I->Name_ << " count=" << I->Count_;
+				if(I->Count_)
+				{
+					out << " mean_us=" << double(I->TotalNanoseconds_)/double(I->Count_)/1000.0
+						<< " p50_us=" << double(I->Percentile(0.5))/1000.0
+						<< " p99_us=" << double(I->Percentile(0.99))/1000.0
+						<< " max_us=" << double(I->MaxNanoseconds_)/1000.0;
+				}
+				out << std::endl;
+			}
+			return out;
+		}
+	}//namespace profiling
+}//namespace dicom
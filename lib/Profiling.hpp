@@ -0,0 +1,128 @@
+#ifndef PROFILING_HPP_INCLUDE_GUARD_3390418752
+#define PROFILING_HPP_INCLUDE_GUARD_3390418752
+#include <string>
+#include <vector>
+#include <ostream>
+#include <boost/cstdint.hpp>
+#include <boost/utility.hpp>
+
+/*
+	Instrumentation for the hot paths: counters of what's been done, and
+	histograms of how long it took.
+
+	This is only compiled in if DICOMLIB_PROFILING is defined (cmake
+	-DDICOMLIB_PROFILING=ON).  Otherwise DICOMLIB_COUNT() and DICOMLIB_PROFILE()
+	expand to nothing, so a normal build pays nothing at all for them.  The
+	snapshot interface is always there, so code that reports on it needn't
+	care; it just gets zeros.
+
+	Counters are kept per thread, so counting is never contended, and summed
+	when a snapshot is taken.  A thread's counts outlive it.
+*/
+namespace dicom
+{
+	namespace profiling
+	{
+		enum Counter
+		{
+			BYTES_DECODED,		//!<Passed to ReadFromBuffer()
+			ELEMENTS_DECODED,
+			BYTES_ENCODED,		//!<Produced by WriteToBuffer()
+			ELEMENTS_ENCODED,
+			ALLOCATIONS,		//!<Growth of network buffers: the read-ahead block, and message reassembly
+			PDUS_SENT,			//!<P-DATA-TF
+			PDUS_RECEIVED,		//!<P-DATA-TF
+			BYTES_SENT,
+			BYTES_RECEIVED,
+			SYSCALLS,			//!<send(), recv() and select() on association sockets
+			COUNTER_COUNT
+		};
+
+		//!The name a counter is reported under, e.g. "bytes_decoded"
+		const char* CounterName(Counter counter);
+
+		//!Is the instrumentation compiled in?
+		bool Enabled();
+
+		//!Latency histograms have a bucket per power of two nanoseconds.
+		const size_t HistogramBuckets=40;
+
+		struct HistogramSnapshot
+		{
+			std::string Name_;
+			boost::uint64_t Count_;
+			boost::uint64_t TotalNanoseconds_;
+			boost::uint64_t MaxNanoseconds_;
+			//!Buckets_[i] counts samples of less than 2^i ns (and at least 2^(i-1)); the last takes everything longer.
+			std::vector<boost::uint64_t> Buckets_;
+
+			//!Upper bound of the bucket the p'th fraction of samples fall in, in nanoseconds.  0<p<=1.
+			boost::uint64_t Percentile(double p) const;
+		};
+
+		struct Snapshot
+		{
+			boost::uint64_t Counters_[COUNTER_COUNT];
+			std::vector<HistogramSnapshot> Histograms_;
+		};
+
+		//!Everything counted and timed since the start, or the last Reset().
+		Snapshot TakeSnapshot();
+
+		//!Start counting and timing from zero.
+		void Reset();
+
+		//!Counters one per line, then a line per histogram with its count, mean, 50th, 99th and max.
+		std::ostream& operator<<(std::ostream& out,const Snapshot& snapshot);
+
+		//!Nanoseconds spent somewhere, shared by every thread going through there.
+		class Histogram;
+
+		//!Named histograms are created on first use, and live for as long as the program.
+		Histogram& GetHistogram(const char* Name);
+
+		void Record(Histogram& histogram,boost::uint64_t Nanoseconds);
+
+		//!Add n to this thread's count.
+		void Count(Counter counter,boost::uint64_t n);
+
+		//!Records how long it lived into a histogram.
+		class ScopedProfiler : boost::noncopyable
+		{
+		public:
+			explicit ScopedProfiler(Histogram& histogram);
+			~ScopedProfiler();
+		private:
+			Histogram& histogram_;
+			boost::uint64_t start_;
+		};
+	}//namespace profiling
+}//namespace dicom
+
+#define DICOMLIB_PROFILING_JOIN2(a,b) a##b
+#define DICOMLIB_PROFILING_JOIN(a,b) DICOMLIB_PROFILING_JOIN2(a,b)
+
+#ifdef DICOMLIB_PROFILING
+
+//!e.g. DICOMLIB_COUNT(PDUS_SENT,1);
+#define DICOMLIB_COUNT(counter,n) \
+	::dicom::profiling::Count(::dicom::profiling::counter,(n))
+
+//!Time the rest of the enclosing scope, into the histogram called name.
+/*!
+	The histogram is looked up once, the first time through.
+*/
+#define DICOMLIB_PROFILE(name) \
+	static ::dicom::profiling::Histogram& DICOMLIB_PROFILING_JOIN(dicomlib_histogram_,__LINE__)= \
+		::dicom::profiling::GetHistogram(name); \
+	::dicom::profiling::ScopedProfiler DICOMLIB_PROFILING_JOIN(dicomlib_profiler_,__LINE__) \
+		(DICOMLIB_PROFILING_JOIN(dicomlib_histogram_,__LINE__))
+
+#else
+
+#define DICOMLIB_COUNT(counter,n) ((void)0)
+#define DICOMLIB_PROFILE(name) ((void)0)
+
+#endif//DICOMLIB_PROFILING
+
+#endif //PROFILING_HPP_INCLUDE_GUARD_3390418752
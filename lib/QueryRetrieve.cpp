@@ -1,5 +1,6 @@
 #include "QueryRetrieve.hpp"
 #include "Exceptions.hpp"
+#include "UIDs.hpp"
 
 namespace dicom
 {
@@ -119,6 +120,40 @@ namespace dicom
 					throw exception("Invalid Query/Retrieve level value.");
 			}
 		}
+
+		UID FindSOPClass(Root root)
+		{
+			switch(root)
+			{
+			case STUDY_ROOT:
+				return STUDY_ROOT_QR_FIND_SOP_CLASS;
+			case PATIENT_ROOT:
+				return PATIENT_ROOT_QR_FIND_SOP_CLASS;
+			case PATIENT_STUDY_ONLY:
+				return PATIENT_STUDY_ONLY_QR_FIND_SOP_CLASS;
+			case MODALITY_WORKLIST:
+				return MODALITY_WORKLIST_SOP_CLASS;
+			case GENERAL_PURPOSE_WORKLIST:
+				return GENERAL_PURPOSE_WORKLIST_SOP_CLASS;
+			default:
+				throw dicom::exception("Unknown QR root specified.");
+			}
+		}
+
+		UID MoveSOPClass(Root root)
+		{
+			switch(root)
+			{
+			case STUDY_ROOT:
+				return STUDY_ROOT_QR_MOVE_SOP_CLASS;
+			case PATIENT_ROOT:
+				return PATIENT_ROOT_QR_MOVE_SOP_CLASS;
+			case PATIENT_STUDY_ONLY:
+				return PATIENT_STUDY_ONLY_QR_MOVE_SOP_CLASS;
+			default:
+				throw dicom::exception("Unknown QR root specified.");
+			}
+		}
 	}//namespace QueryRetrieve
 
 	//!should this be in the global namespace?
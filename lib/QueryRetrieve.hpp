@@ -2,6 +2,7 @@
 #define QUERY_RETRIEVE_HPP_INCLUDE_GUARD_U4DI92XIN23
 #include <string>
 #include "Tag.hpp"
+#include "UID.hpp"
 namespace dicom
 {
 	namespace QueryRetrieve
@@ -41,6 +42,12 @@ namespace dicom
 			MODALITY_WORKLIST, //K.6.1.4
 			GENERAL_PURPOSE_WORKLIST //K.6.2.4
 		};
+
+		//!SOP class for C-FIND at this root.
+		UID FindSOPClass(Root root);
+
+		//!SOP class for C-MOVE at this root.
+		UID MoveSOPClass(Root root);
 	}//namespace QueryRetrieve
 
 
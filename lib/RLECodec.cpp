@@ -0,0 +1,391 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <cstring>
+#include "RLECodec.hpp"
+#include "socket/Base.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+	The three plane (RGB) shuffles need SSSE3, which the default x86-64
+	target doesn't include, so on GCC/Clang they're compiled with a
+	per-function target attribute and chosen at run time.
+*/
+#if defined(__SSE2__) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DICOMLIB_RLE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+namespace dicom
+{
+	namespace
+	{
+		//!The RLE header is always little endian. (Part 5, G.5)
+		UINT32 ReadLE32(const BYTE* p)
+		{
+			return UINT32(p[0]) | (UINT32(p[1])<<8) | (UINT32(p[2])<<16) | (UINT32(p[3])<<24);
+		}
+
+		void WriteLE32(BYTE* p,UINT32 value)
+		{
+			for(int i=0;i<4;i++)
+				p[i]=BYTE(value>>(8*i));
+		}
+
+		//!PackBits decoding, see Part 5, G.3.1
+		void DecodeSegment(const BYTE* p,const BYTE* end,BYTE* Out,size_t Length)
+		{
+			BYTE* o=Out;
+			BYTE* OutEnd=Out+Length;
+			while(o<OutEnd && p<end)
+			{
+				int n=static_cast<signed char>(*p++);
+				if(n>=0)
+				{
+					size_t count=n+1;
+					if(count>size_t(end-p) || count>size_t(OutEnd-o))
+						throw CodecError("RLE literal run overflows segment");
+					std::memcpy(o,p,count);
+					p+=count;
+					o+=count;
+				}
+				else if(n!=-128)//-128 is a no-op
+				{
+					size_t count=1-n;
+					if(p==end || count>size_t(OutEnd-o))
+						throw CodecError("RLE replicate run overflows segment");
+					std::memset(o,*p++,count);
+					o+=count;
+				}
+			}
+			if(o!=OutEnd)
+				throw CodecError("RLE segment is too short");
+		}
+
+		/*!
+			PackBits encoding, see Part 5, G.3.1.  Runs of three or more identical
+			bytes are replicated, anything else goes out as literals.  The segment
+			is padded to an even length. (G.5)
+		*/
+		void EncodeSegment(const BYTE* p,size_t Length,std::vector<BYTE>& Out)
+		{
+			const BYTE* end=p+Length;
+			while(p<end)
+			{
+				const BYTE* run=p+1;
+				while(run<end && *run==*p && run-p<128)
+					run++;
+				if(run-p>=3)
+				{
+					Out.push_back(BYTE(1-(run-p)));
+					Out.push_back(*p);
+					p=run;
+					continue;
+				}
+
+				//literal run, up to the start of the next replicate run.
+				const BYTE* literal=p;
+				while(p<end && p-literal<128)
+				{
+					if(p+2<end && p[0]==p[1] && p[1]==p[2])
+						break;
+					p++;
+				}
+				Out.push_back(BYTE(p-literal-1));
+				Out.insert(Out.end(),literal,p);
+			}
+			if(Out.size() & 1)
+				Out.push_back(0);
+		}
+
+#ifdef DICOMLIB_RLE_SSSE3
+		//!pshufb masks for three planes <-> 48 interleaved bytes, 0x80 means zero.
+		struct ShuffleMasks
+		{
+			__m128i Interleave_[3][3];//[output block][plane]
+			__m128i Deinterleave_[3][3];//[plane][input block]
+
+			ShuffleMasks()
+			{
+				for(int j=0;j<3;j++)
+					for(int k=0;k<3;k++)
+					{
+						char in[16],out[16];
+						for(int t=0;t<16;t++)
+						{
+							int g=16*j+t;//interleaved byte g is plane g%3, pixel g/3
+							in[t]=(g%3==k) ? char(g/3) : char(0x80);
+							int h=3*t+k;//plane k, pixel t comes from interleaved byte h
+							out[t]=(h/16==j) ? char(h%16) : char(0x80);
+						}
+						Interleave_[j][k]=_mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+						Deinterleave_[k][j]=_mm_loadu_si128(reinterpret_cast<const __m128i*>(out));
+					}
+			}
+		};
+
+		const ShuffleMasks& Masks()
+		{
+			static const ShuffleMasks masks;
+			return masks;
+		}
+
+		bool HaveSSSE3()
+		{
+			static const bool Have=(__builtin_cpu_init(),__builtin_cpu_supports("ssse3")!=0);
+			return Have;
+		}
+
+		//!Interleaves whole 16 pixel blocks of three planes, returns pixels done.
+		__attribute__((target("ssse3")))
+		size_t Interleave3(const BYTE* const* Planes,size_t Pixels,BYTE* Out)
+		{
+			const ShuffleMasks& m=Masks();
+			size_t i=0;
+			for(;i+16<=Pixels;i+=16)
+			{
+				__m128i p[3];
+				for(int k=0;k<3;k++)
+					p[k]=_mm_loadu_si128(reinterpret_cast<const __m128i*>(Planes[k]+i));
+				for(int j=0;j<3;j++)
+				{
+					__m128i o=_mm_or_si128(_mm_or_si128(
+						_mm_shuffle_epi8(p[0],m.Interleave_[j][0]),
+						_mm_shuffle_epi8(p[1],m.Interleave_[j][1])),
+						_mm_shuffle_epi8(p[2],m.Interleave_[j][2]));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Out+3*i+16*j),o);
+				}
+			}
+			return i;
+		}
+
+		//!Inverse of Interleave3.
+		__attribute__((target("ssse3")))
+		size_t Deinterleave3(const BYTE* In,size_t Pixels,BYTE* const* Planes)
+		{
+			const ShuffleMasks& m=Masks();
+			size_t i=0;
+			for(;i+16<=Pixels;i+=16)
+			{
+				__m128i p[3];
+				for(int j=0;j<3;j++)
+					p[j]=_mm_loadu_si128(reinterpret_cast<const __m128i*>(In+3*i+16*j));
+				for(int k=0;k<3;k++)
+				{
+					__m128i o=_mm_or_si128(_mm_or_si128(
+						_mm_shuffle_epi8(p[0],m.Deinterleave_[k][0]),
+						_mm_shuffle_epi8(p[1],m.Deinterleave_[k][1])),
+						_mm_shuffle_epi8(p[2],m.Deinterleave_[k][2]));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Planes[k]+i),o);
+				}
+			}
+			return i;
+		}
+#endif
+
+		/*!
+			Out[i*Count+k]=Planes[k][i]
+		*/
+		void Interleave(const BYTE* const* Planes,size_t Count,size_t Pixels,BYTE* Out)
+		{
+			size_t i=0;
+#ifdef __SSE2__
+			if(2==Count)
+			{
+				for(;i+16<=Pixels;i+=16)
+				{
+					__m128i a=_mm_loadu_si128(reinterpret_cast<const __m128i*>(Planes[0]+i));
+					__m128i b=_mm_loadu_si128(reinterpret_cast<const __m128i*>(Planes[1]+i));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Out+2*i),_mm_unpacklo_epi8(a,b));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Out+2*i+16),_mm_unpackhi_epi8(a,b));
+				}
+			}
+			else if(4==Count)
+			{
+				for(;i+16<=Pixels;i+=16)
+				{
+					__m128i a=_mm_loadu_si128(reinterpret_cast<const __m128i*>(Planes[0]+i));
+					__m128i b=_mm_loadu_si128(reinterpret_cast<const __m128i*>(Planes[1]+i));
+					__m128i c=_mm_loadu_si128(reinterpret_cast<const __m128i*>(Planes[2]+i));
+					__m128i d=_mm_loadu_si128(reinterpret_cast<const __m128i*>(Planes[3]+i));
+					__m128i ab_lo=_mm_unpacklo_epi8(a,b),ab_hi=_mm_unpackhi_epi8(a,b);
+					__m128i cd_lo=_mm_unpacklo_epi8(c,d),cd_hi=_mm_unpackhi_epi8(c,d);
+					__m128i* o=reinterpret_cast<__m128i*>(Out+4*i);
+					_mm_storeu_si128(o,_mm_unpacklo_epi16(ab_lo,cd_lo));
+					_mm_storeu_si128(o+1,_mm_unpackhi_epi16(ab_lo,cd_lo));
+					_mm_storeu_si128(o+2,_mm_unpacklo_epi16(ab_hi,cd_hi));
+					_mm_storeu_si128(o+3,_mm_unpackhi_epi16(ab_hi,cd_hi));
+				}
+			}
+#endif
+#ifdef DICOMLIB_RLE_SSSE3
+			if(3==Count && HaveSSSE3())
+				i=Interleave3(Planes,Pixels,Out);
+#endif
+			for(;i<Pixels;i++)
+				for(size_t k=0;k<Count;k++)
+					Out[i*Count+k]=Planes[k][i];
+		}
+
+		/*!
+			Planes[k][i]=In[i*Count+k]
+		*/
+		void Deinterleave(const BYTE* In,size_t Count,size_t Pixels,BYTE* const* Planes)
+		{
+			size_t i=0;
+#ifdef __SSE2__
+			const __m128i LowBytes=_mm_set1_epi16(0x00ff);
+			if(2==Count)
+			{
+				for(;i+16<=Pixels;i+=16)
+				{
+					__m128i x=_mm_loadu_si128(reinterpret_cast<const __m128i*>(In+2*i));
+					__m128i y=_mm_loadu_si128(reinterpret_cast<const __m128i*>(In+2*i+16));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Planes[0]+i),
+						_mm_packus_epi16(_mm_and_si128(x,LowBytes),_mm_and_si128(y,LowBytes)));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Planes[1]+i),
+						_mm_packus_epi16(_mm_srli_epi16(x,8),_mm_srli_epi16(y,8)));
+				}
+			}
+			else if(4==Count)
+			{
+				for(;i+16<=Pixels;i+=16)
+				{
+					const __m128i* in=reinterpret_cast<const __m128i*>(In+4*i);
+					__m128i w=_mm_loadu_si128(in),x=_mm_loadu_si128(in+1);
+					__m128i y=_mm_loadu_si128(in+2),z=_mm_loadu_si128(in+3);
+					//even bytes hold planes 0 and 2, odd bytes planes 1 and 3.
+					__m128i e0=_mm_packus_epi16(_mm_and_si128(w,LowBytes),_mm_and_si128(x,LowBytes));
+					__m128i e1=_mm_packus_epi16(_mm_and_si128(y,LowBytes),_mm_and_si128(z,LowBytes));
+					__m128i o0=_mm_packus_epi16(_mm_srli_epi16(w,8),_mm_srli_epi16(x,8));
+					__m128i o1=_mm_packus_epi16(_mm_srli_epi16(y,8),_mm_srli_epi16(z,8));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Planes[0]+i),
+						_mm_packus_epi16(_mm_and_si128(e0,LowBytes),_mm_and_si128(e1,LowBytes)));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Planes[2]+i),
+						_mm_packus_epi16(_mm_srli_epi16(e0,8),_mm_srli_epi16(e1,8)));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Planes[1]+i),
+						_mm_packus_epi16(_mm_and_si128(o0,LowBytes),_mm_and_si128(o1,LowBytes)));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(Planes[3]+i),
+						_mm_packus_epi16(_mm_srli_epi16(o0,8),_mm_srli_epi16(o1,8)));
+				}
+			}
+#endif
+#ifdef DICOMLIB_RLE_SSSE3
+			if(3==Count && HaveSSSE3())
+				i=Deinterleave3(In,Pixels,Planes);
+#endif
+			for(;i<Pixels;i++)
+				for(size_t k=0;k<Count;k++)
+					Planes[k][i]=In[i*Count+k];
+		}
+
+		/*!
+			Works out which segment goes where.  Segment order is fixed by the
+			standard, (sample by sample, most significant byte first) but the
+			order of bytes in a pixel depends on planar configuration and host
+			byte order.
+		*/
+		struct Layout
+		{
+			Layout(const ImageInfo& Image)
+			{
+				if(Image.BitsAllocated_ & 7)
+					throw CodecError("Bits Allocated must be a multiple of 8 for RLE");
+				BytesPerSample_=Image.BitsAllocated_/8;
+				Samples_=Image.SamplesPerPixel_;
+				Segments_=BytesPerSample_*Samples_;
+				Pixels_=Image.Pixels();
+				if(0==Segments_ || Segments_>15)
+					throw CodecError("Too many RLE segments for image");
+				if(0==Pixels_)
+					throw CodecError("Image has no pixels");
+
+				//a 'group' is a run of bytes that gets interleaved together.
+				Planar_=(1==Image.PlanarConfiguration_) && Samples_>1;
+				GroupSize_=Planar_ ? BytesPerSample_ : Segments_;
+			}
+
+			//!Which segment holds byte k of each pixel in group G?
+			size_t Segment(size_t G,size_t k) const
+			{
+				size_t Sample=Planar_ ? G : k/BytesPerSample_;
+				size_t Byte=k%BytesPerSample_;
+				if(__BYTE_ORDER==__LITTLE_ENDIAN)
+					Byte=BytesPerSample_-1-Byte;
+				return Sample*BytesPerSample_+Byte;
+			}
+
+			size_t Groups() const{return Segments_/GroupSize_;}
+
+			size_t BytesPerSample_,Samples_,Segments_,Pixels_,GroupSize_;
+			bool Planar_;
+		};
+	}
+
+	void RLECodec::Decode(const std::vector<BYTE>& Encoded,const ImageInfo& Image,BYTE* Frame)
+	{
+		if(Encoded.size()<64)
+			throw CodecError("RLE frame is too short for its header");
+
+		Layout layout(Image);
+		const BYTE* pData=&Encoded[0];
+		if(ReadLE32(pData)!=layout.Segments_)
+			throw CodecError("Number of RLE segments doesn't match image");
+
+		const size_t Pixels=layout.Pixels_;
+		std::vector<BYTE> Planes;
+		if(layout.GroupSize_>1)
+			Planes.resize(layout.Segments_*Pixels);
+
+		for(size_t G=0;G<layout.Groups();G++)
+		{
+			BYTE* Out=Frame+G*layout.GroupSize_*Pixels;
+			const BYTE* Group[15];
+			for(size_t k=0;k<layout.GroupSize_;k++)
+			{
+				size_t i=layout.Segment(G,k);
+				UINT32 Begin=ReadLE32(pData+4+i*4);
+				UINT32 End=(i+1<layout.Segments_) ? ReadLE32(pData+8+i*4) : UINT32(Encoded.size());
+				if(Begin<64 || End<Begin || End>Encoded.size())
+					throw CodecError("Bad RLE segment offset");
+
+				//a single byte plane can go straight onto the frame
+				BYTE* Plane=(1==layout.GroupSize_) ? Out : &Planes[i*Pixels];
+				DecodeSegment(pData+Begin,pData+End,Plane,Pixels);
+				Group[k]=Plane;
+			}
+			if(layout.GroupSize_>1)
+				Interleave(Group,layout.GroupSize_,Pixels,Out);
+		}
+	}
+
+	void RLECodec::Encode(const BYTE* Frame,const ImageInfo& Image,std::vector<BYTE>& Encoded)
+	{
+		Layout layout(Image);
+		const size_t Pixels=layout.Pixels_;
+
+		std::vector<BYTE> Planes(layout.Segments_*Pixels);
+		for(size_t G=0;G<layout.Groups();G++)
+		{
+			BYTE* Group[15];
+			for(size_t k=0;k<layout.GroupSize_;k++)
+				Group[k]=&Planes[layout.Segment(G,k)*Pixels];
+			Deinterleave(Frame+G*layout.GroupSize_*Pixels,layout.GroupSize_,Pixels,Group);
+		}
+
+		Encoded.assign(64,0);
+		WriteLE32(&Encoded[0],UINT32(layout.Segments_));
+		for(size_t i=0;i<layout.Segments_;i++)
+		{
+			WriteLE32(&Encoded[4+i*4],UINT32(Encoded.size()));
+			EncodeSegment(&Planes[i*Pixels],Pixels,Encoded);
+		}
+	}
+}//namespace dicom
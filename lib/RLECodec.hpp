@@ -0,0 +1,27 @@
+#ifndef RLE_CODEC_HPP_INCLUDE_GUARD_4409127365
+#define RLE_CODEC_HPP_INCLUDE_GUARD_4409127365
+#include "Codec.hpp"
+
+namespace dicom
+{
+	//!RLE Lossless compression, as described in Part 5, Annex G.
+	/*!
+		Each frame is one fragment, starting with a 64 byte header that gives the
+		number of segments and their offsets.  Each segment holds one byte of one
+		sample for every pixel, compressed with the PackBits algorithm.  Segments are
+		ordered by sample, and within a sample most significant byte first.
+
+		Most of the work in decoding 16 bit or colour images is scattering the
+		byte planes back into pixels (and gathering them up again when encoding.)
+		Where the compiler allows it we do this with SSE2 shuffles, 16 pixels at a
+		time, and for three sample images with SSSE3 if the CPU has it.
+	*/
+	class RLECodec : public Codec
+	{
+	public:
+		virtual void Decode(const std::vector<BYTE>& Encoded,const ImageInfo& Image,BYTE* Frame);
+		virtual void Encode(const BYTE* Frame,const ImageInfo& Image,std::vector<BYTE>& Encoded);
+	};
+}//namespace dicom
+
+#endif //RLE_CODEC_HPP_INCLUDE_GUARD_4409127365
@@ -0,0 +1,412 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include "Reactor.hpp"
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/weak_ptr.hpp>
+#include "socket/Socket.hpp"
+#include "Types.hpp"
+
+namespace dicom
+{
+	void SetNonBlocking(int Descriptor)
+	{
+		int flags=fcntl(Descriptor,F_GETFL,0);
+		if(flags<0 || fcntl(Descriptor,F_SETFL,flags|O_NONBLOCK)<0)
+			throw ReactorError("Couldn't make descriptor non-blocking");
+	}
+
+	namespace
+	{
+		//!Errors and hangups are always reported, whatever we ask for.
+		UINT32 Interest(bool Readable,bool Writable)
+		{
+			return (Readable ? UINT32(EPOLLIN|EPOLLRDHUP) : 0u)|(Writable ? UINT32(EPOLLOUT) : 0u);
+		}
+
+		//!Calls a function once a timer, armed by Arm(), goes off.
+		class Timer : public EventHandler
+		{
+			int timer_;
+			boost::function<void()> Expired_;
+		public:
+			Timer(const boost::function<void()>& Expired)
+				:timer_(timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC)),Expired_(Expired)
+			{
+				if(timer_<0)
+					throw ReactorError("Couldn't create timer");
+			}
+
+			~Timer()
+			{
+				close(timer_);
+			}
+
+			void Arm(long Milliseconds)
+			{
+				itimerspec when={};
+				when.it_value.tv_sec=Milliseconds/1000;
+				when.it_value.tv_nsec=(Milliseconds%1000)*1000000;
+				timerfd_settime(timer_,0,&when,0);
+			}
+
+			virtual int GetDescriptor() const
+			{
+				return timer_;
+			}
+
+			virtual bool OnReadable()
+			{
+				uint64_t expirations;
+				if(read(timer_,&expirations,sizeof(expirations))>0)
+					Expired_();
+				return true;
+			}
+
+			virtual bool OnWritable()
+			{
+				return true;
+			}
+
+			virtual void OnClosed()
+			{
+			}
+		};
+
+		//!Hands each new connection on a listening socket to a Factory.
+		class Acceptor : public EventHandler,public boost::enable_shared_from_this<Acceptor>
+		{
+			Network::ServerSocket socket_;
+			Reactor::Factory MakeHandler_;
+			//!Kept open so that, out of descriptors, we can still accept and drop connections.
+			int spare_;
+			//!Set up the first time we have to stop accepting for a while.
+			boost::shared_ptr<Timer> backoff_;
+
+			//!How long to stop accepting for, if the kernel can't give us connections.
+			static const long BackoffMilliseconds=100;
+
+			static void Resume(const boost::weak_ptr<Acceptor>& acceptor)
+			{
+				if(boost::shared_ptr<Acceptor> a=acceptor.lock())
+					a->WatchReadable(true);
+			}
+
+			/*!
+				With no descriptors left, the pending connection stays queued and
+				the (level triggered) listener stays readable, so we'd spin.  Free
+				the spare descriptor, accept the connection with it and close it
+				straight away; the peer sees a reset rather than a hang.
+			*/
+			bool Shed()
+			{
+				if(spare_<0)
+					return false;
+				close(spare_);
+				int fd=accept4(GetDescriptor(),0,0,SOCK_CLOEXEC);
+				if(fd>=0)
+					close(fd);
+				spare_=open("/dev/null",O_RDONLY|O_CLOEXEC);
+				return fd>=0;
+			}
+
+			//!Stop watching the listener, and start again in a while.
+			void Backoff()
+			{
+				if(!backoff_)
+				{
+					backoff_.reset(new Timer(boost::bind(&Acceptor::Resume,boost::weak_ptr<Acceptor>(shared_from_this()))));
+					GetReactor()->Add(backoff_);
+				}
+				WatchReadable(false);
+				backoff_->Arm(BackoffMilliseconds);
+			}
+
+		public:
+			Acceptor(short Port,const Reactor::Factory& MakeHandler)
+				:socket_(Port),MakeHandler_(MakeHandler),spare_(open("/dev/null",O_RDONLY|O_CLOEXEC))
+			{
+				SetNonBlocking(socket_.GetSocketDescriptor());
+				//ServerSocket's backlog is sized for a thread per connection, we can
+				//take connections much faster than that.  (linux lets us just call listen again)
+				listen(socket_.GetSocketDescriptor(),SOMAXCONN);
+			}
+
+			~Acceptor()
+			{
+				if(spare_>=0)
+					close(spare_);
+			}
+
+			virtual int GetDescriptor() const
+			{
+				return socket_.GetSocketDescriptor();
+			}
+
+			virtual bool OnReadable()
+			{
+				for(;;)
+				{
+					int fd=accept4(GetDescriptor(),0,0,SOCK_NONBLOCK|SOCK_CLOEXEC);
+					if(fd<0)
+					{
+						switch(errno)
+						{
+						case EAGAIN:
+#if EWOULDBLOCK!=EAGAIN
+						case EWOULDBLOCK:
+#endif
+							return true;//the normal way out.
+						case EINTR:
+						case ECONNABORTED://the peer gave up before we got to it.
+							continue;
+						case EMFILE:
+						case ENFILE:
+							if(Shed())
+								continue;
+							Backoff();
+							return true;
+						default://e.g. ENOBUFS, ENOMEM: give the kernel a moment.
+							Backoff();
+							return true;
+						}
+					}
+					boost::shared_ptr<EventHandler> handler;
+					try
+					{
+						handler=MakeHandler_(fd);
+					}
+					catch(std::exception&)
+					{
+					}
+					if(handler)
+						GetReactor()->Add(handler);
+					else
+						close(fd);
+				}
+			}
+
+			virtual bool OnWritable()
+			{
+				return true;
+			}
+
+			virtual void OnClosed()
+			{
+			}
+		};
+	}
+
+	void EventHandler::WatchWritable(bool Watch)
+	{
+		writable_=Watch;
+		if(reactor_)
+			reactor_->Watch(*this);
+	}
+
+	void EventHandler::WatchReadable(bool Watch)
+	{
+		readable_=Watch;
+		if(reactor_)
+			reactor_->Watch(*this);
+	}
+
+	Reactor::Loop::Loop()
+		:epoll_(epoll_create1(EPOLL_CLOEXEC)),wake_(eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC)),stop_(false)
+	{
+		if(epoll_<0 || wake_<0)
+			throw ReactorError("Couldn't create epoll instance");
+		epoll_event event={};
+		event.events=EPOLLIN;
+		event.data.fd=wake_;
+		if(epoll_ctl(epoll_,EPOLL_CTL_ADD,wake_,&event)<0)
+			throw ReactorError("Couldn't watch wake up descriptor");
+	}
+
+	Reactor::Loop::~Loop()
+	{
+		close(wake_);
+		close(epoll_);
+	}
+
+	Reactor::Reactor(size_t Threads)
+		:Next_(0)
+	{
+		if(0==Threads)
+			Threads=boost::thread::hardware_concurrency();
+		if(0==Threads)
+			Threads=1;
+		for(size_t i=0;i<Threads;i++)
+			loops_.push_back(boost::shared_ptr<Loop>(new Loop));
+		for(size_t i=0;i<Threads;i++)
+			threads_.create_thread(boost::bind(&Reactor::Run,this,boost::ref(*loops_[i])));
+	}
+
+	Reactor::~Reactor()
+	{
+		for(size_t i=0;i<loops_.size();i++)
+		{
+			{
+				boost::mutex::scoped_lock lock(loops_[i]->mutex_);
+				loops_[i]->stop_=true;
+			}
+			uint64_t one=1;
+			ssize_t n=write(loops_[i]->wake_,&one,sizeof(one));
+			(void)n;
+		}
+		threads_.join_all();
+
+		//loops have stopped, so it's safe to close handlers from this thread.
+		for(size_t i=0;i<loops_.size();i++)
+		{
+			Loop& loop=*loops_[i];
+			while(!loop.handlers_.empty())
+				Close(loop,loop.handlers_.begin()->first);
+		}
+	}
+
+	void Reactor::Add(boost::shared_ptr<EventHandler> Handler,bool Writable)
+	{
+		size_t Index;
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			Index=Next_++%loops_.size();
+		}
+		Handler->reactor_=this;
+		Handler->loop_=Index;
+		Handler->writable_=Writable;
+
+		Loop& loop=*loops_[Index];
+		int fd=Handler->GetDescriptor();
+		boost::mutex::scoped_lock lock(loop.mutex_);
+		loop.handlers_[fd]=Handler;
+
+		epoll_event event={};
+		event.events=Interest(Handler->readable_,Writable);
+		event.data.fd=fd;
+		if(epoll_ctl(loop.epoll_,EPOLL_CTL_ADD,fd,&event)<0)
+		{
+			loop.handlers_.erase(fd);
+			Handler->reactor_=0;
+			throw ReactorError("Couldn't add descriptor to reactor");
+		}
+	}
+
+	void Reactor::Listen(short Port,const Factory& MakeHandler)
+	{
+		Add(boost::shared_ptr<Acceptor>(new Acceptor(Port,MakeHandler)));
+	}
+
+	size_t Reactor::Count()
+	{
+		size_t count=0;
+		for(size_t i=0;i<loops_.size();i++)
+		{
+			boost::mutex::scoped_lock lock(loops_[i]->mutex_);
+			count+=loops_[i]->handlers_.size();
+		}
+		return count;
+	}
+
+	void Reactor::Watch(EventHandler& Handler)
+	{
+		epoll_event event={};
+		event.events=Interest(Handler.readable_,Handler.writable_);
+		event.data.fd=Handler.GetDescriptor();
+		//fails harmlessly if the handler has already been closed.
+		epoll_ctl(loops_[Handler.loop_]->epoll_,EPOLL_CTL_MOD,event.data.fd,&event);
+	}
+
+	void Reactor::Close(Loop& loop,int Descriptor)
+	{
+		boost::shared_ptr<EventHandler> handler;
+		{
+			boost::mutex::scoped_lock lock(loop.mutex_);
+			std::map<int,boost::shared_ptr<EventHandler> >::iterator i=loop.handlers_.find(Descriptor);
+			if(i==loop.handlers_.end())
+				return;
+			handler=i->second;
+			loop.handlers_.erase(i);
+			epoll_ctl(loop.epoll_,EPOLL_CTL_DEL,Descriptor,0);
+		}
+		try
+		{
+			handler->OnClosed();
+		}
+		catch(std::exception&)
+		{
+		}
+	}
+
+	void Reactor::Run(Loop& loop)
+	{
+		const int MaxEvents=64;
+		epoll_event events[MaxEvents];
+		for(;;)
+		{
+			int n=epoll_wait(loop.epoll_,events,MaxEvents,-1);
+			if(n<0)
+			{
+				if(EINTR==errno)
+					continue;
+				return;//nothing sensible we can do.
+			}
+			for(int i=0;i<n;i++)
+			{
+				int fd=events[i].data.fd;
+				if(fd==loop.wake_)
+				{
+					boost::mutex::scoped_lock lock(loop.mutex_);
+					if(loop.stop_)
+						return;
+					continue;
+				}
+
+				boost::shared_ptr<EventHandler> handler;
+				{
+					boost::mutex::scoped_lock lock(loop.mutex_);
+					std::map<int,boost::shared_ptr<EventHandler> >::iterator h=loop.handlers_.find(fd);
+					if(h==loop.handlers_.end())
+						continue;//closed earlier in this batch.
+					handler=h->second;
+				}
+
+				bool open=true;
+				try
+				{
+					//read before looking at errors/hangups, so we don't lose anything the peer
+					//sent just before closing.
+					if(events[i].events & (EPOLLIN|EPOLLRDHUP|EPOLLHUP|EPOLLERR))
+						open=handler->OnReadable();
+					if(open && (events[i].events & EPOLLOUT))
+						open=handler->OnWritable();
+					if(open && (events[i].events & (EPOLLHUP|EPOLLERR)))
+						open=false;
+				}
+				catch(std::exception&)
+				{
+					open=false;
+				}
+				if(!open)
+					Close(loop,fd);
+			}
+		}
+	}
+}//namespace dicom
+
+#endif //__linux__
@@ -0,0 +1,137 @@
+#ifndef REACTOR_HPP_INCLUDE_GUARD_3360185527
+#define REACTOR_HPP_INCLUDE_GUARD_3360185527
+/*
+	The Reactor is built on epoll, so it's only available on linux.
+	Other platforms still have the blocking ClientConnection.
+*/
+#ifdef __linux__
+
+#include <map>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+#include "Exceptions.hpp"
+
+namespace dicom
+{
+	class Reactor;
+
+	//!Something with a descriptor that the Reactor can watch.
+	/*!
+		A handler belongs to exactly one of the reactor's threads, and its
+		On...() functions are only ever called from that thread, so they
+		don't need to lock against each other.  They should never block.
+	*/
+	class EventHandler : boost::noncopyable
+	{
+	public:
+		EventHandler():reactor_(0),loop_(0),readable_(true),writable_(false){}
+		virtual ~EventHandler(){}
+
+		//!Must be non-blocking.
+		virtual int GetDescriptor() const=0;
+
+		//!Descriptor has data, or a connection to accept.  Return false to be closed.
+		virtual bool OnReadable()=0;
+
+		//!Descriptor can take more data.  Return false to be closed.
+		virtual bool OnWritable()=0;
+
+		//!Called once, after the descriptor has been removed from the reactor.
+		virtual void OnClosed()=0;
+
+	protected:
+		//!Ask for OnWritable() calls, or stop asking.  May be called from any thread.
+		void WatchWritable(bool Watch);
+
+		//!Stop OnReadable() calls, or start them again.
+		/*!
+			While a socket isn't being read, what arrives waits in the kernel, and
+			once that fills up TCP stops the peer sending any more.  May be called
+			from any thread, but not at the same time as WatchWritable().
+		*/
+		void WatchReadable(bool Watch);
+
+		//!The reactor this handler was added to, or 0.
+		Reactor* GetReactor() const{return reactor_;}
+
+	private:
+		friend class Reactor;
+		Reactor* reactor_;
+		size_t loop_;
+		bool readable_;
+		bool writable_;
+	};
+
+	//!Demultiplexes events on many non-blocking descriptors onto a few threads.
+	/*!
+		Each thread runs its own epoll loop, and handlers are spread across the
+		loops as they are added.  This lets a single process hold thousands of
+		associations open without a thread for each one.
+
+		Errors thrown out of a handler close that handler, they never reach
+		the loop.
+	*/
+	class Reactor : boost::noncopyable
+	{
+	public:
+		//!Called with a freshly accepted (non-blocking) descriptor, must take ownership of it.
+		typedef boost::function<boost::shared_ptr<EventHandler> (int)> Factory;
+
+		//!Zero threads means one per hardware thread.
+		Reactor(size_t Threads=0);
+
+		//!Stops the loops and closes every handler that's still open.
+		~Reactor();
+
+		//!Start watching Handler's descriptor for input, and for output if Writable.
+		void Add(boost::shared_ptr<EventHandler> Handler,bool Writable=false);
+
+		//!Accept connections on Port, creating a handler for each with MakeHandler.
+		void Listen(short Port,const Factory& MakeHandler);
+
+		//!Number of handlers currently open, including listeners.
+		size_t Count();
+
+		size_t Size() const{return loops_.size();}
+
+	private:
+		friend class EventHandler;
+
+		struct Loop : boost::noncopyable
+		{
+			Loop();
+			~Loop();
+			int epoll_;
+			int wake_;
+			bool stop_;
+			boost::mutex mutex_;
+			std::map<int,boost::shared_ptr<EventHandler> > handlers_;
+		};
+
+		void Run(Loop& loop);
+		void Close(Loop& loop,int Descriptor);
+		void Watch(EventHandler& Handler);
+
+		std::vector<boost::shared_ptr<Loop> > loops_;
+		boost::mutex mutex_;
+		size_t Next_;
+		boost::thread_group threads_;
+	};
+
+	//!Thrown if the reactor can't be set up, or a descriptor can't be added to it.
+	struct ReactorError : public dicom::exception
+	{
+		ReactorError(std::string Description):dicom::exception(Description){}
+		virtual ~ReactorError() throw(){}
+	};
+
+	//!Put a descriptor into non-blocking mode.
+	void SetNonBlocking(int Descriptor);
+}//namespace dicom
+
+#endif //__linux__
+
+#endif //REACTOR_HPP_INCLUDE_GUARD_3360185527
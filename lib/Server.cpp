@@ -0,0 +1,745 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <deque>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include "Server.hpp"
+#include "AsyncAssociation.hpp"
+#include "Profiling.hpp"
+#include "Utility.hpp"
+#include "ImplementationUID.hpp"
+#include "aarj.hpp"
+#include "UIDs.hpp"
+
+namespace dicom
+{
+	using namespace primitive;
+
+	namespace
+	{
+		//!PresentationContextAccept::Result_, see Part 8, table 9-18
+		const BYTE ACCEPTANCE=0;
+		const BYTE ABSTRACT_SYNTAX_NOT_SUPPORTED=3;
+		const BYTE TRANSFER_SYNTAXES_NOT_SUPPORTED=4;
+
+		UINT32 ReadBigEndian(const BYTE* p)
+		{
+			return (UINT32(p[0])<<24)|(UINT32(p[1])<<16)|(UINT32(p[2])<<8)|UINT32(p[3]);
+		}
+
+		//!An association being served by one of the blocking models.
+		class BlockingAssociation : public ServiceBase
+		{
+			boost::shared_ptr<Network::Socket> socket_;
+		public:
+			BlockingAssociation(boost::shared_ptr<Network::Socket> socket):socket_(socket){}
+			virtual Network::Socket* GetSocket(){return socket_.get();}
+		};
+
+#ifdef __linux__
+		//!Passes whatever ServiceBase writes on to an AsyncAssociation.
+		/*!
+			ServiceBase::Write() sends each PDU's header and data separately, so
+			we hang on to them until we've got whole PDUs.
+		*/
+		class PDataSocket : public Network::Socket
+		{
+			AsyncAssociation& association_;
+			mutable std::vector<BYTE> Pending_;
+		public:
+			PDataSocket(AsyncAssociation& association):association_(association){}
+
+			virtual const SOCKET GetSocketDescriptor() const
+			{
+				return SOCKET(-1);
+			}
+			virtual const std::string get_remote_ip() const
+			{
+				return std::string("");
+			}
+
+		protected:
+			virtual int ReceiveBytes(void*,int)
+			{
+				throw Network::ConnectionLost("Requests come from the association, not the socket");
+			}
+
+			virtual int SendBytes(const void* Data,int BytesToSend) const
+			{
+				const BYTE* p=static_cast<const BYTE*>(Data);
+				Pending_.insert(Pending_.end(),p,p+BytesToSend);
+
+				size_t Complete=0;
+				while(Pending_.size()-Complete>=6)
+				{
+					const size_t Length=6+ReadBigEndian(&Pending_[Complete+2]);
+					if(Pending_.size()-Complete<Length)
+						break;
+					Complete+=Length;
+				}
+				if(Complete)
+				{
+					association_.SendPData(&Pending_[0],&Pending_[0]+Complete);
+					Pending_.erase(Pending_.begin(),Pending_.begin()+Complete);
+				}
+				return BytesToSend;
+			}
+		};
+#endif
+	}
+
+#ifdef __linux__
+	//!One association in the REACTOR model.
+	/*!
+		Messages arrive already decoded from the reactor, and queue up here
+		until a worker gets round to them.  Read() hands them out in order, so
+		the handlers in Cdimse.hpp see the same ServiceBase they would on a
+		blocking association, and can even wait for replies (e.g. C-GET
+		waiting for its C-STORE responses.)
+	*/
+	struct Server::Session : public ServiceBase
+	{
+		Session(Server& server,boost::shared_ptr<AsyncAssociation> association)
+			:server_(server),association_(association),socket_(*association)
+			,CommandRead_(false),Busy_(false),Closed_(false),Waiting_(false)
+		{
+			//AAssociateRQ can't be assigned, because of its const application context.
+			const AAssociateRQ& request=association->GetRequest();
+			AAssociateRQ_.CalledAppTitle_=request.CalledAppTitle_;
+			AAssociateRQ_.CallingAppTitle_=request.CallingAppTitle_;
+			AAssociateRQ_.ProposedPresentationContexts_=request.ProposedPresentationContexts_;
+			AAssociateRQ_.UserInfo_=request.UserInfo_;
+			AcceptedPresentationContexts_=association->GetAccepted();
+			PeerMaxPDULength_=AAssociateRQ_.UserInfo_.MaxSubLength_.MaximumLength_;
+			RecordEstablished();
+		}
+
+		virtual Network::Socket* GetSocket(){return &socket_;}
+
+		//!Blocks until the next command or data set arrives.  Throws if the association goes.
+		virtual bool Read(DataSet& command_or_data)
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if(Messages_.empty() && !Closed_)
+			{
+				//e.g. C-GET waiting for a C-STORE-RSP, so reading mustn't be suspended.
+				server_.Waiting(*this,true);
+				while(Messages_.empty() && !Closed_)
+					arrived_.wait(lock);
+				server_.Waiting(*this,false);
+			}
+			if(Closed_)
+				throw Network::ConnectionLost();
+
+			Message& message=Messages_.front();
+			CurrentPresentationContextID_=message.PresentationContextID_;
+			if(!CommandRead_)
+			{
+				command_or_data=message.Command_;
+				RecordReceived(command_or_data,MessageControlHeader::COMMAND);
+				if(message.HasData_)
+				{
+					CommandRead_=true;
+					return true;
+				}
+			}
+			else
+			{
+				command_or_data=message.Data_;
+				RecordReceived(command_or_data,MessageControlHeader::DATASET);
+				CommandRead_=false;
+			}
+			const bool Request=IsRequest(message);
+			Messages_.pop_front();
+			if(Request)
+				server_.Handled(1);
+			return true;
+		}
+
+		//!Only requests count toward the server's backlog, someone's already waiting for a response.
+		static bool IsRequest(const Message& message)
+		{
+			if(!message.Command_.exists(TAG_CMD_FIELD))
+				return true;
+			Command::Code cmd;
+			message.Command_(TAG_CMD_FIELD)>>cmd;
+			return !(cmd bitand 0x8000);
+		}
+
+		//!True if nobody's handling requests yet, so a worker should be set on to Run().
+		bool Push(const Message& message)
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if(Closed_)
+			{
+				if(IsRequest(message))
+					server_.Handled(1);//dropped.
+				return false;
+			}
+			Messages_.push_back(message);
+			arrived_.notify_all();
+			if(Busy_)
+				return false;
+			Busy_=true;
+			return true;
+		}
+
+		void Close()
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			Closed_=true;
+			server_.Handled(std::count_if(Messages_.begin(),Messages_.end(),&IsRequest));
+			Messages_.clear();
+			arrived_.notify_all();
+		}
+
+		//!Handle requests until there are none left.
+		void Run()
+		{
+			for(;;)
+			{
+				{
+					boost::mutex::scoped_lock lock(mutex_);
+					if(Messages_.empty() || Closed_)
+					{
+						Busy_=false;
+						return;
+					}
+				}
+				try
+				{
+					DataSet command;
+					Read(command);
+					server_.Dispatch(*this,command);
+				}
+				catch(std::exception&)
+				{
+					association_->Abort();
+					Close();
+					return;
+				}
+
+				//something the handler wasn't interested in may have left its data set behind.
+				boost::mutex::scoped_lock lock(mutex_);
+				if(CommandRead_)
+				{
+					CommandRead_=false;
+					const bool Request=IsRequest(Messages_.front());
+					Messages_.pop_front();
+					if(Request)
+						server_.Handled(1);
+				}
+			}
+		}
+
+		Server& server_;
+		boost::shared_ptr<AsyncAssociation> association_;
+		PDataSocket socket_;
+
+		boost::mutex mutex_;
+		boost::condition_variable arrived_;
+		std::deque<Message> Messages_;
+		//!The front message's command has been read, but not its data set.
+		bool CommandRead_;
+		bool Busy_;
+		bool Closed_;
+		//!A worker is blocked in Read().  Guarded by the server's mutex_, not ours.
+		bool Waiting_;
+	};
+#endif
+
+	Server::Server(short Port,const std::string& AET,Model model,size_t Threads,UINT32 MaxPDULength)
+		:Port_(Port),AET_(AET),Model_(model),Threads_(Threads),MaxPDULength_(MaxPDULength)
+		,QueueCapacity_(64),Running_(false),Stopping_(false),Associations_(0),Suspended_(false)
+	{
+		TransferSyntaxes_.push_back(IMPL_VR_LE_TRANSFER_SYNTAX);
+		TransferSyntaxes_.push_back(EXPL_VR_LE_TRANSFER_SYNTAX);
+		TransferSyntaxes_.push_back(EXPL_VR_BE_TRANSFER_SYNTAX);
+	}
+
+	Server::~Server()
+	{
+		Stop();
+	}
+
+	void Server::AddStoreHandler(const UID& classUID,CStoreFunction handler)
+	{
+		StoreHandlers_[classUID]=handler;
+	}
+
+	void Server::AddFindHandler(const UID& classUID,CFindFunction handler)
+	{
+		FindHandlers_[classUID]=handler;
+	}
+
+	void Server::AddMoveHandler(const UID& classUID,CMoveFunction handler)
+	{
+		MoveHandlers_[classUID]=handler;
+	}
+
+	void Server::AddGetHandler(const UID& classUID,CGetFunction handler)
+	{
+		GetHandlers_[classUID]=handler;
+	}
+
+	void Server::SetTransferSyntaxes(const std::vector<UID>& TransferSyntaxes)
+	{
+		TransferSyntaxes_=TransferSyntaxes;
+	}
+
+	void Server::SetQueueCapacity(size_t Capacity)
+	{
+		QueueCapacity_=Capacity;
+	}
+
+	QueueStats Server::GetQueueStats()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if(REACTOR==Model_)
+			return Backlog_;
+		if(pool_)
+			return pool_->Stats();
+		QueueStats none={};
+		return none;
+	}
+
+	void Server::Start()
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if(Running_)
+				return;
+			Running_=true;
+			Stopping_=false;
+			QueueStats empty={};
+			Backlog_=empty;
+			Backlog_.Capacity_=QueueCapacity_;
+			Suspended_=false;
+
+			//REACTOR sessions are limited by Backlog_ instead, they'd never queue more than one task each.
+			if(REACTOR==Model_)
+				pool_.reset(new ThreadPool(Threads_));
+			else if(WORKER_POOL==Model_)
+				pool_.reset(new ThreadPool(Threads_,QueueCapacity_));
+		}
+
+		if(REACTOR==Model_)
+		{
+#ifdef __linux__
+			reactor_.reset(new Reactor);
+			AssociationHandlers handlers;
+			handlers.Negotiate=boost::bind(&Server::Negotiate,this,_1,_2);
+			handlers.Established=boost::bind(&Server::Established,this,_1);
+			handlers.Received=boost::bind(&Server::Received,this,_1,_2);
+			handlers.Closed=boost::bind(&Server::Closed,this,_1);
+			AsyncAssociation::Listen(*reactor_,Port_,handlers,MaxPDULength_);
+#else
+			throw dicom::exception("The reactor model is only available on linux");
+#endif
+			return;
+		}
+
+		listener_.reset(new Network::ServerSocket(Port_));
+		//ServerSocket's backlog is too short for a burst of associations, and
+		//connections that overflow it can be mangled.  (As in Reactor.cpp)
+		listen(listener_->GetSocketDescriptor(),SOMAXCONN);
+		acceptor_.reset(new boost::thread(boost::bind(&Server::Listen,this)));
+	}
+
+	void Server::Stop()
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if(!Running_)
+				return;
+			Stopping_=true;
+			//a blocked read returns as soon as its socket is shut down, which
+			//also frees up a worker for an acceptor waiting to queue an association.
+			for(std::set<int>::iterator I=Open_.begin();I!=Open_.end();I++)
+				shutdown(*I,2);
+		}
+
+		if(acceptor_)
+		{
+			acceptor_->join();
+			acceptor_.reset();
+			listener_.reset();
+		}
+#ifdef __linux__
+		//closes every association, which in turn wakes up any session waiting on one.
+		reactor_.reset();
+#endif
+		//Anything still queued sees Stopping_ and gives up straight away.
+		boost::scoped_ptr<ThreadPool> pool;
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			pool_.swap(pool);
+		}
+		pool.reset();
+
+		boost::mutex::scoped_lock lock(mutex_);
+		while(Associations_>0)
+			finished_.wait(lock);
+		Running_=false;
+	}
+
+	size_t Server::Associations()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+#ifdef __linux__
+		if(REACTOR==Model_)
+			return Sessions_.size();
+#endif
+		return Associations_;
+	}
+
+	AssociationStats Server::GetStats()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		AssociationStats stats=Closed_;
+		for(std::set<ServiceBase*>::const_iterator I=Serving_.begin();I!=Serving_.end();I++)
+			stats+=(*I)->GetStats();
+#ifdef __linux__
+		for(std::map<AsyncAssociation*,boost::shared_ptr<Session> >::const_iterator I=Sessions_.begin();I!=Sessions_.end();I++)
+			stats+=I->second->GetStats();
+#endif
+		return stats;
+	}
+
+	bool Server::Negotiate(const AAssociateRQ& Request,AAssociateAC& Acknowledgement)
+	{
+		if(!AET_.empty() && Request.CalledAppTitle_!=AET_)
+			return false;
+
+		bool Accepted=false;
+		const std::vector<PresentationContext>& Proposed=Request.ProposedPresentationContexts_;
+		for(std::vector<PresentationContext>::const_iterator I=Proposed.begin();I!=Proposed.end();I++)
+		{
+			const UID& AbstractSyntax=I->AbsSyntax_.UID_;
+			PresentationContextAccept accept;
+			accept.PresentationContextID_=I->ID_;
+			//something has to go here, even if we turn the context down.
+			accept.TrnSyntax_.UID_=IMPL_VR_LE_TRANSFER_SYNTAX;
+
+			if(!(AbstractSyntax==VERIFICATION_SOP_CLASS) && !StoreHandlers_.count(AbstractSyntax)
+				&& !FindHandlers_.count(AbstractSyntax) && !MoveHandlers_.count(AbstractSyntax)
+				&& !GetHandlers_.count(AbstractSyntax))
+			{
+				accept.Result_=ABSTRACT_SYNTAX_NOT_SUPPORTED;
+			}
+			else
+			{
+				//our preference, not theirs.
+				accept.Result_=TRANSFER_SYNTAXES_NOT_SUPPORTED;
+				for(std::vector<UID>::const_iterator T=TransferSyntaxes_.begin();
+					T!=TransferSyntaxes_.end() && accept.Result_!=ACCEPTANCE;T++)
+				{
+					for(std::vector<TransferSyntax>::const_iterator P=I->TransferSyntaxes_.begin();P!=I->TransferSyntaxes_.end();P++)
+					{
+						if(P->UID_==*T)
+						{
+							accept.Result_=ACCEPTANCE;
+							accept.TrnSyntax_.UID_=*T;
+							break;
+						}
+					}
+				}
+			}
+			if(ACCEPTANCE==accept.Result_)
+				Accepted=true;
+			//One answer for each context, in the order proposed.  ServiceBase relies on this.
+			Acknowledgement.PresContextAccepts_.push_back(accept);
+		}
+		return Accepted;
+	}
+
+	void Server::Dispatch(ServiceBase& pdu,const DataSet& command)
+	{
+		//From the command arriving to the last response going out.
+		DICOMLIB_PROFILE("Server::Dispatch");
+		UINT16 cmd;
+		command(TAG_CMD_FIELD)>>cmd;
+
+		//Nothing to cancel by the time we see this, requests are handled one at a time.
+		if(Command::C_CANCEL_RQ==cmd)
+			return;
+
+		UID classUID;
+		command(TAG_AFF_SOP_CLASS_UID)>>classUID;
+		switch(cmd)
+		{
+		case Command::C_ECHO_RQ:
+			HandleCEcho(pdu,command,classUID);
+			return;
+		case Command::C_STORE_RQ:
+			{
+				std::map<UID,CStoreFunction>::const_iterator I=StoreHandlers_.find(classUID);
+				if(I!=StoreHandlers_.end())
+				{
+					HandleCStore(I->second,pdu,command,classUID);
+					return;
+				}
+			}
+			break;
+		case Command::C_FIND_RQ:
+			{
+				std::map<UID,CFindFunction>::const_iterator I=FindHandlers_.find(classUID);
+				if(I!=FindHandlers_.end())
+				{
+					HandleCFind(I->second,pdu,command,classUID);
+					return;
+				}
+			}
+			break;
+		case Command::C_MOVE_RQ:
+			{
+				std::map<UID,CMoveFunction>::const_iterator I=MoveHandlers_.find(classUID);
+				if(I!=MoveHandlers_.end())
+				{
+					HandleCMove(I->second,pdu,command,classUID);
+					return;
+				}
+			}
+			break;
+		case Command::C_GET_RQ:
+			{
+				std::map<UID,CGetFunction>::const_iterator I=GetHandlers_.find(classUID);
+				if(I!=GetHandlers_.end())
+				{
+					HandleCGet(I->second,pdu,command,classUID);
+					return;
+				}
+			}
+			break;
+		}
+		//Negotiation should have stopped the peer getting this far.
+		throw exception("No handler for request");
+	}
+
+	/*!
+		The acceptor thread for the blocking models.  Wakes up every second
+		to see whether it's been told to stop.
+	*/
+	void Server::Listen()
+	{
+		for(;;)
+		{
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				if(Stopping_)
+					return;
+			}
+			try
+			{
+				if(!listener_->MoreData(1))
+					continue;
+				boost::shared_ptr<Network::Socket> socket(new Network::AcceptedSocket(*listener_));
+				{
+					boost::mutex::scoped_lock lock(mutex_);
+					Associations_++;
+				}
+				try
+				{
+					if(THREAD_PER_ASSOCIATION==Model_)
+						boost::thread(boost::bind(&Server::Serve,this,socket));//detaches.
+					else
+						pool_->Post(boost::bind(&Server::Serve,this,socket));
+				}
+				catch(std::exception&)
+				{
+					boost::mutex::scoped_lock lock(mutex_);
+					Associations_--;
+					throw;
+				}
+			}
+			catch(std::exception&)
+			{
+				//e.g. the peer gave up before we accepted, or we're out of descriptors.
+				boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+			}
+		}
+	}
+
+	void Server::Serve(boost::shared_ptr<Network::Socket> socket)
+	{
+		const int Descriptor=int(socket->GetSocketDescriptor());
+		bool Serving;
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			Serving=!Stopping_;
+			if(Serving)
+				Open_.insert(Descriptor);
+		}
+
+		if(Serving)
+		{
+			BlockingAssociation association(socket);
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				Serving_.insert(&association);
+			}
+			try
+			{
+				BYTE ItemType;
+				*socket >> ItemType;
+				if(ItemType!=0x01)
+					throw BadItemType(ItemType,0x01);
+				const boost::uint64_t Start=MonotonicNanoseconds();
+
+				AAssociateRQ& request=association.AAssociateRQ_;
+				request.ReadDynamic(*socket);
+
+				AAssociateAC acknowledgement(request.CallingAppTitle_,request.CalledAppTitle_);
+				acknowledgement.AppContext_.UID_=APPLICATION_CONTEXT;
+				if(!AET_.empty() && request.CalledAppTitle_!=AET_)
+				{
+					AAssociateRJ rejection(AAssociateRJ::REJECTED_PERMANENT,AAssociateRJ::DICOM_SERVICE_USER,AAssociateRJ::CALLED_AE_NOT_RECOGNIZED);
+					rejection.Write(*socket);
+				}
+				else if(!Negotiate(request,acknowledgement))
+				{
+					AAssociateRJ rejection(AAssociateRJ::REJECTED_PERMANENT,AAssociateRJ::DICOM_SERVICE_USER,AAssociateRJ::NO_REASON);
+					rejection.Write(*socket);
+				}
+				else
+				{
+					UserInformation UserInfo;
+					MaximumSubLength MaxSubLength(MaxPDULength_);
+					UserInfo.ImpClass_.UID_=ImplementationClassUID;
+					UserInfo.ImpVersion_.Name=ImplementationVersionName;
+					UserInfo.SetMax(MaxSubLength);
+					//We only ever perform one operation at a time.
+					if(request.UserInfo_.HasAsyncOpsWindow_)
+						UserInfo.SetAsyncOperationsWindow(AsyncOperationsWindow(1,1));
+					acknowledgement.SetUserInformation(UserInfo);
+					acknowledgement.Write(*socket);
+					association.RecordNegotiation(MonotonicNanoseconds()-Start);
+
+					association.AcceptedPresentationContexts_=acknowledgement.PresContextAccepts_;
+					association.PeerMaxPDULength_=request.UserInfo_.MaxSubLength_.MaximumLength_;
+					association.MaxPDULength_=MaxPDULength_;
+
+					for(;;)
+					{
+						DataSet command;
+						if(!association.Read(command))
+							break;//released.
+						Dispatch(association,command);
+					}
+				}
+			}
+			catch(AssociationAborted&)
+			{
+			}
+			catch(std::exception&)
+			{
+				//Tell the peer, if it's still there to listen.
+				try
+				{
+					AAbortRQ abort_request(AAbortRQ::DICOM_SERVICE_PROVIDER,AAbortRQ::NO_REASON);
+					abort_request.Write(*socket);
+				}
+				catch(std::exception&)
+				{
+				}
+			}
+
+			boost::mutex::scoped_lock lock(mutex_);
+			Serving_.erase(&association);
+			Closed_+=association.GetStats();
+		}
+
+		boost::mutex::scoped_lock lock(mutex_);
+		Open_.erase(Descriptor);
+		Associations_--;
+		finished_.notify_all();
+	}
+
+#ifdef __linux__
+	void Server::Established(AsyncAssociation& association)
+	{
+		boost::shared_ptr<Session> session(new Session(*this,association.shared_from_this()));
+		boost::mutex::scoped_lock lock(mutex_);
+		Sessions_[&association]=session;
+		if(Suspended_)
+			association.SuspendReading();
+	}
+
+	void Server::Received(AsyncAssociation& association,const Message& message)
+	{
+		boost::shared_ptr<Session> session;
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			std::map<AsyncAssociation*,boost::shared_ptr<Session> >::iterator I=Sessions_.find(&association);
+			if(I==Sessions_.end())
+				return;
+			session=I->second;
+		}
+		if(Session::IsRequest(message))
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			Backlog_.Depth_++;
+			Backlog_.Pushed_++;
+			Backlog_.HighWater_=std::max(Backlog_.HighWater_,Backlog_.Depth_);
+			if(Backlog_.Capacity_ && Backlog_.Depth_>=Backlog_.Capacity_ && !Suspended_)
+			{
+				/*
+					The workers can't keep up, let TCP slow everyone down until they do.
+					Except anyone a worker is waiting on, or it might never finish.
+				*/
+				Backlog_.Full_++;
+				Suspended_=true;
+				for(std::map<AsyncAssociation*,boost::shared_ptr<Session> >::iterator I=Sessions_.begin();I!=Sessions_.end();I++)
+					if(!I->second->Waiting_)
+						I->second->association_->SuspendReading();
+			}
+		}
+		if(session->Push(message))
+			pool_->Post(boost::bind(&Session::Run,session));
+	}
+
+	void Server::Closed(AsyncAssociation& association)
+	{
+		boost::shared_ptr<Session> session;
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			std::map<AsyncAssociation*,boost::shared_ptr<Session> >::iterator I=Sessions_.find(&association);
+			if(I==Sessions_.end())
+				return;
+			session=I->second;
+			Sessions_.erase(I);
+			Closed_+=session->GetStats();
+		}
+		session->Close();
+	}
+
+	void Server::Waiting(Session& session,bool Waiting)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		session.Waiting_=Waiting;
+		if(!Suspended_)
+			return;
+		if(Waiting)
+			session.association_->ResumeReading();
+		else
+			session.association_->SuspendReading();
+	}
+
+	void Server::Handled(size_t Count)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		Backlog_.Depth_-=Count;
+		if(Suspended_ && Backlog_.Depth_<=Backlog_.Capacity_/2)
+		{
+			Suspended_=false;
+			for(std::map<AsyncAssociation*,boost::shared_ptr<Session> >::iterator I=Sessions_.begin();I!=Sessions_.end();I++)
+				I->second->association_->ResumeReading();
+		}
+	}
+#endif
+}//namespace dicom
@@ -0,0 +1,184 @@
+#ifndef SERVER_HPP_INCLUDE_GUARD_4418207395
+#define SERVER_HPP_INCLUDE_GUARD_4418207395
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+#include "Cdimse.hpp"
+#include "ThreadPool.hpp"
+#include "Reactor.hpp"
+#include "aarq.hpp"
+#include "aaac.hpp"
+#include "socket/Socket.hpp"
+
+namespace dicom
+{
+	class AsyncAssociation;
+	struct Message;
+
+	//!A DICOM Service Class Provider.
+	/*!
+		Accepts associations on a port, accepts the presentation contexts it
+		has handlers for, and hands each request to the handler registered for
+		its SOP class.  C-ECHO is always answered.  Usage:
+		<pre>
+			Server server(104,"ARCHIVE",Server::REACTOR,16);
+			server.AddStoreHandler(CT_IMAGE_STORAGE_SOP_CLASS,MyStoreFunction);
+			server.Start();
+			...
+			server.Stop();
+		</pre>
+		Handlers are the functions in Cdimse.hpp, and are called from
+		whichever thread is serving the association, so must be safe to call
+		from several threads at once.  Register them all before Start().
+
+		How associations are given threads depends on the Model:
+
+		THREAD_PER_ASSOCIATION is the simplest, but every open association
+		costs a thread, idle or not.
+
+		WORKER_POOL serves Threads associations at a time, each from start to
+		finish.  Any more wait for a worker, and (as far as the peer's
+		concerned) their association request goes unanswered until then.
+		Once the queue of waiting associations is full we stop accepting
+		connections, and leave them to the kernel's listen queue.
+
+		REACTOR keeps every association on a Reactor, which reads, reassembles
+		and decodes messages without blocking.  Each request is then handled on
+		one of Threads workers, so only associations that are actually doing
+		something hold a thread.  This is the one to use for a lot of
+		modalities at once.  Requests on any one association are still handled
+		in the order they arrive, one at a time.  Linux only.
+
+		Requests can arrive a lot faster than the handlers can store them, e.g.
+		when a CT scanner sends a whole study at once, and each one waiting is
+		a complete data set in memory.  So once QueueCapacity requests are
+		waiting for a worker, the server stops reading from every association,
+		and TCP holds the peers back, until the workers have got through half
+		of them.
+	*/
+	class Server : boost::noncopyable
+	{
+		struct Session;
+	public:
+		enum Model
+		{
+			THREAD_PER_ASSOCIATION,
+			WORKER_POOL,
+			REACTOR
+		};
+
+		/*!
+			If AET isn't empty, associations called anything else are rejected.
+			Threads is the number of workers for WORKER_POOL and REACTOR, 0 meaning
+			one per hardware thread.  MaxPDULength is the largest PDU we ask peers
+			to send us, 0 meaning no limit.
+		*/
+		Server(short Port,const std::string& AET="",Model model=THREAD_PER_ASSOCIATION,
+			size_t Threads=0,UINT32 MaxPDULength=primitive::MaximumSubLength::DefaultMaximumLength_);
+
+		//!Stop()s first.
+		~Server();
+
+		void AddStoreHandler(const UID& classUID,CStoreFunction handler);
+		void AddFindHandler(const UID& classUID,CFindFunction handler);
+		void AddMoveHandler(const UID& classUID,CMoveFunction handler);
+		void AddGetHandler(const UID& classUID,CGetFunction handler);
+
+		//!Transfer syntaxes we accept, most preferred first.
+		/*!
+			Defaults to Implicit VR Little Endian, Explicit VR Little Endian
+			and Explicit VR Big Endian.
+		*/
+		void SetTransferSyntaxes(const std::vector<UID>& TransferSyntaxes);
+
+		//!How many associations (WORKER_POOL) or requests (REACTOR) may wait for a worker.
+		/*!
+			Defaults to 64, 0 means no limit.  Call before Start().
+		*/
+		void SetQueueCapacity(size_t Capacity);
+
+		//!What's waiting for a worker.  All zero for THREAD_PER_ASSOCIATION.
+		QueueStats GetQueueStats();
+
+		//!Start accepting associations, returns straight away.
+		void Start();
+
+		//!Stop accepting, and drop any associations still open.
+		void Stop();
+
+		//!Number of associations currently open.
+		size_t Associations();
+
+		//!Every association's stats added up, those still open and those since closed.
+		/*!
+			See AssociationStats, and WritePrometheus() to publish them.
+		*/
+		AssociationStats GetStats();
+
+	private:
+		//!Fill in Acknowledgement's presentation contexts.  False if we want none of them.
+		bool Negotiate(const primitive::AAssociateRQ& Request,primitive::AAssociateAC& Acknowledgement);
+
+		//!Hand one request to its handler.  Blocks until it's been answered.
+		void Dispatch(ServiceBase& pdu,const DataSet& command);
+
+		//blocking models.
+		void Listen();
+		void Serve(boost::shared_ptr<Network::Socket> socket);
+
+#ifdef __linux__
+		//REACTOR model, called on reactor threads.
+		void Established(AsyncAssociation& association);
+		void Received(AsyncAssociation& association,const Message& message);
+		void Closed(AsyncAssociation& association);
+		//!Count of requests in the backlog goes down.  Called with a session's lock held.
+		void Handled(size_t Count);
+		//!A worker has started or stopped waiting for session.  Called with its lock held.
+		void Waiting(Session& session,bool Waiting);
+#endif
+
+		const short Port_;
+		const std::string AET_;
+		const Model Model_;
+		const size_t Threads_;
+		const UINT32 MaxPDULength_;
+
+		std::map<UID,CStoreFunction> StoreHandlers_;
+		std::map<UID,CFindFunction> FindHandlers_;
+		std::map<UID,CMoveFunction> MoveHandlers_;
+		std::map<UID,CGetFunction> GetHandlers_;
+		std::vector<UID> TransferSyntaxes_;
+		size_t QueueCapacity_;
+
+		boost::mutex mutex_;
+		boost::condition_variable finished_;
+		bool Running_;
+		bool Stopping_;
+		size_t Associations_;
+		//!Blocking models, descriptors of associations being served, so Stop() can drop them.
+		std::set<int> Open_;
+		//!Blocking models, associations being served.
+		std::set<ServiceBase*> Serving_;
+		//!Stats of associations that have closed.
+		AssociationStats Closed_;
+		//!REACTOR, requests received but not yet handled.
+		QueueStats Backlog_;
+		//!REACTOR, we've stopped reading because the backlog's full.
+		bool Suspended_;
+
+		boost::scoped_ptr<Network::ServerSocket> listener_;
+		boost::scoped_ptr<boost::thread> acceptor_;
+		boost::scoped_ptr<ThreadPool> pool_;
+#ifdef __linux__
+		boost::scoped_ptr<Reactor> reactor_;
+		std::map<AsyncAssociation*,boost::shared_ptr<Session> > Sessions_;
+#endif
+	};
+}//namespace dicom
+
+#endif //SERVER_HPP_INCLUDE_GUARD_4418207395
@@ -10,6 +10,8 @@
 #include <iostream>
 #include <stdexcept>
 #include "ServiceBase.hpp"
+#include "Profiling.hpp"
+#include "Utility.hpp"
 //#include "pdata.hpp"
 #include "Encoder.hpp"
 #include "Decoder.hpp"
@@ -24,9 +26,32 @@ namespace dicom
 {
 	using namespace primitive;
 
+	namespace
+	{
+		//!PDU lengths are always big endian, see Part 8, section 9.3.1
+		void WriteBigEndian(BYTE* p,UINT32 value)
+		{
+			p[0]=BYTE(value>>24);
+			p[1]=BYTE(value>>16);
+			p[2]=BYTE(value>>8);
+			p[3]=BYTE(value);
+		}
+
+		UINT32 ReadBigEndian(const BYTE* p)
+		{
+			return (UINT32(p[0])<<24)|(UINT32(p[1])<<16)|(UINT32(p[2])<<8)|UINT32(p[3]);
+		}
+
+		//!A reassembly buffer bigger than this isn't kept for the next message.
+		const size_t MaxRetainedReassembly=16*1024*1024;
+	}
+
 	ServiceBase::ServiceBase()
-		:CurrentPresentationContextID_(0) //0 is not a valid number for Presentation Context ID -Sam
-	{}
+		:PeerMaxPDULength_(MaximumSubLength::DefaultMaximumLength_)
+		,MaxPDULength_(MaximumSubLength::DefaultMaximumLength_)
+		,CurrentPresentationContextID_(0) //0 is not a valid number for Presentation Context ID -Sam
+	{
+	}
 
 	//ServiceBase::ServiceBase(Network::Socket* socket):socket_(socket)
 	//{
@@ -41,6 +66,7 @@ namespace dicom
 	void ServiceBase::Write(MessageControlHeader::Code msgHead, const DataSet& ds,
 		const UID& AbstractSyntaxUID, TS ts)
 	{
+		DICOMLIB_PROFILE("ServiceBase::Write");
 
 		//UID absUID(as);
 		UID tsUID(ts.getUID());
@@ -68,10 +94,19 @@ namespace dicom
 		int ByteOrder=ts.isBigEndian()?__BIG_ENDIAN:__LITTLE_ENDIAN;
 		Buffer buffer(ByteOrder);
 
+		const boost::uint64_t Start=MonotonicNanoseconds();
 		dicom::WriteToBuffer(ds,buffer,ts);
+		{
+			boost::mutex::scoped_lock lock(StatsMutex_);
+			Stats_.Encode_.Add(MonotonicNanoseconds()-Start);
+		}
 
-		UINT32 MaxPDULength=AAssociateRQ_.UserInfo_.MaxSubLength_.MaximumLength_;
-		Write(buffer,msgHead,/*PresentationContextID*/CurrentPresentationContextID_,MaxPDULength);
+		//This used to be AAssociateRQ_'s maximum, which on the client side is what
+		//_we_ can receive, not the peer.
+		Write(buffer,msgHead,/*PresentationContextID*/CurrentPresentationContextID_,PeerMaxPDULength_);
+
+		if(msgHead bitand MessageControlHeader::COMMAND)
+			RecordCommand(ds,true);
 	}
 
 	void ServiceBase::WriteCommand(const DataSet& ds,const UID& uid )
@@ -101,12 +136,16 @@ namespace dicom
 			throw exception("buffer.position()!=buffer.begin(), in ServiceBase::Write()");
 		}
 
-		if(MaxPDULength==0)//Does this ever happen?  Is this valid to do?  Must have
-							//rationale here please.   TODO.
-			MaxPDULength=static_cast<UINT32>(buffer.size());
+		//Part 8, Annex D.1: a maximum of 0 means the peer will take a PDU of any length.
+		if(MaxPDULength==0)
+			MaxPDULength=static_cast<UINT32>(buffer.size())+6;
+		if(MaxPDULength<=6)
+			throw exception("Peer's maximum PDU length is too small to send anything");
 
 
 		Network::Socket* socket=GetSocket();
+		const boost::uint64_t Start=MonotonicNanoseconds();
+		boost::uint64_t PDUs=0,Bytes=0;
 
 		while(buffer.position()!=buffer.end())
 		{
@@ -115,26 +154,26 @@ namespace dicom
 			See Part 8, table 9-22 and 9-23 to understand what we're sending here,
 			and realise that I've opted to only ever send ONE pdv with each P-DATA-TF.
 		*/
-			*socket << BYTE(0x04);
-			*socket << BYTE(0x00);
-			
 			UINT32 BytesLeftToSend=static_cast<UINT32>((buffer.end()-buffer.position()));
 			
 			const UINT32 BytesInThisChunk=std::min<UINT32>(BytesLeftToSend,MaxPDULength-6);
 
-
-			*socket << UINT32(BytesInThisChunk+6);
-			//now the PDV item
-			//We should use the PDV class to mediate this!
-
-			*socket << UINT32(BytesInThisChunk+2);
-			*socket << PresentationContextID;
-
-
 			if(buffer.position()+(BytesInThisChunk)==buffer.end())
 				msgHead |=MessageControlHeader::LAST_FRAGMENT;
 
-			*socket	<< msgHead;
+			/*
+				PDU header then PDV item header.  These used to go out a field at a
+				time, which is a system call each - build them here and send them in one.
+			*/
+			BYTE Header[12];
+			Header[0]=0x04;
+			Header[1]=0x00;
+			WriteBigEndian(Header+2,BytesInThisChunk+6);
+			WriteBigEndian(Header+6,BytesInThisChunk+2);
+			Header[10]=PresentationContextID;
+			Header[11]=msgHead;
+			socket->Sendn(Header,sizeof(Header));
+			DICOMLIB_COUNT(PDUS_SENT,1);
 
 			//then send data...
 			BYTE* Begin=&(*(buffer.position()));
@@ -142,7 +181,15 @@ namespace dicom
 
 			//buffer.position()+=(BytesInThisChunk);//this is now a bug...
 			buffer.Increment(BytesInThisChunk);
+			PDUs++;
+			Bytes+=sizeof(Header)+BytesInThisChunk;
 		}
+
+		boost::mutex::scoped_lock lock(StatsMutex_);
+		Stats_.Send_.Add(MonotonicNanoseconds()-Start);
+		Stats_.MessagesSent_++;
+		Stats_.PDUsSent_+=PDUs;
+		Stats_.BytesSent_+=Bytes;
 	}
 
 	/*!
@@ -181,8 +228,18 @@ namespace dicom
 		*/
 
 		Network::Socket* socket=GetSocket();
-		Buffer p_data_tf_buffer;
+		/*
+			The buffer is kept from one message to the next, so that once it's
+			grown to the size of the messages we're getting it doesn't need
+			allocating (and faulting in) again for every one.
+		*/
+		Buffer& p_data_tf_buffer=Reassembly_;
+		p_data_tf_buffer.clear();
+		if(p_data_tf_buffer.capacity()>MaxRetainedReassembly)
+			std::vector<BYTE>().swap(p_data_tf_buffer);
+		p_data_tf_buffer.SetEndian(__LITTLE_ENDIAN);
 		MessageControlHeader::Code msgHead;
+		boost::uint64_t FirstPDU=0;//when, for the stats.
 		while(true)//loop, apparently implying that we can expect more than one PDATATF object.
 		{
 			BYTE		ItemType;
@@ -192,9 +249,15 @@ namespace dicom
 			case	0x04:	// P-DATA-TF
 				{
 					bool ready_to_parse=false;
+					if(!FirstPDU)
+						FirstPDU=MonotonicNanoseconds();
 					ReadDynamic(*socket,p_data_tf_buffer,msgHead,ready_to_parse);
 					if (ready_to_parse)//what is the corresponding 'else' ?
 					{
+						{
+							boost::mutex::scoped_lock lock(StatsMutex_);
+							Stats_.Receive_.Add(MonotonicNanoseconds()-FirstPDU);
+						}
 						ParseRawVRIntoDataSet(p_data_tf_buffer,msgHead,command_or_data);
 						return true;
 					}
@@ -238,56 +301,60 @@ namespace dicom
 	*/
 	void ServiceBase::ReadDynamic(Network::Socket& socket,Buffer& p_data_tf_buffer,MessageControlHeader::Code& msgHead,bool& ready_to_parse)
 	{
+		DICOMLIB_PROFILE("ServiceBase::ReadDynamic");
+		DICOMLIB_COUNT(PDUS_RECEIVED,1);
  		UINT32		Count;
 		//1. Read in the pdu fields
 		//BYTE pdu_type has been read before entering this function
-		BYTE pdu_reserve;
- 		socket >> pdu_reserve;
-		UINT32 pdu_length;
- 		socket >> pdu_length;
+		/*
+			Headers are read whole and picked apart here, rather than a field
+			at a time.  (The socket reads ahead, so neither costs a system call,
+			but there's no sense in going through it three times.)
+		*/
+		BYTE PDUHeader[5];//reserved, then length.
+		socket.Readn(PDUHeader,sizeof(PDUHeader));
+		UINT32 pdu_length=ReadBigEndian(PDUHeader+1);
+		if(MaxPDULength_ && pdu_length>MaxPDULength_)
+		{
+			//don't let the peer have us allocate whatever it likes.
+			AAbortRQ abort_request(AAbortRQ::DICOM_SERVICE_PROVIDER,AAbortRQ::INVALID_PDU_PARAMETER);
+			abort_request.Write(socket);
+			throw exception("P-DATA-TF longer than the negotiated maximum");
+		}
+		{
+			boost::mutex::scoped_lock lock(StatsMutex_);
+			Stats_.PDUsReceived_++;
+			Stats_.BytesReceived_+=6+pdu_length;
+		}
 
  		Count = pdu_length;
  		while ( Count > 0)
  		{
-			UINT32 pdv_item_length;
- 			socket >> pdv_item_length;
- 			socket >> CurrentPresentationContextID_;
- 			socket >> msgHead;
-
-
-			//now read actual data from socket onto buffer.
-			//std::vector<BYTE> data(pdv.Length-2);
-			//socket >> data;
-			//std::copy(data.begin(),data.end(),std::back_inserter(buffer_));
-			p_data_tf_buffer.insert(p_data_tf_buffer.end(),pdv_item_length-2,0x00);
-			socket.Readn(&*(p_data_tf_buffer.end()-(pdv_item_length-2)),(pdv_item_length-2));//slightly more complicated.
+			BYTE PDVHeader[6];//length, presentation context id, message control header.
+			socket.Readn(PDVHeader,sizeof(PDVHeader));
+			UINT32 pdv_item_length=ReadBigEndian(PDVHeader);
+			CurrentPresentationContextID_=PDVHeader[4];
+			msgHead=PDVHeader[5];
 
+			if(pdv_item_length<2 || pdv_item_length+sizeof(UINT32)>Count)
+				throw exception("Bad PDV item length");
 
 			/*
-				The previous 3 lines could be dramatically speeded up if
-				we _first_ allocate the space on buffer, then pass _pointers_
-				to the begin and end of the new space to Socket::Readn();
-
-				I'm not going to change this till I have a good unit test for the change
-
-				Meyers says in 'Efficient STL' that member functions are preferable
-				over algorithms for efficiency?
-
-				So possible optimizations would be:
-				1)
-
-				buffer_.insert(buffer_.end(),data.begin(),data.end());//this is simple.
-
-				2)
-
-				buffer_.insert(buffer_.end(),pdv.Length-2,0x00);
-				socket.Readn(buffer_.end()-(pdv.Length-2),(pdv.Length-2));//slightly more complicated.
-
-				We need profiling tests for both, such as dicomtest::SubmitLotsOfImages()
+				Grow geometrically, and by at least the rest of this PDU, so a message
+				spread over many PDUs isn't reallocated and copied for each one.
+				(reserve() on its own only promises enough, not more.)
 			*/
+			const Buffer::size_type Needed=p_data_tf_buffer.size()+Count;
+			if(p_data_tf_buffer.capacity()<Needed)
+			{
+				p_data_tf_buffer.reserve(std::max(Needed,2*p_data_tf_buffer.capacity()));
+				DICOMLIB_COUNT(ALLOCATIONS,1);
+			}
+
+			//Straight onto the end of the buffer, see Socket::Append()
+			socket.Append(p_data_tf_buffer,pdv_item_length-2);
 
  			Count = Count - pdv_item_length - sizeof(UINT32);
- 			//Length = Length - pdv_item_length - sizeof(UINT32);
 
 			if((msgHead bitand MessageControlHeader::LAST_FRAGMENT)!=0)
  			{
@@ -295,12 +362,6 @@ namespace dicom
  				return;
  			}
  		}
-		//if((pdv_message_control_header bitand MessageControlHeader::LAST_FRAGMENT)!=0)
- 	//	{//what is this for? -Sam
- 	//		assert(0);//how can this ever happen?
-		//	ready_to_parse = true;
- 	//		return;
- 	//	}
  		return;
  	}
 	void ServiceBase::ParseRawVRIntoDataSet(Buffer& p_data_tf_buffer,const MessageControlHeader::Code& msgHead, DataSet& command_or_data)
@@ -317,7 +378,95 @@ namespace dicom
 			tsuid=GetTransferSyntaxUID(CurrentPresentationContextID_);
 		else
 			tsuid=IMPL_VR_LE_TRANSFER_SYNTAX;
+		const boost::uint64_t Start=MonotonicNanoseconds();
 		ReadFromBuffer(p_data_tf_buffer,command_or_data,TS(tsuid));//defined in decoder.cpp
+		{
+			boost::mutex::scoped_lock lock(StatsMutex_);
+			Stats_.Decode_.Add(MonotonicNanoseconds()-Start);
+		}
+		RecordReceived(command_or_data,msgHead);
+	}
+
+	AssociationStats ServiceBase::GetStats()
+	{
+		boost::mutex::scoped_lock lock(StatsMutex_);
+		return Stats_;
+	}
+
+	void ServiceBase::RecordNegotiation(boost::uint64_t Nanoseconds)
+	{
+		boost::mutex::scoped_lock lock(StatsMutex_);
+		Stats_.Associations_=1;
+		Stats_.Negotiation_.Add(Nanoseconds);
+	}
+
+	void ServiceBase::RecordEstablished()
+	{
+		boost::mutex::scoped_lock lock(StatsMutex_);
+		Stats_.Associations_=1;
+	}
+
+	void ServiceBase::RecordHandler(boost::uint64_t Nanoseconds)
+	{
+		boost::mutex::scoped_lock lock(StatsMutex_);
+		Stats_.Handler_.Add(Nanoseconds);
+	}
+
+	void ServiceBase::RecordReceived(const DataSet& command_or_data,MessageControlHeader::Code msgHead)
+	{
+		{
+			boost::mutex::scoped_lock lock(StatsMutex_);
+			Stats_.MessagesReceived_++;
+		}
+		if(msgHead bitand MessageControlHeader::COMMAND)
+			RecordCommand(command_or_data,false);
+	}
+
+	/*!
+		The same whichever end we're at: a request starts an operation, and
+		the response to it that isn't pending finishes it.
+
+		Each end numbers its own requests, so during a C-GET the peer's C-STORE
+		sub-operations can have the same message ID as the C-GET itself.  That's
+		why operations are keyed by who sent the request as well.
+	*/
+	void ServiceBase::RecordCommand(const DataSet& command,bool Sent)
+	{
+		if(!command.exists(TAG_CMD_FIELD))
+			return;
+		Command::Code cmd;
+		command(TAG_CMD_FIELD)>>cmd;
+		const boost::uint64_t Now=MonotonicNanoseconds();
+		boost::mutex::scoped_lock lock(StatsMutex_);
+		if(Command::C_CANCEL_RQ==cmd)
+			return;
+		if(!(cmd bitand 0x8000))
+		{
+			if(command.exists(TAG_MSG_ID))
+			{
+				UINT16 msgID;
+				command(TAG_MSG_ID)>>msgID;
+				Outstanding_[std::make_pair(Sent,msgID)]=std::make_pair(cmd,Now);
+			}
+			return;
+		}
+		if(command.exists(TAG_STATUS))
+		{
+			UINT16 status;
+			command(TAG_STATUS)>>status;
+			if(Status::PENDING==status || Status::PENDING1==status)
+				return;
+		}
+		if(!command.exists(TAG_MSG_ID_RSP))
+			return;
+		UINT16 msgID;
+		command(TAG_MSG_ID_RSP)>>msgID;
+		//a response we sent answers a request we received, and vice versa.
+		OperationMap::iterator I=Outstanding_.find(std::make_pair(!Sent,msgID));
+		if(I==Outstanding_.end())
+			return;
+		Stats_.Operations_[I->second.first].Add(Now-I->second.second);
+		Outstanding_.erase(I);
 	}
 
 	/*
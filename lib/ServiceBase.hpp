@@ -1,6 +1,8 @@
 #ifndef SERVICE_BASE_HPP_23847239487238
 #define SERVICE_BASE_HPP_23847239487238
 #include <string>
+#include <map>
+#include <boost/thread/mutex.hpp>
 #include "socket/Socket.hpp"
 #include "Buffer.hpp"
 #include "DataSet.hpp"
@@ -9,6 +11,7 @@
 #include "aaac.hpp"
 #include "aarj.hpp"
 #include "UIDs.hpp"
+#include "AssociationStats.hpp"
 
 namespace dicom
 {
@@ -58,7 +61,8 @@ namespace dicom
 		void ReadDynamic(Network::Socket& socket,Buffer& p_data_tf_buffer,MessageControlHeader::Code& msgHead,bool& ready_to_parse);
 		void ParseRawVRIntoDataSet(Buffer& p_data_tf_buffer,const MessageControlHeader::Code& msgHead,DataSet& command_or_data);
 
-		bool Read(DataSet& command_or_data);
+		//!Virtual so a server can feed messages it has received some other way.  (See Server)
+		virtual bool Read(DataSet& command_or_data);
 
 		BYTE GetPresentationContextID(const UID& uid);
 		BYTE GetPresentationContextID(const UID& AbsUID,	const UID& TrnUID);
@@ -77,6 +81,25 @@ namespace dicom
 		//!The presentation contexts we accepted.
 		std::vector<primitive::PresentationContextAccept>	AcceptedPresentationContexts_;
 
+		//!Largest PDU the peer says it can receive, 0 meaning no limit.
+		/*!
+			This is the peer's half of Part 8, Annex D.1, and is what outgoing
+			P-DATA-TFs are sliced to.  A client takes it from the A-ASSOCIATE-AC,
+			a server from the A-ASSOCIATE-RQ.  Until then it's the default
+			that every implementation should cope with.
+		*/
+		UINT32 PeerMaxPDULength_;
+
+		//!Largest PDU we told the peer it may send us, 0 meaning no limit.
+		/*!
+			Our half of Part 8, Annex D.1.  A P-DATA-TF claiming to be longer
+			than this is aborted before we make room for it.
+		*/
+		UINT32 MaxPDULength_;
+
+		//!Where Read() gathers a message's PDVs, reused for each message.
+		Buffer Reassembly_;
+
 		//!The current PresentationContextID we receive in the latest PDV
 		/*
 		This member does not belong to this place. It should belong  PDV. However, the whole
@@ -101,6 +124,35 @@ namespace dicom
 
 		//Network::Socket* socket_;
 
+		//!Where this association's time has gone so far.  May be called from any thread.
+		/*!
+			In the Server's REACTOR model messages are received and decoded
+			by the reactor and the association negotiated there too, so only
+			operations, handlers, encoding and sending are timed.
+		*/
+		AssociationStats GetStats();
+
+		//!For whoever negotiates the association, once it's been accepted.
+		void RecordNegotiation(boost::uint64_t Nanoseconds);
+
+		//!The association was accepted somewhere we couldn't time it.
+		void RecordEstablished();
+
+		//!For whoever calls the application's handlers.  (See Cdimse.cpp)
+		void RecordHandler(boost::uint64_t Nanoseconds);
+
+		//!A message has been received and decoded, by Read() or otherwise.
+		void RecordReceived(const DataSet& command_or_data,MessageControlHeader::Code msgHead);
+
+	private:
+		//!A command has gone out (Sent) or come in, which starts or finishes an operation.
+		void RecordCommand(const DataSet& command,bool Sent);
+
+		boost::mutex StatsMutex_;
+		AssociationStats Stats_;
+		//!Requests awaiting their final response, by whether we sent them and message ID: the command field, and when.
+		typedef std::map<std::pair<bool,UINT16>,std::pair<Command::Code,boost::uint64_t> > OperationMap;
+		OperationMap Outstanding_;
 
 	};
 }//namespace dicom
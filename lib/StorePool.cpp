@@ -0,0 +1,208 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "StorePool.hpp"
+#include "ClientConnection.hpp"
+#include "File.hpp"
+
+namespace dicom
+{
+	StorePool::StorePool(std::string Host,unsigned short Port,
+		std::string LocalAET,std::string RemoteAET,
+		const PresentationContexts& ProposedPresentationContexts,
+		size_t Associations,size_t MaxAttempts)
+		:Host_(Host),Port_(Port),LocalAET_(LocalAET),RemoteAET_(RemoteAET)
+		,Contexts_(ProposedPresentationContexts)
+		,Associations_(Associations ? Associations : 1)
+		,MaxAttempts_(MaxAttempts ? MaxAttempts : 1)
+	{
+	}
+
+	void StorePool::Add(const DataSet& data)
+	{
+		Item item;
+		item.Data_=data;
+		Items_.push_back(item);
+	}
+
+	void StorePool::Add(const std::string& FileName)
+	{
+		Item item;
+		item.FileName_=FileName;
+		Items_.push_back(item);
+	}
+
+	std::vector<StorePool::Result> StorePool::Run(Callback OnResult)
+	{
+		if(Items_.empty())
+			return std::vector<Result>();
+		OnResult_=OnResult;
+		Results_.assign(Items_.size(),Result());
+		for(size_t i=0;i<Items_.size();i++)
+			Results_[i].FileName_=Items_[i].FileName_;
+
+		//no point opening more associations than we have instances.
+		size_t Associations=std::min(Associations_,Items_.size());
+		Queues_.clear();
+		for(size_t i=0;i<Associations;i++)
+			Queues_.push_back(boost::shared_ptr<Queue>(new Queue));
+		for(size_t i=0;i<Items_.size();i++)
+			Queues_[i%Associations]->Items_.push_back(i);
+
+		boost::thread_group threads;
+		for(size_t i=0;i<Associations;i++)
+			threads.create_thread(boost::bind(&StorePool::Work,this,i));
+		threads.join_all();
+
+		//Anything left over belongs to threads that gave up on the destination.
+		for(size_t i=0;i<Queues_.size();i++)
+		{
+			std::deque<size_t>& items=Queues_[i]->Items_;
+			for(std::deque<size_t>::iterator I=items.begin();I!=items.end();I++)
+			{
+				if(Results_[*I].Error_.empty())
+					Results_[*I].Error_="No association available";
+				Finish(*I);
+			}
+		}
+		Queues_.clear();
+		Items_.clear();
+
+		std::vector<Result> results;
+		results.swap(Results_);
+		return results;
+	}
+
+	/*!
+		Take from the front of our own queue, or failing that from the back
+		of someone else's, which keeps contention on any one queue low.
+	*/
+	bool StorePool::Next(size_t Index,size_t& Item)
+	{
+		for(size_t i=0;i<Queues_.size();i++)
+		{
+			Queue& queue=*Queues_[(Index+i)%Queues_.size()];
+			boost::mutex::scoped_lock lock(queue.mutex_);
+			if(queue.Items_.empty())
+				continue;
+			if(0==i)
+			{
+				Item=queue.Items_.front();
+				queue.Items_.pop_front();
+			}
+			else
+			{
+				Item=queue.Items_.back();
+				queue.Items_.pop_back();
+			}
+			return true;
+		}
+		return false;
+	}
+
+	void StorePool::Requeue(size_t Index,size_t Item)
+	{
+		Queue& queue=*Queues_[Index];
+		boost::mutex::scoped_lock lock(queue.mutex_);
+		queue.Items_.push_back(Item);
+	}
+
+	void StorePool::Finish(size_t Item)
+	{
+		if(!OnResult_)
+			return;
+		boost::mutex::scoped_lock lock(mutex_);
+		OnResult_(Results_[Item]);
+	}
+
+	void StorePool::Work(size_t Index)
+	{
+		boost::scoped_ptr<ClientConnection> connection;
+		size_t Failures=0;//in a row, without a successful store.
+		size_t item;
+		while(Next(Index,item))
+		{
+			Result& result=Results_[item];
+			result.Attempts_++;
+
+			DataSet data;
+			UID classUID;
+			try
+			{
+				if(Items_[item].FileName_.empty())
+					data=Items_[item].Data_;
+				else
+					Read(Items_[item].FileName_,data);
+				result.InstanceUID_=data(TAG_SOP_INST_UID).Get<UID>();
+				classUID=data(TAG_SOP_CLASS_UID).Get<UID>();
+			}
+			catch(std::exception& e)
+			{
+				//no use retrying a file we can't read.
+				result.Error_=e.what();
+				Finish(item);
+				continue;
+			}
+
+			try
+			{
+				if(!connection)
+					connection.reset(new ClientConnection(Host_,Port_,LocalAET_,RemoteAET_,Contexts_));
+			}
+			catch(std::exception& e)
+			{
+				result.Error_=e.what();
+				Requeue(Index,item);
+				//Attempts_ counts tries at sending, which this wasn't.
+				result.Attempts_--;
+				if(++Failures>=MaxAttempts_)
+					return;
+				continue;
+			}
+
+			//Nor is there any point retrying something the peer won't accept.
+			//We check here because ClientConnection::Store can't tell us apart
+			//from a broken association.
+			try
+			{
+				connection->GetPresentationContextID(classUID);
+			}
+			catch(std::exception& e)
+			{
+				result.Error_=e.what();
+				Finish(item);
+				continue;
+			}
+
+			try
+			{
+				result.Response_=connection->Store(data);
+				result.Response_(TAG_STATUS)>>result.Status_;
+				result.Sent_=true;
+				result.Error_.clear();
+				Failures=0;
+				Finish(item);
+			}
+			catch(std::exception& e)
+			{
+				//The association is no good any more, but it's not the instance's
+				//fault, so it goes back on the queue for us or someone else to retry.
+				connection.reset();
+				result.Error_=e.what();
+				if(result.Attempts_<MaxAttempts_)
+					Requeue(Index,item);
+				else
+					Finish(item);
+				if(++Failures>=MaxAttempts_)
+					return;
+			}
+		}
+	}
+}//namespace dicom
@@ -0,0 +1,108 @@
+#ifndef STORE_POOL_HPP_INCLUDE_GUARD_8306154927
+#define STORE_POOL_HPP_INCLUDE_GUARD_8306154927
+#include <string>
+#include <vector>
+#include <deque>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+#include "DataSet.hpp"
+#include "PresentationContexts.hpp"
+
+namespace dicom
+{
+	//!Sends a batch of instances to one destination over several associations at once.
+	/*!
+		Most of the time taken storing a large study over one association is
+		spent waiting on the network, so we open Associations connections and
+		give each its own thread.  Work is dealt out evenly to begin with, and
+		any thread that runs out steals from the back of another's queue, so
+		one slow association can't hold up the whole batch.
+
+		If an association fails, the instance being sent goes back on the
+		queue and the thread reconnects.  An instance is tried at most
+		MaxAttempts times, and a thread that can't reconnect after that many
+		attempts stops, leaving its work to the others.
+
+		Usage:
+		<pre>
+			StorePool pool("archive",104,"ME","ARCHIVE",contexts,4);
+			for(...)
+				pool.Add(FileName);
+			std::vector<StorePool::Result> results=pool.Run();
+		</pre>
+	*/
+	class StorePool : boost::noncopyable
+	{
+	public:
+		//!What happened to one instance.
+		struct Result
+		{
+			Result():Sent_(false),Status_(0),Attempts_(0){}
+
+			//!File name, if the instance was added as a file.
+			std::string FileName_;
+			UID InstanceUID_;
+			//!True if the peer responded, in which case Status_ is what it said.
+			bool Sent_;
+			UINT16 Status_;
+			//!Response command set.
+			DataSet Response_;
+			//!Why we gave up, if we didn't get a response.
+			std::string Error_;
+			size_t Attempts_;
+		};
+
+		//!Called from a worker thread as each instance completes.
+		typedef boost::function<void(const Result&)> Callback;
+
+		StorePool(std::string Host,unsigned short Port,
+			std::string LocalAET,std::string RemoteAET,
+			const PresentationContexts& ProposedPresentationContexts,
+			size_t Associations,size_t MaxAttempts=3);
+
+		void Add(const DataSet& data);
+
+		//!The file is only read when it's about to be sent.
+		void Add(const std::string& FileName);
+
+		//!Send everything added so far, and return results in the order added.
+		std::vector<Result> Run(Callback OnResult=Callback());
+
+	private:
+		struct Item
+		{
+			std::string FileName_;
+			DataSet Data_;
+		};
+
+		//!One association's share of the work.
+		struct Queue
+		{
+			boost::mutex mutex_;
+			std::deque<size_t> Items_;
+		};
+
+		void Work(size_t Index);
+		bool Next(size_t Index,size_t& Item);
+		void Requeue(size_t Index,size_t Item);
+		void Finish(size_t Item);
+
+		const std::string Host_;
+		const unsigned short Port_;
+		const std::string LocalAET_;
+		const std::string RemoteAET_;
+		const PresentationContexts Contexts_;
+		const size_t Associations_;
+		const size_t MaxAttempts_;
+
+		std::vector<Item> Items_;
+		std::vector<Result> Results_;
+		std::vector<boost::shared_ptr<Queue> > Queues_;
+		Callback OnResult_;
+		boost::mutex mutex_;//guards OnResult_ calls.
+	};
+}//namespace dicom
+
+#endif //STORE_POOL_HPP_INCLUDE_GUARD_8306154927
@@ -0,0 +1,80 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include "TagFilter.hpp"
+
+namespace dicom
+{
+	TagFilter::TagFilter()
+		:ExcludePrivate_(false),MaxLength_(UNDEFINED_LENGTH)
+	{
+	}
+
+	TagFilter& TagFilter::Include(Tag tag)
+	{
+		Included_.insert(tag);
+		return *this;
+	}
+
+	TagFilter& TagFilter::Include(const TagMask& mask)
+	{
+		IncludedMasks_.push_back(mask);
+		return *this;
+	}
+
+	TagFilter& TagFilter::Exclude(Tag tag)
+	{
+		Excluded_.insert(tag);
+		return *this;
+	}
+
+	TagFilter& TagFilter::Exclude(const TagMask& mask)
+	{
+		ExcludedMasks_.push_back(mask);
+		return *this;
+	}
+
+	TagFilter& TagFilter::ExcludePrivate()
+	{
+		ExcludePrivate_=true;
+		return *this;
+	}
+
+	TagFilter& TagFilter::ExcludeLongerThan(UINT32 Length)
+	{
+		MaxLength_=Length;
+		return *this;
+	}
+
+	bool TagFilter::Matches(Tag tag,const std::set<Tag>& tags,const std::vector<TagMask>& masks)
+	{
+		if(tags.count(tag))
+			return true;
+		for(std::vector<TagMask>::const_iterator I=masks.begin();I!=masks.end();I++)
+			if(tag==*I)
+				return true;
+		return false;
+	}
+
+	bool TagFilter::operator()(Tag tag,VR vr,UINT32 Length) const
+	{
+		if(ExcludePrivate_)
+		{
+			//Groups 0001, 0003, 0005, 0007 and FFFF aren't allowed to be private.
+			UINT16 Group=GroupTag(tag);
+			if((Group & 1) && Group>0x0007 && Group!=0xffff)
+				return false;
+		}
+		if(Length>MaxLength_ && vr!=VR_SQ && !(vr==VR_UN && UNDEFINED_LENGTH==Length))
+			return false;
+		if(Matches(tag,Excluded_,ExcludedMasks_))
+			return false;
+		if(Included_.empty() && IncludedMasks_.empty())
+			return true;
+		return Matches(tag,Included_,IncludedMasks_);
+	}
+}//namespace dicom
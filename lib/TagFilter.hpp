@@ -0,0 +1,64 @@
+#ifndef TAG_FILTER_HPP_INCLUDE_GUARD_6120597384
+#define TAG_FILTER_HPP_INCLUDE_GUARD_6120597384
+#include <set>
+#include <vector>
+#include "Tag.hpp"
+#include "VR.hpp"
+#include "Types.hpp"
+
+namespace dicom
+{
+	//!Decides which elements a read keeps, see ReadOptions.
+	/*!
+		Elements that don't pass are skipped over by their length, so their
+		values are never copied, tokenized or put on a data set.  A default
+		constructed filter passes everything.  e.g. to keep a few tags:
+
+		TagFilter filter;
+		filter.Include(TAG_PAT_ID).Include(TAG_STUDY_INST_UID);
+
+		or to keep everything but private elements, overlays and bulk data:
+
+		filter.ExcludePrivate().Exclude(TAG_OVERLAY_DATA).ExcludeLongerThan(64*1024);
+
+		Exclusions always win over inclusions.
+	*/
+	class TagFilter
+	{
+	public:
+		TagFilter();
+
+		//!Once anything has been included, only what has been included passes.
+		TagFilter& Include(Tag tag);
+		TagFilter& Include(const TagMask& mask);
+
+		TagFilter& Exclude(Tag tag);
+		//!e.g. Exclude(TAG_OVERLAY_DATA) for every overlay group
+		TagFilter& Exclude(const TagMask& mask);
+
+		//!Elements in odd groups, see Part 5, section 7.8
+		TagFilter& ExcludePrivate();
+
+		//!Values longer than Length bytes, other than sequences.
+		/*!
+			Encapsulated pixel data has undefined length, and so counts as
+			longer than anything.
+		*/
+		TagFilter& ExcludeLongerThan(UINT32 Length);
+
+		//!Does an element with this header pass?
+		bool operator()(Tag tag,VR vr,UINT32 Length) const;
+
+	private:
+		static bool Matches(Tag tag,const std::set<Tag>& tags,const std::vector<TagMask>& masks);
+
+		std::set<Tag> Included_;
+		std::vector<TagMask> IncludedMasks_;
+		std::set<Tag> Excluded_;
+		std::vector<TagMask> ExcludedMasks_;
+		bool ExcludePrivate_;
+		UINT32 MaxLength_;
+	};
+}//namespace dicom
+
+#endif //TAG_FILTER_HPP_INCLUDE_GUARD_6120597384
@@ -0,0 +1,44 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <boost/bind.hpp>
+#include "ThreadPool.hpp"
+
+namespace dicom
+{
+	ThreadPool::ThreadPool(size_t Threads,size_t QueueCapacity)
+		:tasks_(QueueCapacity),Size_(Threads)
+	{
+		if(0==Size_)
+			Size_=boost::thread::hardware_concurrency();
+		if(0==Size_)
+			Size_=1;
+		for(size_t i=0;i<Size_;i++)
+			threads_.create_thread(boost::bind(&ThreadPool::Run,this));
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		tasks_.Close();
+		threads_.join_all();
+	}
+
+	void ThreadPool::Post(const Task& task)
+	{
+		tasks_.Push(task);
+	}
+
+	void ThreadPool::Run()
+	{
+		Task task;
+		while(tasks_.Pop(task))//fails once closed, and nothing left to do.
+		{
+			task();
+			task.clear();
+		}
+	}
+}//namespace dicom
@@ -0,0 +1,46 @@
+#ifndef THREAD_POOL_HPP_INCLUDE_GUARD_2875619403
+#define THREAD_POOL_HPP_INCLUDE_GUARD_2875619403
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/utility.hpp>
+#include "BoundedQueue.hpp"
+
+namespace dicom
+{
+	//!A fixed set of worker threads pulling tasks off a shared queue.
+	/*!
+		Tasks must not throw; if they need to report failure they should
+		catch and record it themselves.  The destructor runs any tasks still
+		queued, then joins the workers.
+
+		If QueueCapacity is set, no more than that many tasks wait for a
+		worker, and Post() blocks until there's room, so whatever is
+		producing the tasks slows to the pool's pace.
+	*/
+	class ThreadPool : boost::noncopyable
+	{
+	public:
+		typedef boost::function<void()> Task;
+
+		//!Zero threads means one per hardware thread, zero QueueCapacity means no limit.
+		ThreadPool(size_t Threads=0,size_t QueueCapacity=0);
+		~ThreadPool();
+
+		//!Waits for room in the queue, if it's limited.
+		void Post(const Task& task);
+
+		size_t Size() const{return Size_;}
+
+		//!Tasks waiting for a worker.
+		QueueStats Stats(){return tasks_.Stats();}
+
+	private:
+		void Run();
+
+		BoundedQueue<Task> tasks_;
+		size_t Size_;
+		boost::thread_group threads_;
+	};
+}//namespace dicom
+
+#endif //THREAD_POOL_HPP_INCLUDE_GUARD_2875619403
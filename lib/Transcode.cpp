@@ -0,0 +1,324 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include "Transcode.hpp"
+#include "DataDictionary.hpp"
+#include "FileMetaInformation.hpp"
+#include "UIDs.hpp"
+#include "Types.hpp"
+#include "socket/Base.hpp"
+#include "socket/SwitchEndian.hpp"
+
+namespace dicom
+{
+	namespace
+	{
+		/*!
+			VRs that are followed by 2 reserved bytes and a 4 byte length in
+			explicit syntaxes, see Part 5, section 7.1.2.  We compare raw codes
+			because some of these (OF, OD, OL, UC, UR...) aren't in our VR enum.
+		*/
+		bool HasLongLength(UINT16 vr)
+		{
+			switch(vr)
+			{
+			case VR_OB: case VR_OW: case VR_SQ: case VR_UN: case VR_UT:
+			case 0x464f://OF
+			case 0x444f://OD
+			case 0x4c4f://OL
+			case 0x564f://OV
+			case 0x4355://UC
+			case 0x5255://UR
+			case 0x5653://SV
+			case 0x5655://UV
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		//!How many bytes to reverse at a time when changing byte order.
+		size_t SwapSize(UINT16 vr)
+		{
+			switch(vr)
+			{
+			case VR_US: case VR_SS: case VR_OW: case VR_AT:
+				return 2;
+			case VR_UL: case VR_SL: case VR_FL:
+			case 0x464f://OF
+			case 0x4c4f://OL
+				return 4;
+			case VR_FD:
+			case 0x444f://OD
+			case 0x564f://OV
+			case 0x5653://SV
+			case 0x5655://UV
+				return 8;
+			default:
+				return 1;
+			}
+		}
+
+		const bool HostIsBigEndian=(__BYTE_ORDER==__BIG_ENDIAN);
+
+		class Transcoder
+		{
+		public:
+			Transcoder(std::istream& In,std::ostream& Out,TS Target)
+				:In_(In),Out_(Out),To_(Target),BitsAllocated_(0),Chunk_(1<<16){}
+
+			/*!
+				Copy elements until Length bytes are consumed, an Item Delimitation Item
+				is found, or (at top level) the stream ends.  Returns bytes consumed.
+			*/
+			UINT32 CopyDataSet(const TS& From,UINT32 Length,bool TopLevel)
+			{
+				UINT32 Consumed=0;
+				while(UNDEFINED_LENGTH==Length || Consumed<Length)
+				{
+					if(TopLevel && In_.peek()==std::istream::traits_type::eof())
+						break;
+
+					Tag tag;
+					UINT16 vr;
+					UINT32 length;
+					Consumed+=ReadHeader(From,tag,vr,length);
+
+					if(TAG_ITEM_DELIM_ITEM==tag)
+						break;
+
+					if(vr==VR_SQ || UNDEFINED_LENGTH==length)
+					{
+						/*
+							UN with undefined length is a sequence encoded as
+							Implicit VR Little Endian. (Part 5, section 6.2.2, note 4)
+						*/
+						TS Inner((vr==VR_UN && From.isExplicitVR()) ? UID(IMPL_VR_LE_TRANSFER_SYNTAX) : From.getUID());
+						WriteHeader(tag,VR_SQ,UNDEFINED_LENGTH);
+						Consumed+=CopySequence(Inner,length);
+						continue;
+					}
+
+					Consumed+=length;
+
+					//group lengths would be wrong after rewriting, and they're optional anyway.
+					if(ElementTag(tag)==0x0000)
+					{
+						Skip(length);
+						continue;
+					}
+
+					if(TAG_BITS_ALLOC==tag && 2==length)
+					{
+						UINT16 Bits=Get<UINT16>(From);
+						BitsAllocated_=Bits;
+						WriteHeader(tag,vr,length);
+						Put(Bits);
+						continue;
+					}
+
+					//same hack as Decoder::DecodeVRAndLength()
+					if(TAG_PIXEL_DATA==tag && !From.isExplicitVR())
+						vr=(BitsAllocated_>8) ? VR_OW : VR_OB;
+
+					WriteHeader(tag,vr,length);
+					CopyValue(From,vr,length);
+				}
+				return Consumed;
+			}
+
+		private:
+
+			std::istream& In_;
+			std::ostream& Out_;
+			TS To_;
+			UINT16 BitsAllocated_;
+			std::vector<char> Chunk_;
+
+			void Read(char* p,size_t n)
+			{
+				In_.read(p,n);
+				if(size_t(In_.gcount())!=n)
+					throw TranscodeError("Unexpected end of file");
+			}
+
+			template<typename T>
+			T Get(const TS& From)
+			{
+				T data;
+				Read(reinterpret_cast<char*>(&data),sizeof(T));
+				if(From.isBigEndian()!=HostIsBigEndian && sizeof(T)>1)
+					data=SwitchEndian<T>(data);
+				return data;
+			}
+
+			template<typename T>
+			void Put(T data)
+			{
+				if(To_.isBigEndian()!=HostIsBigEndian && sizeof(T)>1)
+					data=SwitchEndian<T>(data);
+				Out_.write(reinterpret_cast<const char*>(&data),sizeof(T));
+			}
+
+			void PutTag(Tag tag)
+			{
+				Put(GroupTag(tag));
+				Put(ElementTag(tag));
+			}
+
+			//!Returns number of bytes in the header.
+			UINT32 ReadHeader(const TS& From,Tag& tag,UINT16& vr,UINT32& length)
+			{
+				UINT16 Group=Get<UINT16>(From);
+				UINT16 Element=Get<UINT16>(From);
+				tag=makeTag(Group,Element);
+
+				if(0xfffe==Group)//items and delimiters never have a VR
+				{
+					vr=VR_UN;
+					length=Get<UINT32>(From);
+					return 8;
+				}
+				if(!From.isExplicitVR())
+				{
+					vr=GetVR(tag);
+					length=Get<UINT32>(From);
+					return 8;
+				}
+
+				char v[2];
+				Read(v,2);
+				vr=(UINT16(BYTE(v[1]))<<8)|BYTE(v[0]);
+				if(HasLongLength(vr))
+				{
+					Get<UINT16>(From);//reserved
+					length=Get<UINT32>(From);
+					return 12;
+				}
+				length=Get<UINT16>(From);
+				return 8;
+			}
+
+			void WriteHeader(Tag tag,UINT16 vr,UINT32 length)
+			{
+				PutTag(tag);
+				if(!To_.isExplicitVR())
+				{
+					Put(length);
+					return;
+				}
+				//Values that came from an implicit syntax may be too long for a 2 byte length.
+				if(!HasLongLength(vr) && length>0xffff)
+					vr=VR_UN;
+
+				//VR is always written as two characters, regardless of byte order
+				Out_.put(char(vr & 0xff));
+				Out_.put(char(vr>>8));
+				if(HasLongLength(vr))
+				{
+					Put(UINT16(0));
+					Put(length);
+				}
+				else
+					Put(UINT16(length));
+			}
+
+			//!Part 5, section 7.5.  Items are always written with undefined length.
+			UINT32 CopySequence(const TS& From,UINT32 Length)
+			{
+				UINT32 Consumed=0;
+				while(UNDEFINED_LENGTH==Length || Consumed<Length)
+				{
+					UINT16 Group=Get<UINT16>(From);
+					UINT16 Element=Get<UINT16>(From);
+					UINT32 ItemLength=Get<UINT32>(From);
+					Consumed+=8;
+
+					Tag tag=makeTag(Group,Element);
+					if(TAG_SEQ_DELIM_ITEM==tag)
+						break;
+					if(TAG_ITEM!=tag)
+						throw TranscodeError("Expected a sequence item");
+
+					PutTag(TAG_ITEM);
+					Put(UNDEFINED_LENGTH);
+					Consumed+=CopyDataSet(From,ItemLength,false);
+					PutTag(TAG_ITEM_DELIM_ITEM);
+					Put(UINT32(0));
+				}
+				PutTag(TAG_SEQ_DELIM_ITEM);
+				Put(UINT32(0));
+				return Consumed;
+			}
+
+			void Skip(UINT32 Length)
+			{
+				while(Length>0)
+				{
+					size_t n=std::min<size_t>(Length,Chunk_.size());
+					Read(&Chunk_[0],n);
+					Length-=UINT32(n);
+				}
+			}
+
+			//!Copy a value through in chunks, swapping bytes in place if needed.
+			void CopyValue(const TS& From,UINT16 vr,UINT32 Length)
+			{
+				size_t Swap=(From.isBigEndian()!=To_.isBigEndian()) ? SwapSize(vr) : 1;
+				while(Length>0)
+				{
+					size_t n=std::min<size_t>(Length,Chunk_.size());//chunk size is a multiple of 8
+					Read(&Chunk_[0],n);
+					if(Swap>1)
+						for(char* p=&Chunk_[0];p+Swap<=&Chunk_[0]+n;p+=Swap)
+							std::reverse(p,p+Swap);
+					Out_.write(&Chunk_[0],n);
+					Length-=UINT32(n);
+				}
+			}
+		};
+	}
+
+	void Transcode(std::istream& In,std::ostream& Out,TS Target)
+	{
+		FileMetaInformation MetaIn(In);
+		UID SourceUID;
+		MetaIn.MetaElements_(TAG_TRANSFER_SYNTAX_UID) >> SourceUID;
+		TS From(SourceUID);
+
+		if(From.isEncapsulated() || From.isDeflated() || Target.isEncapsulated() || Target.isDeflated())
+			throw TranscodeError("Can only transcode between native transfer syntaxes");
+
+		//FileMetaInformation wants the SOP class and instance from the data set.
+		DataSet ids;
+		ids.Put<VR_UI>(TAG_SOP_CLASS_UID,MetaIn.MetaElements_(TAG_MEDIA_SOP_CLASS_UID).Get<UID>());
+		ids.Put<VR_UI>(TAG_SOP_INST_UID,MetaIn.MetaElements_(TAG_MEDIA_SOP_INST_UID).Get<UID>());
+		FileMetaInformation MetaOut(ids,Target);
+		MetaOut.Write(Out);
+
+		Transcoder transcoder(In,Out,Target);
+		transcoder.CopyDataSet(From,UNDEFINED_LENGTH,true);
+
+		if(!Out)
+			throw TranscodeError("Couldn't write output");
+	}
+
+	void Transcode(const std::string& InFile,const std::string& OutFile,TS Target)
+	{
+		std::ifstream In(InFile.c_str(),std::ios::binary);
+		if(In.fail())
+			throw dicom::exception("Couldn't open input file");
+		std::ofstream Out(OutFile.c_str(),std::ios::binary);
+		if(Out.fail())
+			throw dicom::exception("Couldn't open output file");
+		Transcode(In,Out,Target);
+	}
+
+}//namespace dicom
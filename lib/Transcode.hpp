@@ -0,0 +1,37 @@
+#ifndef TRANSCODE_HPP_INCLUDE_GUARD_7390215548
+#define TRANSCODE_HPP_INCLUDE_GUARD_7390215548
+#include <iostream>
+#include <string>
+#include "Exceptions.hpp"
+#include "TransferSyntax.hpp"
+
+namespace dicom
+{
+	//!Thrown if a file can't be transcoded.
+	struct TranscodeError : public dicom::exception
+	{
+		TranscodeError(std::string Description):dicom::exception(Description){}
+		virtual ~TranscodeError() throw(){}
+	};
+
+	//!Rewrite a DICOM file in another transfer syntax, without reading it onto a DataSet.
+	/*!
+		Handles Implicit VR Little Endian, Explicit VR Little Endian and
+		Explicit VR Big Endian, in any direction.  Elements are streamed through
+		one at a time: headers are rewritten, and values are byte swapped according
+		to their VR if the byte order changes.  The data dictionary is only consulted
+		to find VRs when going from implicit to explicit VR.  (Unknown tags become UN)
+
+		Header sizes differ between syntaxes, so sequences and items are always
+		written with undefined length, and group length elements are dropped.
+
+		The File Meta Information is rewritten with the new transfer syntax.
+		Encapsulated and deflated syntaxes aren't supported.
+	*/
+	void Transcode(std::istream& In,std::ostream& Out,TS Target);
+
+	void Transcode(const std::string& InFile,const std::string& OutFile,TS Target);
+
+}//namespace dicom
+
+#endif //TRANSCODE_HPP_INCLUDE_GUARD_7390215548
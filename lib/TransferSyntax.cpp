@@ -27,7 +27,10 @@ namespace dicom
 			JPEG_BASELINE_TRANSFER_SYNTAX == uid		||
 			JPEG_LOSSLESS_NON_HIERARCHICAL == uid		||
 			JPEG2000_LOSSLESS_ONLY == uid               ||
-            JPEG2000 == uid
+            JPEG2000 == uid								||
+			JPEG_LS_LOSSLESS == uid						||
+			JPEG_LS_NEAR_LOSSLESS == uid				||
+			RLE_LOSSLESS == uid
 			,"Syntax not recognised: " + uid.str());
 
 	}
@@ -67,7 +70,10 @@ namespace dicom
 			JPEG_BASELINE_TRANSFER_SYNTAX==uid_||
 			JPEG_LOSSLESS_NON_HIERARCHICAL==uid_ ||
 			JPEG2000_LOSSLESS_ONLY==uid_ ||
-            JPEG2000 ==uid_
+            JPEG2000 ==uid_ ||
+			JPEG_LS_LOSSLESS==uid_ ||
+			JPEG_LS_NEAR_LOSSLESS==uid_ ||
+			RLE_LOSSLESS==uid_
 			);
 	}
 }//namespace dicom
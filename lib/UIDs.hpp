@@ -64,6 +64,15 @@ namespace dicom
 
     const UID JPEG2000                              = UID("1.2.840.10008.1.2.4.91");
 
+	//!JPEG-LS Lossless Image Compression (Part 5, Annex A.4.3)
+	const UID JPEG_LS_LOSSLESS						= UID("1.2.840.10008.1.2.4.80");
+
+	//!JPEG-LS Lossy (Near-Lossless) Image Compression
+	const UID JPEG_LS_NEAR_LOSSLESS					= UID("1.2.840.10008.1.2.4.81");
+
+	//!RLE Lossless, see Part 5, Annex G.  We can decode this one ourselves, see Codec.hpp
+	const UID RLE_LOSSLESS							= UID("1.2.840.10008.1.2.5");
+
 
 
 	/*
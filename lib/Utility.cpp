@@ -8,6 +8,11 @@
 
 #include	"Utility.hpp"
 #include <algorithm>
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
 
 
 void StripTrailingWhitespace(std::string& str)
@@ -87,3 +92,18 @@ UINT16	uniq16odd()
 	return((uniqid++)%0xffff);
 }
 
+boost::uint64_t MonotonicNanoseconds()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency;
+	if(!frequency.QuadPart)
+		QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return boost::uint64_t(double(now.QuadPart)*1e9/double(frequency.QuadPart));
+#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return boost::uint64_t(now.tv_sec)*1000000000u+boost::uint64_t(now.tv_nsec);
+#endif
+}
@@ -4,6 +4,7 @@
 #include <limits>
 #include <boost/type_traits.hpp>
 #include <boost/static_assert.hpp>
+#include <boost/cstdint.hpp>
 #include "Types.hpp"
 
 //these should be in dicom namespace
@@ -45,4 +46,7 @@ struct OddSeries
 //UINT8		uniq8odd();
 UINT16		uniq16odd();
 
+//!A clock for timing things, that never goes backwards.
+boost::uint64_t MonotonicNanoseconds();
+
 #endif //UTILITY_HPP_INCLUDE_GUARD_45475351328
@@ -230,7 +230,7 @@ namespace dicom
 
 	*/
 	template <typename TYPE>
-	void DynamicVRCheck(VR vr) throw(BadVR)
+	void DynamicVRCheck(VR vr)
 	{
 		switch (vr)
 		{
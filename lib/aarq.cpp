@@ -78,6 +78,11 @@ namespace dicom
 		const BYTE MaximumSubLength::ItemType_;
 		const BYTE MaximumSubLength::Reserved1_;
 		const UINT16 MaximumSubLength::Length_;
+		const UINT32 MaximumSubLength::DefaultMaximumLength_;
+
+		const BYTE AsyncOperationsWindow::ItemType_;
+		const BYTE AsyncOperationsWindow::Reserved_;
+		const UINT16 AsyncOperationsWindow::Length_;
 
 		const BYTE UserInformation::ItemType_;
 		const BYTE UserInformation::Reserved_;
@@ -426,6 +431,7 @@ namespace dicom
 		************************************************************************/
 
 		MaximumSubLength::MaximumSubLength()
+			:MaximumLength_(DefaultMaximumLength_)
 		{
 		}
 
@@ -474,6 +480,51 @@ namespace dicom
 
 
 
+		/************************************************************************
+		*
+		* Asynchronous Operations Window
+		*
+		************************************************************************/
+
+		AsyncOperationsWindow::AsyncOperationsWindow()
+			:MaxOperationsInvoked_(1),MaxOperationsPerformed_(1)
+		{
+		}
+
+		AsyncOperationsWindow::AsyncOperationsWindow(UINT16 Invoked,UINT16 Performed)
+			:MaxOperationsInvoked_(Invoked),MaxOperationsPerformed_(Performed)
+		{
+		}
+
+		void AsyncOperationsWindow::Write(Network::Socket& socket)
+		{
+			socket << ItemType_;
+			socket << Reserved_;
+			socket << Length_;
+			socket << MaxOperationsInvoked_;
+			socket << MaxOperationsPerformed_;
+		}
+
+		UINT32 AsyncOperationsWindow::ReadDynamic(Network::Socket& socket)
+		{
+			UINT32 byteread=0;
+			socket >> tmpBYTE;
+			UINT16 Length;
+			socket >> Length;
+			byteread+=sizeof(tmpBYTE)+sizeof(Length);
+			if(Length!=Length_)
+				throw dicom::exception("itemlength of AsyncOperationsWindow must be 0x04");
+			socket >> MaxOperationsInvoked_;
+			socket >> MaxOperationsPerformed_;
+			byteread+=sizeof(MaxOperationsInvoked_)+sizeof(MaxOperationsPerformed_);
+			return byteread;
+		}
+
+		UINT32 AsyncOperationsWindow::Size()
+		{
+			return ( Length_ + sizeof(BYTE) + sizeof(BYTE) + sizeof(UINT16));
+		}
+
 		/******** SCP / SCU Role Select ***********/
 
 
@@ -531,6 +582,7 @@ namespace dicom
 		UserInformation::UserInformation()
 			:ImpClass_(UID(""))
 			,UserInfoBaggage_ (0)
+			,HasAsyncOpsWindow_(false)
 		{
 			
 		}
@@ -543,6 +595,12 @@ namespace dicom
 			MaxSubLength_ = Max;
 		}
 
+		void UserInformation::SetAsyncOperationsWindow(const AsyncOperationsWindow& Window)
+		{
+			AsyncOpsWindow_=Window;
+			HasAsyncOpsWindow_=true;
+		}
+
 		//UINT32 UserInformation::GetMax()
 		//{
 		//	return(MaxSubLength.Get());
@@ -561,6 +619,10 @@ namespace dicom
 			MaxSubLength_.Write(socket);
 			ImpClass_.Write(socket);
 
+			//Part 7, D.3.3 wants the sub-items in this order.
+			if(HasAsyncOpsWindow_)
+				AsyncOpsWindow_.Write(socket);
+
 			//should only send this if it really exists...
 			ImpVersion_.Write(socket);
 		
@@ -576,6 +638,7 @@ namespace dicom
 			UINT32 byteread=0;
 			UINT32 tmp_read=0;
 			UserInfoBaggage_ = 0;
+			HasAsyncOpsWindow_ = false;
 
 			UINT16 length;
 			socket >> tmpBYTE;
@@ -600,6 +663,12 @@ namespace dicom
 					byteread+=tmp_read;
 					BytesLeftToRead=BytesLeftToRead-tmp_read;/*ImpClass_.Size()*/;
 					break;
+				case	0x53:	// Asynchronous operations window
+					tmp_read=AsyncOpsWindow_.ReadDynamic(socket);
+					byteread+=tmp_read;
+					BytesLeftToRead = BytesLeftToRead - tmp_read;
+					HasAsyncOpsWindow_ = true;
+					break;
 				case	0x54:	// Role selection
 					/*
 						This is very ugly, the use of UserInfoBaggage_ is not a nice idea.
@@ -696,6 +765,8 @@ We should maybe branch to try this out
 			
 			length += ImpVersion_.Size();
 
+			if(HasAsyncOpsWindow_)
+				length += AsyncOpsWindow_.Size();
 
 	//		Length_=length;//should this be before previous line?
 
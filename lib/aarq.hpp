@@ -241,6 +241,8 @@ namespace dicom
 			static const BYTE			ItemType_ = 0x51;
 			static const BYTE			Reserved1_=0x00;;
 			static const UINT16			Length_ = 0x04;
+			//!What we propose unless told otherwise.  0 means no limit.
+			static const UINT32			DefaultMaximumLength_ = 16384;
 			UINT32						MaximumLength_;
 		public:
 			MaximumSubLength();
@@ -255,6 +257,29 @@ namespace dicom
 		};
 
 
+		//!How many operations each side may have outstanding at once.
+		/*!
+			Defined in Part 7, tables D.3-7 and D.3-8.  If it isn't negotiated
+			both numbers default to 1, i.e. a request must be answered before
+			the next can be sent.  0 means unlimited.
+		*/
+		struct AsyncOperationsWindow
+		{
+			static const BYTE			ItemType_ = 0x53;
+			static const BYTE			Reserved_ = 0x00;
+			static const UINT16			Length_ = 0x04;
+
+			UINT16						MaxOperationsInvoked_;
+			UINT16						MaxOperationsPerformed_;
+
+			AsyncOperationsWindow();
+			AsyncOperationsWindow(UINT16 Invoked,UINT16 Performed);
+
+			void		Write(Network::Socket &);
+			UINT32		ReadDynamic(Network::Socket	&);
+			UINT32		Size();
+		};
+
 		/*!
 			Defined in Part 8/table 9-16
 		*/
@@ -272,10 +297,15 @@ namespace dicom
 
 			//this is an optional field.  How do we indicate that?
 			SCPSCURoleSelect			SCPSCURole_;
+
+			//!Optional, only sent or received if HasAsyncOpsWindow_ is set.
+			AsyncOperationsWindow		AsyncOpsWindow_;
+			bool						HasAsyncOpsWindow_;
 		public:
 			UserInformation();
 
 			void		SetMax(MaximumSubLength	&);
+			void		SetAsyncOperationsWindow(const AsyncOperationsWindow&);
 			//UINT32		GetMax();
 			void		Write(Network::Socket &);
 			//bool		Read(Network::Socket &);
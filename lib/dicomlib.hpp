@@ -18,13 +18,24 @@
 	application with multithreaded TCP/IP server capabilities, you must
 	also include "dicomlib/Server.hpp"
 */
+#include "AssociationPool.hpp"
 #include "AssociationRejection.hpp"
+#include "AsyncAssociation.hpp"
+#include "AsyncClient.hpp"
+#include "BatchReader.hpp"
 #include "Cdimse.hpp"
+#include "Codec.hpp"
 #include "ClientConnection.hpp"
 #include "DataDictionary.hpp"
+#include "DescriptorStream.hpp"
+#include "Prefetcher.hpp"
 #include "Dumper.hpp"
 #include "File.hpp"
+#include "FrameReader.hpp"
 #include "QueryRetrieve.hpp"
+#include "StorePool.hpp"
+#include "TagFilter.hpp"
+#include "Transcode.hpp"
 #include "ValueToStream.hpp"
 #include "UIDs.hpp"
 #include "Utility.hpp"
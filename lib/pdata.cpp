@@ -3,7 +3,7 @@
 #include <assert.h>
 #include "Decoder.hpp"
 #include "iso646.h"
-//#include "Profiling.hpp"
+#include "Profiling.hpp"
 
 
 
@@ -43,7 +43,7 @@ namespace dicom
 
  	bool	PDataTF::ReadDynamic(Network::Socket& socket)
  	{
-//		scoped_profiler prof("PDataTF::ReadDynamic") ;
+		DICOMLIB_PROFILE("PDataTF::ReadDynamic");
  		UINT32		Count;
 
  		if(!Length)//why would this ever not be the case?
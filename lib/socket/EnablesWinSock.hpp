@@ -34,7 +34,7 @@ namespace Network
 		}
 
 		//!Wraps call to WSAStartup
-		void StartWinSock() throw(SystemError)		
+		void StartWinSock()		
 		{
 			WORD VersionNeeded = 0x0101;
 			static	WSADATA	wsaData;
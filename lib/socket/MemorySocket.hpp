@@ -0,0 +1,86 @@
+#ifndef MEMORY_SOCKET_HPP_INCLUDE_GUARD_5502917736
+#define MEMORY_SOCKET_HPP_INCLUDE_GUARD_5502917736
+
+#include "Socket.hpp"
+
+namespace Network
+{
+	//!A Socket that reads from and writes to memory.
+	/*!
+		The message primitives (AAssociateRQ and friends) only know how to
+		read and write themselves through a Socket.  This lets them be parsed
+		from, and serialized to, bytes that have been received or will be sent
+		by some other means - e.g. a non-blocking descriptor driven by a reactor.
+
+		Reads come from a range supplied by the caller, which must stay valid
+		while it's being read.  Running off the end of it throws ConnectionLost,
+		which is what a blocking socket would do if the peer went away half way
+		through a PDU.  Writes are appended to Output().
+	*/
+	class MemorySocket : public Socket
+	{
+		const unsigned char* Position_;
+		const unsigned char* End_;
+		mutable std::vector<unsigned char> Output_;
+	public:
+		MemorySocket():Position_(0),End_(0){}
+
+		MemorySocket(const unsigned char* Begin,const unsigned char* End)
+			:Position_(Begin),End_(End){}
+
+		//!Start reading from a new range.
+		void Feed(const unsigned char* Begin,const unsigned char* End)
+		{
+			Position_=Begin;
+			End_=End;
+		}
+
+		//!Bytes not yet read.
+		size_t Remaining() const
+		{
+			return End_-Position_;
+		}
+
+		//!Everything written so far.
+		std::vector<unsigned char>& Output()
+		{
+			return Output_;
+		}
+
+		virtual void Append(std::vector<unsigned char>& data,size_t count)
+		{
+			if(Remaining()<count)
+				throw ConnectionLost("Read past end of PDU");
+			data.insert(data.end(),Position_,Position_+count);
+			Position_+=count;
+		}
+
+		virtual const SOCKET GetSocketDescriptor() const
+		{
+			return SOCKET(-1);
+		}
+		virtual const std::string get_remote_ip() const
+		{
+			return std::string("");
+		}
+
+	protected:
+		virtual int ReceiveBytes(void* Data,int BytesToRead)
+		{
+			if(Remaining()<size_t(BytesToRead))
+				throw ConnectionLost("Read past end of PDU");
+			memcpy(Data,Position_,BytesToRead);
+			Position_+=BytesToRead;
+			return BytesToRead;
+		}
+
+		virtual int SendBytes(const void* Data,int BytesToSend) const
+		{
+			const unsigned char* p=static_cast<const unsigned char*>(Data);
+			Output_.insert(Output_.end(),p,p+BytesToSend);
+			return BytesToSend;
+		}
+	};
+}//namespace Network
+
+#endif //MEMORY_SOCKET_HPP_INCLUDE_GUARD_5502917736
@@ -28,6 +28,7 @@
 #include "EnablesWinSock.hpp"
 #include "Base.hpp"
 #include "SwitchEndian.hpp"
+#include "../Profiling.hpp"
 
 #if defined (_WIN32)
 	typedef char* RECV_DATA_TYPE;
@@ -170,7 +171,8 @@ namespace Network
 	{
 	public:
 
-		Socket(int ExternalEndian=__BIG_ENDIAN):ExternalByteOrder_(ExternalEndian){}
+		Socket(int ExternalEndian=__BIG_ENDIAN)
+			:ExternalByteOrder_(ExternalEndian),ReadAheadBegin_(0),ReadAheadEnd_(0){}
 
 		const int ExternalByteOrder_;//will generally be BIG_ENDIAN, but in some dicom cases will be LITTLE_ENDIAN
 
@@ -197,11 +199,8 @@ namespace Network
 			int BytesToRead=int(count*sizeof(T));
 
 			//Read data from socket
-#ifdef __unix
-			int BytesRead=recv(GetSocketDescriptor(),(RECV_DATA_TYPE)Begin,BytesToRead,MSG_WAITALL);
-#else
-			int BytesRead=WindowsSafeRecv(GetSocketDescriptor(),(RECV_DATA_TYPE)Begin,BytesToRead);
-#endif
+			int BytesRead=ReceiveBytes(Begin,BytesToRead);
+
 			//fix endian-ness - this is very slow...
 			if(ExternalByteOrder_!=__BYTE_ORDER && sizeof(T)>1)
 				std::transform(Begin,Begin+count,Begin,SwitchEndian<T>);
@@ -264,6 +263,10 @@ namespace Network
 
 		bool MoreData(int BlockFor=0)const
 		{
+			//Anything we've already pulled off the socket counts.
+			if(ReadAheadBegin_!=ReadAheadEnd_)
+				return true;
+
 			fd_set rfds;
 			timeval tv;
 
@@ -272,6 +275,7 @@ namespace Network
 
 			tv.tv_sec = BlockFor;
 			tv.tv_usec = 0;
+			DICOMLIB_COUNT(SYSCALLS,1);
 			SOCKET retval = select(int(GetSocketDescriptor()+1), &rfds, NULL, NULL, &tv);
 			if(retval==-1)
 				throw SystemError("select.");
@@ -297,7 +301,168 @@ namespace Network
 			return *this;
 		}
 
+		//!Read count bytes from the socket onto the end of data.
+		/*!
+			Unlike Read(), data doesn't have to be sized first, so a caller
+			gathering a message from several PDVs needn't work out where each
+			one goes.  Once the read-ahead block is drained, anything big enough
+			to be read straight from the socket is, into the end of data, rather
+			than being copied through the block.  That does mean growing data
+			first, and std::vector zero-fills what it grows by, but clearing
+			memory is cheaper than a copy and a recv() per 64KB.
+		*/
+		virtual void Append(std::vector<unsigned char>& data,size_t count)
+		{
+			while(count>0)
+			{
+				if(ReadAheadBegin_==ReadAheadEnd_ && count>=ReadAheadSize)
+				{
+					size_t Size=data.size();
+					data.resize(Size+count);
+					int BytesRead=ReceiveAll(&data[Size],int(count));
+					data.resize(Size+std::max(BytesRead,0));
+					if(BytesRead==0)
+						throw ConnectionLost();
+					if(BytesRead<0)
+						throw SystemError("recv",Network::GetLastError());
+					count-=BytesRead;
+					continue;
+				}
+				if(ReadAheadBegin_==ReadAheadEnd_)
+				{
+					int BytesRead=FillReadAhead();
+					if(BytesRead==0)
+						throw ConnectionLost();
+					if(BytesRead<0)
+						throw SystemError("recv",Network::GetLastError());
+				}
+				const unsigned char* Begin=&ReadAhead_[ReadAheadBegin_];
+				size_t n=std::min(count,ReadAheadEnd_-ReadAheadBegin_);
+				data.insert(data.end(),Begin,Begin+n);
+				ReadAheadBegin_+=n;
+				count-=n;
+			}
+		}
+
+		//!How much we try to pull off the socket at a time.
+		static const size_t ReadAheadSize=65536;
+
+	protected:
+		//!Blocks until BytesToRead bytes have arrived.
+		/*!
+			Returns the number of bytes read, 0 if the peer has closed the connection.
+			Everything that reads goes through here, so a derived class can take its
+			data from somewhere other than a socket descriptor.  (See MemorySocket)
+
+			A PDU is mostly small fixed-size fields, and reading them one recv()
+			at a time was a system call per field.  So small reads are served
+			from a block read ahead of what's been asked for, and only reads too
+			big to be worth copying twice go straight to the socket.
+		*/
+		virtual int ReceiveBytes(void* Data,int BytesToRead)
+		{
+			unsigned char* Out=static_cast<unsigned char*>(Data);
+			int Done=TakeReadAhead(Out,BytesToRead);
+			if(Done==BytesToRead)
+				return Done;
+
+			if(size_t(BytesToRead-Done)>=ReadAheadSize)
+			{
+				int BytesRead=ReceiveAll(Out+Done,BytesToRead-Done);
+				if(BytesRead<=0)
+					return Done ? Done : BytesRead;
+				return Done+BytesRead;
+			}
+
+			while(Done<BytesToRead)
+			{
+				int BytesRead=FillReadAhead();
+				if(BytesRead<=0)
+					return Done ? Done : BytesRead;
+				Done+=TakeReadAhead(Out+Done,BytesToRead-Done);
+			}
+			return Done;
+		}
+
+		//!Counterpart of ReceiveBytes(), returns the number of bytes sent.
+		virtual int SendBytes(const void* Data,int BytesToSend) const
+		{
+			DICOMLIB_COUNT(SYSCALLS,1);
+#ifdef MSG_NOSIGNAL
+			//A peer that's gone away should give us an error, not SIGPIPE.
+			int BytesSent=::send(GetSocketDescriptor(),(SEND_DATA_TYPE)Data,BytesToSend,MSG_NOSIGNAL);
+#else
+			int BytesSent=::send(GetSocketDescriptor(),(SEND_DATA_TYPE)Data,BytesToSend,0);
+#endif
+			if(BytesSent>0)
+				DICOMLIB_COUNT(BYTES_SENT,BytesSent);
+			return BytesSent;
+		}
+
 	private:
+		//!Copy up to BytesToRead bytes out of the read-ahead block.
+		int TakeReadAhead(unsigned char* Data,int BytesToRead)
+		{
+			size_t n=std::min(size_t(BytesToRead),ReadAheadEnd_-ReadAheadBegin_);
+			if(n)
+			{
+				memcpy(Data,&ReadAhead_[ReadAheadBegin_],n);
+				ReadAheadBegin_+=n;
+			}
+			return int(n);
+		}
+
+		//!Refill the read-ahead block with whatever has arrived, blocking if nothing has.
+		/*!
+			Only called once the block is empty.  Returns what recv() did.
+		*/
+		int FillReadAhead()
+		{
+			//Allocated on first use, so listening sockets never pay for it.
+			if(ReadAhead_.empty())
+			{
+				ReadAhead_.resize(size_t(ReadAheadSize));
+				DICOMLIB_COUNT(ALLOCATIONS,1);
+			}
+			ReadAheadBegin_=ReadAheadEnd_=0;
+			int BytesRead;
+			do
+			{
+				DICOMLIB_COUNT(SYSCALLS,1);
+				BytesRead=recv(GetSocketDescriptor(),(RECV_DATA_TYPE)&ReadAhead_[0],int(ReadAhead_.size()),0);
+			}
+#ifdef _WIN32
+			while(false);
+#else
+			while(BytesRead<0 && errno==EINTR);
+#endif
+			if(BytesRead>0)
+			{
+				ReadAheadEnd_=BytesRead;
+				DICOMLIB_COUNT(BYTES_RECEIVED,BytesRead);
+			}
+			return BytesRead;
+		}
+
+		//!Block until all BytesToRead bytes have been received.
+		int ReceiveAll(void* Data,int BytesToRead)
+		{
+			DICOMLIB_COUNT(SYSCALLS,1);
+#ifdef __unix
+			int BytesRead=recv(GetSocketDescriptor(),(RECV_DATA_TYPE)Data,BytesToRead,MSG_WAITALL);
+#else
+			int BytesRead=WindowsSafeRecv(GetSocketDescriptor(),(RECV_DATA_TYPE)Data,BytesToRead);
+#endif
+			if(BytesRead>0)
+				DICOMLIB_COUNT(BYTES_RECEIVED,BytesRead);
+			return BytesRead;
+		}
+
+		//!Data received but not yet read, ReadAhead_[ReadAheadBegin_,ReadAheadEnd_)
+		std::vector<unsigned char> ReadAhead_;
+		size_t ReadAheadBegin_;
+		size_t ReadAheadEnd_;
+
 		//!Assume endian issues already handled..
 		template <typename T>
 		void Sendn_AlreadySwapped(const T* Begin,size_t count) const
@@ -305,8 +470,7 @@ namespace Network
 			BOOST_STATIC_ASSERT(::boost::is_fundamental<T>::value);
 			int BytesToSend=int(count*sizeof(T));
 
-			int BytesSent = ::send(GetSocketDescriptor(),
-				(SEND_DATA_TYPE)Begin,	BytesToSend,	0);
+			int BytesSent = SendBytes(Begin,BytesToSend);
 
 			if(BytesSent!=BytesToSend)
 				throw SystemError("send",GetLastError());
@@ -107,6 +107,9 @@ namespace demo
 		std::for_each(result.begin(),result.end(),PrintResult);
 	}
 
+	//!Keeps the association open between calls to DoCMove
+	dicom::AssociationPool pool;
+
 	/*!
 		Instruct the pacs server to send the set of images belonging to
         a given study to another DICOM application entity
@@ -117,7 +120,7 @@ namespace demo
 		presentation_contexts.Add(dicom::STUDY_ROOT_QR_MOVE_SOP_CLASS);
 		//presentation_contexts.Add(dicom::PATIENT_ROOT_QR_MOVE_SOP_CLASS);
 
-		dicom::ClientConnection connection(host,remote_port,local_AE,remote_AE,presentation_contexts);
+		dicom::AssociationPool::Handle connection=pool.Acquire(host,remote_port,local_AE,remote_AE,presentation_contexts);
 		
         static unsigned int count = 0;
         static std::vector<std::string> UID_list = boost::assign::list_of ("1.2.392.200036.9116.2.6.1.48.1214242831.1408519596.617924")
@@ -164,11 +167,13 @@ namespace demo
         try
         {
           //request that a set of images be sent.
-          dicom::DataSet result=connection.Move("MECHGRAD", request, dicom::QueryRetrieve::STUDY_ROOT);
+          dicom::DataSet result=connection->Move("MECHGRAD", request, dicom::QueryRetrieve::STUDY_ROOT);
           std::cout << result << std::endl;
         }
         catch(std::exception& e)
         {
+          //don't hand a broken association out again.
+          connection.Discard();
           std::string msg = e.what();
           std::cout << msg << std::endl;
         }
@@ -197,27 +202,8 @@ int main(int, char**)
 
         std::cout << std::endl << "Attempting to open a data set from " << dicomDir << std::endl;
         
-        /*boost::filesystem::recursive_directory_iterator dir(dicomDir), end;
-        
-        while (dir != end)
-        {
-          boost::filesystem::path path = dir->path();
-          
-          std::cout << "path = " << path.string() << std::endl;
-          
-          if (boost::filesystem::is_regular_file(path))
-          {
-            try
-            {
-              demo::OpenDataSet(dir->path().string());
-            }
-            catch (...)
-            {
-            }
-          }
-          
-          ++dir;
-        }*/
+        //demo::OpenDataSet(dicomDir+"IM0001");
+        //(To pull tags out of a whole tree of files, use dicom-index, see tools/DicomIndex.cpp)
 
         std::cout << std::endl << "Attempting to connect to the remote server at " << host << ":" << remote_port << std::endl;
 		//demo::ConnectToRemoteServer();
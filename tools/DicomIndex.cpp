@@ -0,0 +1,362 @@
+/************************************************************************
+*	DICOMLIB
+*	Copyright 2003 Sunnybrook and Women's College Health Science Center
+*	Implemented by Trevor Morgan  (morgan@sten.sunnybrook.utoronto.ca)
+*
+*	See LICENSE.txt for copyright and licensing info.
+*************************************************************************/
+
+/*
+	dicom-index: pull a handful of tags out of every DICOM file under some
+	directories, a row per file, e.g. to build a study index.
+
+		dicom-index [--tag gggg,eeee]... [--threads N] [--prefetch N] [--csv FILE] [--columns DIR] DIRECTORY...
+
+	Only the elements up to the last tag asked for are read from each file,
+	so pixel data is never read, let alone decoded, and of those only the
+	tags asked for are decoded; the rest are skipped over.  Files are read on a
+	pool of threads, while this one walks the directories.
+
+	--prefetch N has the kernel start reading the start of the next N files
+	(by default 64) while earlier ones are decoded, see Prefetcher.  0 turns
+	it off.
+
+	--csv writes comma separated values, with a header row ("-" for stdout,
+	which is the default if neither output is given.)
+
+	--columns writes a column store to DIR: for each column, NAME.data holds
+	every row's value back to back, and NAME.offsets holds where each row's
+	value ends, as little endian 64 bit integers.  So row i of a column is
+	bytes [offsets[i-1],offsets[i]) of its data.  DIR/schema.txt has the row
+	count and then a line per column, its NAME and what it is.  The first
+	column is the file's path, the rest are the tags, named e.g. 00100020.
+
+	Rows come out in whatever order the files are finished, the same order
+	in each output.  Values with multiplicity are joined with backslashes,
+	as they are in the file.  Bulk data (OB, OW, UN) and sequences are left
+	empty, and so is any tag a file doesn't have.  Files that aren't DICOM,
+	or can't be read, are skipped and counted.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <boost/shared_ptr.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "lib/File.hpp"
+#include "lib/FileMetaInformation.hpp"
+#include "lib/ValueToStream.hpp"
+#include "lib/DataDictionary.hpp"
+#include "lib/ThreadPool.hpp"
+#include "lib/Prefetcher.hpp"
+
+using namespace dicom;
+
+namespace
+{
+	//!What main.cpp's demo used to print, plus what an index needs to tell instances apart.
+	const Tag DefaultTags[]=
+	{
+		TAG_PAT_ID,TAG_PAT_NAME,TAG_PAT_BIRTH_DATE,TAG_STUDY_INST_UID,TAG_STUDY_DATE,
+		TAG_ACCESS_NO,TAG_MODALITY,TAG_SERIES_INST_UID,TAG_SERIES_NO,TAG_SOP_INST_UID
+	};
+
+	//!Accepts gggg,eeee (gggg,eeee) or ggggeeee, in hex.
+	bool ParseTag(std::string Text,Tag& tag)
+	{
+		std::string Digits;
+		for(std::string::const_iterator I=Text.begin();I!=Text.end();I++)
+			if(*I!='(' && *I!=')' && *I!=',')
+				Digits+=*I;
+		if(Digits.size()!=8 || Digits.find_first_not_of("0123456789abcdefABCDEF")!=std::string::npos)
+			return false;
+		tag=Tag(std::strtoul(Digits.c_str(),0,16));
+		return true;
+	}
+
+	std::string ColumnName(Tag tag)
+	{
+		std::ostringstream os;
+		os << std::hex << std::uppercase << std::setw(8) << std::setfill('0') << UINT32(tag);
+		return os.str();
+	}
+
+	//!Every value of tag, joined with backslashes.  Empty for bulk data and sequences.
+	std::string ValueOf(const DataSet& data,Tag tag)
+	{
+		std::string Result;
+		std::pair<DataSet::const_iterator,DataSet::const_iterator> Range=data.equal_range(tag);
+		for(DataSet::const_iterator I=Range.first;I!=Range.second;I++)
+		{
+			const VR vr=I->second.vr();
+			if(vr==VR_OB || vr==VR_OW || vr==VR_UN || vr==VR_SQ)
+				return "";
+			if(I!=Range.first)
+				Result+='\\';
+			Result+=GetValueDataInString(I->second);
+		}
+		return Result;
+	}
+
+	std::string QuoteCSV(const std::string& Value)
+	{
+		if(Value.find_first_of(",\"\r\n")==std::string::npos)
+			return Value;
+		std::string Quoted("\"");
+		for(std::string::const_iterator I=Value.begin();I!=Value.end();I++)
+		{
+			if(*I=='"')
+				Quoted+='"';
+			Quoted+=*I;
+		}
+		return Quoted+'"';
+	}
+
+	//!One column of the column store.
+	class Column : boost::noncopyable
+	{
+	public:
+		Column(const boost::filesystem::path& Directory,const std::string& Name)
+			:Data_((Directory/(Name+".data")).string().c_str(),std::ios::binary)
+			,Offsets_((Directory/(Name+".offsets")).string().c_str(),std::ios::binary)
+			,End_(0)
+		{
+			if(!Data_ || !Offsets_)
+				throw std::runtime_error("Can't create column "+Name+" in "+Directory.string());
+		}
+
+		void Append(const std::string& Value)
+		{
+			Data_.write(Value.data(),std::streamsize(Value.size()));
+			End_+=Value.size();
+			char Offset[8];
+			for(int i=0;i<8;i++)
+				Offset[i]=char((End_>>(8*i)) & 0xff);
+			Offsets_.write(Offset,sizeof(Offset));
+		}
+
+	private:
+		std::ofstream Data_;
+		std::ofstream Offsets_;
+		boost::uint64_t End_;
+	};
+
+	//!Reads files on the pool's threads, and writes their rows to the outputs one at a time.
+	class Indexer : boost::noncopyable
+	{
+	public:
+		Indexer(const std::vector<Tag>& Tags,std::ostream* CSV,const std::string& ColumnDirectory)
+			:Tags_(Tags),CSV_(CSV),Rows_(0),Failed_(0)
+		{
+			Options_.StopBeforeTag_=Tag(UINT32(*std::max_element(Tags.begin(),Tags.end()))+1);
+			for(std::vector<Tag>::const_iterator I=Tags.begin();I!=Tags.end();I++)
+				Options_.TagFilter_.Include(*I);
+			if(CSV_)
+			{
+				*CSV_ << "path";
+				for(std::vector<Tag>::const_iterator I=Tags_.begin();I!=Tags_.end();I++)
+					*CSV_ << "," << ColumnName(*I);
+				*CSV_ << "\n";
+			}
+			if(!ColumnDirectory.empty())
+			{
+				ColumnDirectory_=ColumnDirectory;
+				boost::filesystem::create_directories(ColumnDirectory_);
+				Columns_.push_back(boost::shared_ptr<Column>(new Column(ColumnDirectory_,"path")));
+				for(std::vector<Tag>::const_iterator I=Tags_.begin();I!=Tags_.end();I++)
+					Columns_.push_back(boost::shared_ptr<Column>(new Column(ColumnDirectory_,ColumnName(*I))));
+			}
+		}
+
+		//!Called on the pool's threads, so mustn't throw.
+		void Index(const std::string& Path)
+		{
+			std::vector<std::string> Row(1,Path);
+			try
+			{
+				std::ifstream In(Path.c_str(),std::ios::binary);
+				if(!In)
+					throw FileException("Can't open file");
+				FileMetaInformation MetaInfo(In);
+				UID TransferSyntaxUID=IMPL_VR_LE_TRANSFER_SYNTAX;
+				MetaInfo.MetaElements_(TAG_TRANSFER_SYNTAX_UID) >> TransferSyntaxUID;
+				TS ts(TransferSyntaxUID);
+				if(ts.isDeflated())
+					throw FileException("Can't scan a deflated data set");
+
+				DataSet data;
+				ElementHeader Stop;
+				ReadElementsFromStream(In,data,ts,Options_,Stop);
+				for(std::vector<Tag>::const_iterator I=Tags_.begin();I!=Tags_.end();I++)
+					Row.push_back(ValueOf(GroupTag(*I)==0x0002 ? MetaInfo.MetaElements_ : data,*I));
+			}
+			catch(std::exception&)
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				Failed_++;
+				return;
+			}
+
+			boost::mutex::scoped_lock lock(mutex_);
+			if(CSV_)
+			{
+				for(size_t i=0;i<Row.size();i++)
+					*CSV_ << (i ? "," : "") << QuoteCSV(Row[i]);
+				*CSV_ << "\n";
+			}
+			for(size_t i=0;i<Columns_.size();i++)
+				Columns_[i]->Append(Row[i]);
+			Rows_++;
+		}
+
+		//!Once every file has been indexed.
+		void Finish()
+		{
+			if(CSV_)
+				CSV_->flush();
+			Columns_.clear();
+			if(!ColumnDirectory_.empty())
+			{
+				std::ofstream Schema((ColumnDirectory_/"schema.txt").string().c_str());
+				Schema << "rows " << Rows_ << "\n";
+				Schema << "path file path\n";
+				for(std::vector<Tag>::const_iterator I=Tags_.begin();I!=Tags_.end();I++)
+					Schema << ColumnName(*I) << " " << GetName(*I) << "\n";
+			}
+		}
+
+		size_t Rows() const{return Rows_;}
+		size_t Failed() const{return Failed_;}
+
+	private:
+		const std::vector<Tag> Tags_;
+		std::ostream* CSV_;
+		boost::filesystem::path ColumnDirectory_;
+		std::vector<boost::shared_ptr<Column> > Columns_;
+		boost::mutex mutex_;
+		size_t Rows_;
+		size_t Failed_;
+		ReadOptions Options_;
+	};
+
+	//!A pool task; the pool runs one per file pushed onto the prefetcher.
+	void IndexNext(Indexer& indexer,Prefetcher& prefetcher)
+	{
+		std::string Path;
+		if(prefetcher.Pop(Path))
+			indexer.Index(Path);
+	}
+
+	int Usage()
+	{
+		std::cerr << "usage: dicom-index [--tag gggg,eeee]... [--threads N] [--prefetch N] [--csv FILE] [--columns DIR] DIRECTORY..." << std::endl;
+		return 2;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<Tag> Tags;
+	std::vector<std::string> Directories;
+	std::string CSVFile,ColumnDirectory;
+	size_t Threads=0;
+	size_t Prefetch=64;
+
+	for(int i=1;i<argc;i++)
+	{
+		const std::string Arg(argv[i]);
+		const bool HasValue=(i+1<argc);
+		if(Arg=="--tag" && HasValue)
+		{
+			Tag tag;
+			if(!ParseTag(argv[++i],tag))
+			{
+				std::cerr << "dicom-index: " << argv[i] << " isn't a tag" << std::endl;
+				return Usage();
+			}
+			Tags.push_back(tag);
+		}
+		else if(Arg=="--threads" && HasValue)
+			Threads=size_t(std::atoi(argv[++i]));
+		else if(Arg=="--prefetch" && HasValue)
+			Prefetch=size_t(std::atoi(argv[++i]));
+		else if(Arg=="--csv" && HasValue)
+			CSVFile=argv[++i];
+		else if(Arg=="--columns" && HasValue)
+			ColumnDirectory=argv[++i];
+		else if(Arg.size()>1 && Arg[0]=='-')
+			return Usage();
+		else
+			Directories.push_back(Arg);
+	}
+	if(Directories.empty())
+		return Usage();
+	if(Tags.empty())
+		Tags.assign(DefaultTags,DefaultTags+sizeof(DefaultTags)/sizeof(DefaultTags[0]));
+	if(CSVFile.empty() && ColumnDirectory.empty())
+		CSVFile="-";
+
+	const boost::posix_time::ptime Start=boost::posix_time::microsec_clock::universal_time();
+	try
+	{
+		std::ofstream CSVStream;
+		std::ostream* CSV=0;
+		if(CSVFile=="-")
+			CSV=&std::cout;
+		else if(!CSVFile.empty())
+		{
+			CSVStream.open(CSVFile.c_str());
+			if(!CSVStream)
+				throw std::runtime_error("Can't create "+CSVFile);
+			CSV=&CSVStream;
+		}
+
+		Indexer indexer(Tags,CSV,ColumnDirectory);
+		//Headers are near the start, so there's no point having the kernel read whole images.
+		Prefetcher prefetcher(Prefetch,256*1024);
+		{
+			//a short queue, so we don't get far ahead of the readers listing a huge tree.
+			ThreadPool pool(Threads,1024);
+			for(std::vector<std::string>::const_iterator D=Directories.begin();D!=Directories.end();D++)
+			{
+				boost::system::error_code error;
+				boost::filesystem::recursive_directory_iterator I(*D,error),End;
+				if(error)
+				{
+					std::cerr << "dicom-index: can't read " << *D << ": " << error.message() << std::endl;
+					continue;
+				}
+				for(;I!=End;I.increment(error))
+				{
+					if(error)
+						continue;
+					if(boost::filesystem::is_regular_file(I->status()))
+					{
+						prefetcher.Push(I->path().string());
+						pool.Post(boost::bind(IndexNext,boost::ref(indexer),boost::ref(prefetcher)));
+					}
+				}
+			}
+		}//waits for the pool to finish.
+		indexer.Finish();
+
+		const boost::posix_time::time_duration Elapsed=boost::posix_time::microsec_clock::universal_time()-Start;
+		std::cerr << "dicom-index: " << indexer.Rows() << " files indexed, " << indexer.Failed()
+			<< " skipped, in " << Elapsed.total_milliseconds()/1000.0 << "s" << std::endl;
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << "dicom-index: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}